@@ -0,0 +1,244 @@
+/* linux/arch/arm/mach-s5pc110/cpuidle.c
+ *
+ * Copyright (c) 2010 Samsung Electronics
+ *
+ * S5PC110 CPU idle driver
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+*/
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/init.h>
+#include <linux/sched.h>
+#include <linux/cpuidle.h>
+#include <linux/ktime.h>
+#include <linux/io.h>
+
+#include <asm/proc-fns.h>
+
+#include <mach/hardware.h>
+#include <mach/map.h>
+
+#include <plat/regs-clock.h>
+
+#if defined(CONFIG_CPU_IDLE_MONITORING)
+#include <linux/gpio.h>
+#include <plat/gpio-cfg.h>
+#include <plat/regs-gpio.h>
+#endif
+
+/* temp code for EVT1 */
+extern int hw_version_check(void);
+
+/*
+ * IDLE_CFG fields: TOP_LOGIC [31:30] and TOP_MEMORY [29:28] are 2'b10 for
+ * "on", CFG_DIDLE [0] selects DEEP-IDLE instead of IDLE.
+ */
+#define S5P_IDLE_CFG_TL_MASK	(3 << 30)
+#define S5P_IDLE_CFG_TM_MASK	(3 << 28)
+#define S5P_IDLE_CFG_TL_ON	(2 << 30)
+#define S5P_IDLE_CFG_TM_ON	(2 << 28)
+#define S5P_IDLE_CFG_DIDLE	(1 << 0)
+
+#define S5P_OTHERS_SYSC_INTOFF	(1 << 0)
+
+/*
+ * Exit latency and target residency, in uS.  WFI only gates the core
+ * clock inside the ARM and comes back at once.  In IDLE mode the PMU
+ * stops ARMCLK at the clock controller, so the L2, NEON and the ARM
+ * side of the bus are gated too, while the TOP block (LCD, audio, DMA)
+ * keeps running and any interrupt wakes the core.
+ */
+#define S5PC110_WFI_EXIT_LATENCY	1
+#define S5PC110_WFI_RESIDENCY		1
+#define S5PC110_IDLE_EXIT_LATENCY	20
+#define S5PC110_IDLE_RESIDENCY		200
+
+enum {
+	S5PC110_STATE_WFI,
+	S5PC110_STATE_IDLE,
+	S5PC110_STATE_COUNT
+};
+
+static struct cpuidle_driver s5pc110_idle_driver = {
+	.name	= "s5pc110_idle",
+	.owner	= THIS_MODULE,
+};
+
+static DEFINE_PER_CPU(struct cpuidle_device, s5pc110_idle_device);
+
+/*
+ * s5pc110_idle() never entered PMU IDLE on any revision, so this driver is
+ * the first user of it; cpuidle.pmu_idle=0 keeps the core in WFI only.
+ */
+static int pmu_idle = 1;
+module_param(pmu_idle, bool, S_IRUGO);
+
+#if defined(CONFIG_CPU_IDLE_MONITORING)
+static unsigned int s5pc110_idle_gph2[3];
+
+/*
+ * Drive GPH2[6] high for as long as the core is idle, so idle can be
+ * watched on a scope or LED.  The pin is restored after every idle.
+ */
+static void s5pc110_idle_monitor_start(void)
+{
+	unsigned int tmp;
+
+	s5pc110_idle_gph2[0] = __raw_readl(S5PC11X_GPH2CON);
+	s5pc110_idle_gph2[1] = __raw_readl(S5PC11X_GPH2DAT);
+	s5pc110_idle_gph2[2] = __raw_readl(S5PC11X_GPH2PUD);
+
+	tmp = s5pc110_idle_gph2[0] & ~(0xF << 24);	/* GPH2[6] output */
+	tmp |= (0x1 << 24);
+	__raw_writel(tmp, S5PC11X_GPH2CON);
+	tmp = s5pc110_idle_gph2[2] & ~(0x3 << 12);	/* no pull-up/down */
+	__raw_writel(tmp, S5PC11X_GPH2PUD);
+
+	tmp = __raw_readl(S5PC11X_GPH2DAT) | (0x1 << 6);
+	__raw_writel(tmp, S5PC11X_GPH2DAT);
+}
+
+static void s5pc110_idle_monitor_end(void)
+{
+	unsigned int tmp;
+
+	tmp = __raw_readl(S5PC11X_GPH2DAT) & ~(0x1 << 6);
+	__raw_writel(tmp, S5PC11X_GPH2DAT);
+
+	__raw_writel(s5pc110_idle_gph2[0], S5PC11X_GPH2CON);
+	__raw_writel(s5pc110_idle_gph2[1], S5PC11X_GPH2DAT);
+	__raw_writel(s5pc110_idle_gph2[2], S5PC11X_GPH2PUD);
+}
+#else
+static inline void s5pc110_idle_monitor_start(void) { }
+static inline void s5pc110_idle_monitor_end(void) { }
+#endif
+
+static void s5pc110_enter_wfi(void)
+{
+	unsigned int tmp;
+
+	tmp = __raw_readl(S5P_PWR_CFG);
+	tmp &= S5P_CFG_WFI_CLEAN;
+	__raw_writel(tmp, S5P_PWR_CFG);
+
+	cpu_do_idle();
+}
+
+/*
+ * 1. Clear CFG_DIDLE and keep TOP logic and memory on in IDLE_CFG.
+ * 2. Set CFG_STANDBYWFI of PWR_CFG to IDLE.
+ * 3. Leave SYSC_INTOFF of OTHERS clear so the pending interrupt wakes us.
+ * 4. WFI, then put CFG_STANDBYWFI back so a plain WFI stays a plain WFI.
+ */
+static void s5pc110_enter_pmu_idle(void)
+{
+	unsigned int tmp;
+
+	tmp = __raw_readl(S5P_IDLE_CFG);
+	tmp &= ~(S5P_IDLE_CFG_TL_MASK | S5P_IDLE_CFG_TM_MASK |
+		 S5P_IDLE_CFG_DIDLE);
+	tmp |= S5P_IDLE_CFG_TL_ON | S5P_IDLE_CFG_TM_ON;
+	__raw_writel(tmp, S5P_IDLE_CFG);
+
+	tmp = __raw_readl(S5P_PWR_CFG);
+	tmp &= S5P_CFG_WFI_CLEAN;
+	tmp |= S5P_CFG_WFI_IDLE;
+	__raw_writel(tmp, S5P_PWR_CFG);
+
+	tmp = __raw_readl(S5P_OTHERS);
+	tmp &= ~S5P_OTHERS_SYSC_INTOFF;
+	__raw_writel(tmp, S5P_OTHERS);
+
+	cpu_do_idle();
+
+	tmp = __raw_readl(S5P_PWR_CFG);
+	tmp &= S5P_CFG_WFI_CLEAN;
+	__raw_writel(tmp, S5P_PWR_CFG);
+}
+
+static int s5pc110_enter_idle(struct cpuidle_device *dev,
+			      struct cpuidle_state *state)
+{
+	void (*enter)(void) = cpuidle_get_statedata(state);
+	ktime_t before, after;
+
+	local_irq_disable();
+	before = ktime_get();
+
+	if (!need_resched()) {
+		s5pc110_idle_monitor_start();
+		enter();
+		s5pc110_idle_monitor_end();
+	}
+
+	after = ktime_get();
+	local_irq_enable();
+
+	return (int)ktime_to_us(ktime_sub(after, before));
+}
+
+static void __init s5pc110_init_state(struct cpuidle_state *state,
+				      const char *name, const char *desc,
+				      unsigned int exit_latency,
+				      unsigned int target_residency,
+				      unsigned int flags,
+				      void (*enter)(void))
+{
+	strcpy(state->name, name);
+	strcpy(state->desc, desc);
+	state->exit_latency = exit_latency;
+	state->target_residency = target_residency;
+	state->flags = CPUIDLE_FLAG_TIME_VALID | flags;
+	state->enter = s5pc110_enter_idle;
+	cpuidle_set_statedata(state, enter);
+}
+
+static int __init s5pc110_init_cpuidle(void)
+{
+	struct cpuidle_device *dev;
+	int ret;
+
+	ret = cpuidle_register_driver(&s5pc110_idle_driver);
+	if (ret) {
+		printk(KERN_ERR "s5pc110_idle: failed to register driver\n");
+		return ret;
+	}
+
+	dev = &per_cpu(s5pc110_idle_device, 0);
+	dev->cpu = 0;
+
+	s5pc110_init_state(&dev->states[S5PC110_STATE_WFI], "WFI",
+			   "ARM clock gating",
+			   S5PC110_WFI_EXIT_LATENCY, S5PC110_WFI_RESIDENCY,
+			   CPUIDLE_FLAG_SHALLOW, s5pc110_enter_wfi);
+	dev->state_count = 1;
+
+	/* the vendor code only ever meant to use PMU IDLE on EVT1 */
+	if (pmu_idle && hw_version_check()) {
+		s5pc110_init_state(&dev->states[S5PC110_STATE_IDLE], "IDLE",
+				   "ARMCLK stopped, TOP on",
+				   S5PC110_IDLE_EXIT_LATENCY,
+				   S5PC110_IDLE_RESIDENCY,
+				   CPUIDLE_FLAG_BALANCED,
+				   s5pc110_enter_pmu_idle);
+		dev->state_count = S5PC110_STATE_COUNT;
+	}
+
+	dev->safe_state = &dev->states[S5PC110_STATE_WFI];
+
+	ret = cpuidle_register_device(dev);
+	if (ret) {
+		printk(KERN_ERR "s5pc110_idle: failed to register device\n");
+		cpuidle_unregister_driver(&s5pc110_idle_driver);
+		return ret;
+	}
+
+	return 0;
+}
+
+device_initcall(s5pc110_init_cpuidle);
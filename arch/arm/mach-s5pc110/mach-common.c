@@ -289,6 +289,10 @@ static void __init smdkc110_fixup(struct machine_desc *desc,
 	mi->nr_banks = 2;
 #endif
 
+#ifdef LOGGER_PERSIST_SIZE
+	/* boards that keep the logs over a reset carve them out here */
+	logger_persist_reserve(&mi->bank[1]);
+#endif
 }
 
 
@@ -107,6 +107,47 @@ extern unsigned char maxim_chg_status(void);
 extern void kernel_sec_hw_reset(bool bSilentReset);
 extern void kernel_sec_clear_upload_magic_number(void);
 
+#ifdef CONFIG_ANDROID_LOGGER_PERSIST
+/*
+ * The top of the second DRAM bank is kept from the kernel by
+ * smdkc110_fixup() and is not touched by the bootloader on a warm reset,
+ * so the logger archives log_main and log_radio there for the next boot.
+ */
+#define LOGGER_PERSIST_MAIN_SIZE	(768 * SZ_1K)
+#define LOGGER_PERSIST_RADIO_SIZE	(256 * SZ_1K)
+#define LOGGER_PERSIST_SIZE	(LOGGER_PERSIST_MAIN_SIZE + LOGGER_PERSIST_RADIO_SIZE)
+
+static struct resource logger_persist_resources[] = {
+	{
+		.name	= "log_main",
+		.flags	= IORESOURCE_MEM,
+	},
+	{
+		.name	= "log_radio",
+		.flags	= IORESOURCE_MEM,
+	},
+};
+
+static struct platform_device logger_persist_device = {
+	.name		= "logger_persist",
+	.id		= -1,
+	.num_resources	= ARRAY_SIZE(logger_persist_resources),
+	.resource	= logger_persist_resources,
+};
+
+static void __init logger_persist_reserve(struct membank *bank)
+{
+	bank->size -= LOGGER_PERSIST_SIZE;
+
+	logger_persist_resources[0].start = bank->start + bank->size;
+	logger_persist_resources[0].end = logger_persist_resources[0].start +
+					  LOGGER_PERSIST_MAIN_SIZE - 1;
+	logger_persist_resources[1].start = logger_persist_resources[0].end + 1;
+	logger_persist_resources[1].end = logger_persist_resources[1].start +
+					  LOGGER_PERSIST_RADIO_SIZE - 1;
+}
+#endif
+
 #include "mach-common.c"
 
 
@@ -1058,6 +1099,9 @@ static struct platform_device *smdkc110_devices[] __initdata = {
 	&sec_device_rfkill,
 	&sec_device_btsleep,
 	&sec_device_battery,
+#ifdef CONFIG_ANDROID_LOGGER_PERSIST
+	&logger_persist_device,
+#endif
 };
 static struct s3c_ts_mach_info s3c_ts_platform __initdata = {
 	.delay 			= 10000,
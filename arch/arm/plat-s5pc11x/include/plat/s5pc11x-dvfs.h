@@ -9,6 +9,10 @@
 
 #ifndef __PLAT_S5PC11X_DVFS_H
 #define __PLAT_S5PC11X_DVFS_H
+#include <linux/list.h>
+#include <linux/plist.h>
+#include <linux/timer.h>
+#include <linux/ktime.h>
 #include <plat/cpu-freq.h>
 
 //extern void s5pc110_lock_power_domain(unsigned int nToken);
@@ -34,6 +38,7 @@ extern unsigned int S5PC11X_MAXFREQLEVEL;
 extern unsigned int s5pc11x_target_frq(unsigned int pred_freq, int flag);
 extern int s5pc110_pm_target(unsigned int target_freq);
 extern int is_conservative_gov(void);
+extern int is_interactive_gov(void);
 extern int is_userspace_gov(void);
 extern void set_dvfs_perf_level(void);
 extern int set_voltage(enum perf_level p_lv);
@@ -50,26 +55,42 @@ extern int set_voltage_dvs(enum perf_level p_lv);
 extern int s5pc110_dvfs_lock_high_hclk(unsigned int dToken);
 extern int s5pc110_dvfs_unlock_high_hclk(unsigned int dToken);
 
-#define NUMBER_OF_LOCKTOKEN 9
-#if 0
-#define DVFS_LOCK_TOKEN_1	 0x01 << 0
-#define DVFS_LOCK_TOKEN_2	 0x01 << 1
-#define DVFS_LOCK_TOKEN_3	 0x01 << 2
-#define DVFS_LOCK_TOKEN_4	 0x01 << 3
-#define DVFS_LOCK_TOKEN_5	 0x01 << 4
-#else
-#define DVFS_LOCK_TOKEN_1	 0
-#define DVFS_LOCK_TOKEN_2	 1
-#define DVFS_LOCK_TOKEN_3	 2
-#define DVFS_LOCK_TOKEN_4	 3
-#define DVFS_LOCK_TOKEN_5	 4
-#define DVFS_LOCK_TOKEN_6	 5
-#define DVFS_LOCK_TOKEN_7	 6
-#define DVFS_LOCK_TOKEN_8	 7
-#define DVFS_LOCK_TOKEN_9	 8
-#endif
+/*
+ * CPU frequency floor requests.
+ *
+ * Each user owns a named request and asks for a minimum ARM clock in kHz.
+ * Active requests are kept on a priority list and the fastest one caps how
+ * far the governor may scale down. A request can be given a timeout (in
+ * jiffies, like wake_lock_timeout) after which it drops by itself.
+ * Requests are registered on first use and listed, with their hold
+ * statistics, in <debugfs>/dvfs_floor.
+ */
+struct s5pc110_dvfs_floor {
+	const char		*name;
+	unsigned int		freq;		/* kHz */
+	int			registered;
+	int			active;
+	struct plist_node	node;		/* prio is the table index */
+	struct list_head	entry;
+	struct timer_list	timer;
+
+	/* statistics */
+	unsigned long		count;
+	unsigned long		expire_count;
+	ktime_t			start;
+	ktime_t			total_time;
+	ktime_t			max_time;
+};
+
+#define DEFINE_DVFS_FLOOR(_var, _name)					\
+	struct s5pc110_dvfs_floor _var = { .name = _name }
 
-void s5pc110_lock_dvfs_high_level(unsigned int nToken, unsigned int level);
-void s5pc110_unlock_dvfs_high_level(unsigned int nToken);
+extern void s5pc110_dvfs_floor_request(struct s5pc110_dvfs_floor *req,
+				       unsigned int freq);
+extern void s5pc110_dvfs_floor_request_timeout(struct s5pc110_dvfs_floor *req,
+					       unsigned int freq, long timeout);
+extern void s5pc110_dvfs_floor_release(struct s5pc110_dvfs_floor *req);
+extern void s5pc110_dvfs_floor_remove(struct s5pc110_dvfs_floor *req);
+extern int s5pc110_dvfs_floor_active(struct s5pc110_dvfs_floor *req);
 
-#endif /* __PLAT_S5PC11X_DVFS_H */
+#endif /* __PLAT_S5PC11X_DVFS_H */
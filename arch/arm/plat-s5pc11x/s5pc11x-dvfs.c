@@ -19,6 +19,12 @@
 #include <linux/err.h>
 #include <linux/clk.h>
 #include <linux/io.h>
+#include <linux/spinlock.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/ktime.h>
+
+#include <trace/s5pc110_dvfs.h>
 
 #include <asm/system.h>
 
@@ -35,7 +41,6 @@
 #include <linux/suspend.h>
 #endif
 
-#define ENABLE_DVFS_LOCK_HIGH 1
 #define USE_DVS
 #define GPIO_BASED_DVS
 
@@ -56,6 +61,7 @@ unsigned int s5pc11x_cpufreq_index = 1;
 static char cpufreq_governor_name[CPUFREQ_NAME_LEN] = "conservative";// default governor
 static char userspace_governor[CPUFREQ_NAME_LEN] = "userspace";
 static char conservative_governor[CPUFREQ_NAME_LEN] = "conservative";
+static char interactive_governor[CPUFREQ_NAME_LEN] = "interactive";
 int s5pc11x_clk_dsys_psys_change(int index);
 
 unsigned int prevIndex = 0;
@@ -65,13 +71,12 @@ static struct clk * mpu_clk;
 static void inform_dvfs_clock_status(struct work_struct *work);
 static DECLARE_DELAYED_WORK(dvfs_info_print_work, inform_dvfs_clock_status);
 #endif
-#if ENABLE_DVFS_LOCK_HIGH
-unsigned int g_dvfs_high_lock_token = 0;
-static DEFINE_MUTEX(dvfs_high_lock);
-unsigned int g_dvfs_high_lock_limit = 4;
-unsigned int g_dvfslockval[NUMBER_OF_LOCKTOKEN];
 
-#endif //ENABLE_DVFS_LOCK_HIGH
+static DEFINE_SPINLOCK(dvfs_floor_lock);
+static struct plist_head dvfs_floor_head = PLIST_HEAD_INIT(dvfs_floor_head, dvfs_floor_lock);
+static LIST_HEAD(dvfs_floor_list);
+/* table index of the fastest active floor, -1 if there is none */
+static int dvfs_floor_index = -1;
 
 extern void print_clocks(void);
 extern int store_up_down_threshold(unsigned int down_threshold_value,
@@ -156,27 +161,14 @@ static unsigned int  (*s5pc110_thres_table[2])[2] = {
 
 
 // for active high with event from TS and key
-static int dvfs_perf_lock = 0;
+static DEFINE_SPINLOCK(dvfs_perf_lock);
 int dvfs_change_quick = 0;
-void static sdvfs_lock(unsigned int *lock)
-{
-	while(*lock) {
-		msleep(1);
-	}
-	*lock = 1;
-}
-
-void static sdvfs_unlock(unsigned int *lock)
-{
-	*lock = 0;
-}
 
 void set_dvfs_perf_level(void) 
 {
-	//unsigned long irqflags;
+	unsigned long irqflags;
 
-	sdvfs_lock(&dvfs_perf_lock);
-	//spin_lock_irqsave(&g_cpufreq_lock, irqflags);
+	spin_lock_irqsave(&dvfs_perf_lock, irqflags);
 	if(s5pc11x_cpufreq_index >= (S5PC11X_MAXFREQLEVEL - 2)) {
 		if (S5PC11X_FREQ_TAB) 
 			s5pc11x_cpufreq_index = 0; 
@@ -184,61 +176,404 @@ void set_dvfs_perf_level(void)
 			s5pc11x_cpufreq_index = 1; 
 		dvfs_change_quick = 1;
 	}
-	//spin_unlock_irqrestore(&g_cpufreq_lock, irqflags);
-	sdvfs_unlock(&dvfs_perf_lock);
+	spin_unlock_irqrestore(&dvfs_perf_lock, irqflags);
 
 }
 
-#if ENABLE_DVFS_LOCK_HIGH
-void s5pc110_lock_dvfs_high_level(unsigned int nToken, unsigned int level) 
+/* slowest level of the current table that still runs at freq or above */
+static int dvfs_floor_freq_to_index(unsigned int freq)
 {
-	unsigned int nLevel;
-	//printk("dvfs lock with token %d\n",nToken);
-	if (!S5PC11X_FREQ_TAB) nLevel = level + 1;
-        else nLevel = level;
-	
-	if (nToken == DVFS_LOCK_TOKEN_6 ) nLevel--; // token for launcher , this can use 1GHz
-// check lock corruption
-	if (g_dvfs_high_lock_token & (1 << nToken) ) printk ("\n\n[DVFSLOCK] lock token %d is already used!\n\n", nToken);
-	mutex_lock(&dvfs_high_lock);
-	g_dvfs_high_lock_token |= (1 << nToken);
-	g_dvfslockval[nToken] = nLevel;
-	if (nLevel <  g_dvfs_high_lock_limit)
-		g_dvfs_high_lock_limit = nLevel;
-	mutex_unlock(&dvfs_high_lock);
-	set_dvfs_perf_level();
-}
-EXPORT_SYMBOL(s5pc110_lock_dvfs_high_level);
-
-void s5pc110_unlock_dvfs_high_level(unsigned int nToken) 
-{
-	unsigned int i;
-	//printk("dvfs unlock with token %d\n",nToken);
-	mutex_lock(&dvfs_high_lock);
-	g_dvfs_high_lock_token &= ~(1 << nToken);
-	g_dvfslockval[nToken] = MAXFREQ_LEVEL_SUPPORTED-1;
-	g_dvfs_high_lock_limit = MAXFREQ_LEVEL_SUPPORTED-1;
-
-	if (g_dvfs_high_lock_token) {
-		for (i=0;i<NUMBER_OF_LOCKTOKEN;i++) {
-			if (g_dvfslockval[i] < g_dvfs_high_lock_limit)  g_dvfs_high_lock_limit = g_dvfslockval[i];
+	struct cpufreq_frequency_table *freq_tab = s5pc110_freq_table[S5PC11X_FREQ_TAB];
+	int index;
+
+	for (index = S5PC11X_MAXFREQLEVEL; index > 0; index--) {
+		if (freq_tab[index].frequency >= freq)
+			break;
+	}
+
+	return index;
+}
+
+static void dvfs_floor_expire(unsigned long data);
+
+static void dvfs_floor_register_locked(struct s5pc110_dvfs_floor *req)
+{
+	if (req->registered)
+		return;
+
+	plist_node_init(&req->node, 0);
+	setup_timer(&req->timer, dvfs_floor_expire, (unsigned long)req);
+	list_add_tail(&req->entry, &dvfs_floor_list);
+	req->registered = 1;
+}
+
+static void dvfs_floor_update_locked(void)
+{
+	if (plist_head_empty(&dvfs_floor_head))
+		dvfs_floor_index = -1;
+	else
+		dvfs_floor_index = plist_first(&dvfs_floor_head)->prio;
+
+	/* let the governor jump up on its next sample instead of stepping */
+	if (dvfs_floor_index >= 0 && s5pc11x_cpufreq_index > dvfs_floor_index)
+		dvfs_change_quick = 1;
+}
+
+static void dvfs_floor_drop_locked(struct s5pc110_dvfs_floor *req)
+{
+	ktime_t held;
+
+	if (!req->active)
+		return;
+
+	plist_del(&req->node, &dvfs_floor_head);
+	req->active = 0;
+
+	held = ktime_sub(ktime_get(), req->start);
+	req->total_time = ktime_add(req->total_time, held);
+	if (ktime_to_ns(held) > ktime_to_ns(req->max_time))
+		req->max_time = held;
+}
+
+static void dvfs_floor_expire(unsigned long data)
+{
+	struct s5pc110_dvfs_floor *req = (struct s5pc110_dvfs_floor *)data;
+	unsigned long irqflags;
+
+	spin_lock_irqsave(&dvfs_floor_lock, irqflags);
+	if (req->active) {
+		dvfs_floor_drop_locked(req);
+		req->expire_count++;
+		dvfs_floor_update_locked();
+	}
+	spin_unlock_irqrestore(&dvfs_floor_lock, irqflags);
+}
+
+/*
+ * Keep the ARM clock at or above freq (kHz) until released, or for at
+ * most timeout jiffies when timeout > 0. Calling it again on an active
+ * request moves the floor and restarts the timeout.
+ */
+void s5pc110_dvfs_floor_request_timeout(struct s5pc110_dvfs_floor *req,
+					unsigned int freq, long timeout)
+{
+	unsigned long irqflags;
+
+	spin_lock_irqsave(&dvfs_floor_lock, irqflags);
+	dvfs_floor_register_locked(req);
+
+	if (req->active) {
+		plist_del(&req->node, &dvfs_floor_head);
+	} else {
+		req->active = 1;
+		req->count++;
+		req->start = ktime_get();
+	}
+
+	req->freq = freq;
+	plist_node_init(&req->node, dvfs_floor_freq_to_index(freq));
+	plist_add(&req->node, &dvfs_floor_head);
+
+	if (timeout > 0)
+		mod_timer(&req->timer, jiffies + timeout);
+	else
+		del_timer(&req->timer);
+
+	dvfs_floor_update_locked();
+	spin_unlock_irqrestore(&dvfs_floor_lock, irqflags);
+}
+EXPORT_SYMBOL(s5pc110_dvfs_floor_request_timeout);
+
+void s5pc110_dvfs_floor_request(struct s5pc110_dvfs_floor *req, unsigned int freq)
+{
+	s5pc110_dvfs_floor_request_timeout(req, freq, 0);
+}
+EXPORT_SYMBOL(s5pc110_dvfs_floor_request);
+
+void s5pc110_dvfs_floor_release(struct s5pc110_dvfs_floor *req)
+{
+	unsigned long irqflags;
+
+	spin_lock_irqsave(&dvfs_floor_lock, irqflags);
+	if (req->active) {
+		del_timer(&req->timer);
+		dvfs_floor_drop_locked(req);
+		dvfs_floor_update_locked();
+	}
+	spin_unlock_irqrestore(&dvfs_floor_lock, irqflags);
+}
+EXPORT_SYMBOL(s5pc110_dvfs_floor_release);
+
+int s5pc110_dvfs_floor_active(struct s5pc110_dvfs_floor *req)
+{
+	return req->active;
+}
+EXPORT_SYMBOL(s5pc110_dvfs_floor_active);
+
+/* for requests that live in memory about to be freed, e.g. module exit */
+void s5pc110_dvfs_floor_remove(struct s5pc110_dvfs_floor *req)
+{
+	unsigned long irqflags;
+
+	if (!req->registered)
+		return;
+
+	del_timer_sync(&req->timer);
+
+	spin_lock_irqsave(&dvfs_floor_lock, irqflags);
+	dvfs_floor_drop_locked(req);
+	dvfs_floor_update_locked();
+	list_del(&req->entry);
+	req->registered = 0;
+	spin_unlock_irqrestore(&dvfs_floor_lock, irqflags);
+}
+EXPORT_SYMBOL(s5pc110_dvfs_floor_remove);
+
+#ifdef CONFIG_DEBUG_FS
+static unsigned long dvfs_floor_ktime_to_ms(ktime_t kt)
+{
+	struct timeval tv = ktime_to_timeval(kt);
+
+	return tv.tv_sec * MSEC_PER_SEC + tv.tv_usec / USEC_PER_MSEC;
+}
+
+static int dvfs_floor_show(struct seq_file *m, void *unused)
+{
+	struct s5pc110_dvfs_floor *req;
+	unsigned long irqflags;
+	ktime_t now, total, held;
+
+	spin_lock_irqsave(&dvfs_floor_lock, irqflags);
+
+	if (dvfs_floor_index >= 0)
+		seq_printf(m, "floor: %u kHz (L%d)\n",
+			   s5pc110_freq_table[S5PC11X_FREQ_TAB][dvfs_floor_index].frequency,
+			   dvfs_floor_index);
+	else
+		seq_printf(m, "floor: none\n");
+
+	seq_printf(m, "%-20s %8s %6s %8s %8s %10s %10s\n", "name", "kHz",
+		   "active", "count", "expired", "total_ms", "max_ms");
+
+	now = ktime_get();
+	list_for_each_entry(req, &dvfs_floor_list, entry) {
+		total = req->total_time;
+		held = ktime_set(0, 0);
+		if (req->active) {
+			held = ktime_sub(now, req->start);
+			total = ktime_add(total, held);
+		}
+		if (ktime_to_ns(held) < ktime_to_ns(req->max_time))
+			held = req->max_time;
+
+		seq_printf(m, "%-20s %8u %6d %8lu %8lu %10lu %10lu\n",
+			   req->name, req->freq, req->active, req->count,
+			   req->expire_count, dvfs_floor_ktime_to_ms(total),
+			   dvfs_floor_ktime_to_ms(held));
+	}
+
+	spin_unlock_irqrestore(&dvfs_floor_lock, irqflags);
+
+	return 0;
+}
+
+static int dvfs_floor_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, dvfs_floor_show, NULL);
+}
+
+static const struct file_operations dvfs_floor_fops = {
+	.open		= dvfs_floor_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init dvfs_floor_debugfs_init(void)
+{
+	debugfs_create_file("dvfs_floor", S_IRUGO, NULL, NULL, &dvfs_floor_fops);
+	return 0;
+}
+late_initcall(dvfs_floor_debugfs_init);
+#endif /* CONFIG_DEBUG_FS */
+
+enum {
+	DVFS_LATENCY_VOLTAGE,	/* MAX8998 voltage change */
+	DVFS_LATENCY_APLL,	/* ARM clock change, APLL relock */
+	DVFS_LATENCY_DIVIDER,	/* DMC/PSYS divider change */
+	DVFS_LATENCY_TOTAL,	/* PRECHANGE to POSTCHANGE notification */
+	DVFS_LATENCY_COUNT
+};
+
+DEFINE_TRACE(s5pc110_dvfs_transition);
+
+#ifdef CONFIG_DEBUG_FS
+/*
+ * Log2 histograms of the time s5pc110_target() spends in each step of a
+ * transition, kept separately for steps up and down: bucket 0 counts
+ * samples below 1 << DVFS_LATENCY_SHIFT us and each following bucket
+ * doubles the range, the last one collecting everything from 16ms up.
+ * They can only be read through debugfs, so without it neither the
+ * per-step timestamps nor the histograms are kept.
+ */
+#define DVFS_LATENCY_SHIFT	2
+#define DVFS_LATENCY_BUCKETS	14
+
+struct dvfs_latency {
+	u32 count[DVFS_LATENCY_BUCKETS];
+	u64 total_us;
+	u32 max_us;
+};
+
+static const char *dvfs_latency_strings[] = {
+	"voltage",
+	"apll",
+	"divider",
+	"total",
+};
+
+/* [0] steps to a lower frequency, [1] steps to a higher one */
+static struct dvfs_latency dvfs_latency[2][DVFS_LATENCY_COUNT];
+static DEFINE_SPINLOCK(dvfs_latency_lock);
+
+static inline ktime_t dvfs_latency_start(void)
+{
+	return ktime_get();
+}
+
+static inline void dvfs_latency_end(s64 *lat, int step, ktime_t start)
+{
+	lat[step] = ktime_us_delta(ktime_get(), start);
+}
+
+static void dvfs_latency_record(int up, s64 *lat)
+{
+	struct dvfs_latency *latency;
+	unsigned long irqflags;
+	u64 v;
+	int i, j;
+
+	spin_lock_irqsave(&dvfs_latency_lock, irqflags);
+	for (i = 0; i < DVFS_LATENCY_COUNT; i++) {
+		latency = &dvfs_latency[!!up][i];
+		if (lat[i] < 0)
+			lat[i] = 0;
+		latency->total_us += lat[i];
+		if (lat[i] > latency->max_us)
+			latency->max_us = lat[i];
+		v = (u64)lat[i] >> DVFS_LATENCY_SHIFT;
+		j = 0;
+		while (v && j < DVFS_LATENCY_BUCKETS - 1) {
+			v >>= 1;
+			j++;
+		}
+		latency->count[j]++;
+	}
+	spin_unlock_irqrestore(&dvfs_latency_lock, irqflags);
+}
+
+/*
+ * One line per non-empty histogram: sample count, average and maximum, then
+ * the count of each bucket up to the last non-empty one.
+ */
+static int dvfs_latency_show(struct seq_file *m, void *unused)
+{
+	struct dvfs_latency *latency;
+	unsigned long irqflags;
+	int dir, i, j, last;
+	u32 samples;
+	u64 avg;
+
+	BUILD_BUG_ON(ARRAY_SIZE(dvfs_latency_strings) != DVFS_LATENCY_COUNT);
+
+	spin_lock_irqsave(&dvfs_latency_lock, irqflags);
+	for (dir = 1; dir >= 0; dir--) {
+		for (i = 0; i < DVFS_LATENCY_COUNT; i++) {
+			latency = &dvfs_latency[dir][i];
+			samples = 0;
+			last = 0;
+			for (j = 0; j < DVFS_LATENCY_BUCKETS; j++) {
+				samples += latency->count[j];
+				if (latency->count[j])
+					last = j;
+			}
+			if (!samples)
+				continue;
+			avg = latency->total_us;
+			do_div(avg, samples);
+			seq_printf(m, "%s %s: %u avg %lluus max %uus,",
+				   dir ? "up" : "down", dvfs_latency_strings[i],
+				   samples, (unsigned long long)avg,
+				   latency->max_us);
+			for (j = 0; j <= last; j++)
+				seq_printf(m, " %u", latency->count[j]);
+			seq_printf(m, "\n");
 		}
 	}
+	spin_unlock_irqrestore(&dvfs_latency_lock, irqflags);
 
-	mutex_unlock(&dvfs_high_lock);
+	return 0;
 }
-EXPORT_SYMBOL(s5pc110_unlock_dvfs_high_level);
-#endif //ENABLE_DVFS_LOCK_HIGH
+
+static int dvfs_latency_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, dvfs_latency_show, NULL);
+}
+
+static ssize_t dvfs_latency_write(struct file *file, const char __user *buf,
+				  size_t count, loff_t *ppos)
+{
+	unsigned long irqflags;
+
+	/* any write clears the histograms */
+	spin_lock_irqsave(&dvfs_latency_lock, irqflags);
+	memset(dvfs_latency, 0, sizeof(dvfs_latency));
+	spin_unlock_irqrestore(&dvfs_latency_lock, irqflags);
+
+	return count;
+}
+
+static const struct file_operations dvfs_latency_fops = {
+	.open		= dvfs_latency_open,
+	.read		= seq_read,
+	.write		= dvfs_latency_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init dvfs_latency_debugfs_init(void)
+{
+	debugfs_create_file("dvfs_latency", S_IRUGO | S_IWUSR, NULL, NULL,
+			    &dvfs_latency_fops);
+	return 0;
+}
+late_initcall(dvfs_latency_debugfs_init);
+#else
+static inline ktime_t dvfs_latency_start(void)
+{
+	return ktime_set(0, 0);
+}
+
+static inline void dvfs_latency_end(s64 *lat, int step, ktime_t start)
+{
+}
+
+static inline void dvfs_latency_record(int up, s64 *lat)
+{
+}
+#endif /* CONFIG_DEBUG_FS */
 
 unsigned int s5pc11x_target_frq(unsigned int pred_freq, 
 				int flag)
 {
-	int index;
-	//unsigned long irqflags;
+	int index, floor;
+	unsigned long irqflags;
 	unsigned int freq;
 
 	struct cpufreq_frequency_table *freq_tab = s5pc110_freq_table[S5PC11X_FREQ_TAB];
 
+	spin_lock_irqsave(&dvfs_perf_lock, irqflags);
+
 	if(freq_tab[0].frequency < pred_freq) {
 	   index = 0;	
 	   goto s5pc11x_target_frq_end;
@@ -248,7 +583,6 @@ unsigned int s5pc11x_target_frq(unsigned int pred_freq,
 		printk("s5pc1xx_target_frq: flag error!!!!!!!!!!!!!");
 	}
 
-	sdvfs_lock(&dvfs_perf_lock);
 	index = s5pc11x_cpufreq_index;
 
 	if(freq_tab[index].frequency == pred_freq) {	
@@ -261,9 +595,9 @@ unsigned int s5pc11x_target_frq(unsigned int pred_freq,
 		index = 0; 
 	}*/
 
-	if (g_dvfs_high_lock_token) {
-		if (index > g_dvfs_high_lock_limit) index = g_dvfs_high_lock_limit;
-	}
+	floor = dvfs_floor_index;
+	if (floor >= 0 && index > floor)
+		index = floor;
 	//printk("s5pc11x_target_frq index = %d\n",index);
 
 s5pc11x_target_frq_end:
@@ -273,7 +607,7 @@ s5pc11x_target_frq_end:
 	//spin_unlock_irqrestore(&g_cpufreq_lock, irqflags);
 	
 	freq = freq_tab[index].frequency;
-	sdvfs_unlock(&dvfs_perf_lock);
+	spin_unlock_irqrestore(&dvfs_perf_lock, irqflags);
 	return freq;
 }
 
@@ -457,6 +791,11 @@ int is_conservative_gov(void)
         return ret;
 }
 
+int is_interactive_gov(void)
+{
+        return !strnicmp(cpufreq_governor_name, interactive_governor, CPUFREQ_NAME_LEN);
+}
+
 
 /* TODO: Add support for SDRAM timing changes */
 
@@ -489,6 +828,9 @@ static int s5pc110_target(struct cpufreq_policy *policy,
 	int ret = 0;
 	unsigned long arm_clk;
 	unsigned int index;
+	unsigned int req_freq = target_freq;
+	ktime_t start, t;
+	s64 lat[DVFS_LATENCY_COUNT] = { 0, };
 
 	//unsigned long irqflags;
 
@@ -527,15 +869,20 @@ static int s5pc110_target(struct cpufreq_policy *policy,
 	freqs.cpu = 0;
 
 	target_freq = arm_clk;
+	start = ktime_get();
 	cpufreq_notify_transition(&freqs, CPUFREQ_PRECHANGE);
 	//spin_lock_irqsave(&g_cpufreq_lock, irqflags);
 
 	if(prevIndex < index) { // clock down
                 dvfs_change_direction = 0;
                 /* frequency scaling */
+                t = dvfs_latency_start();
                 ret = s5pc11x_clk_dsys_psys_change(index);
+                dvfs_latency_end(lat, DVFS_LATENCY_DIVIDER, t);
 
+                t = dvfs_latency_start();
                 ret = clk_set_rate(mpu_clk, target_freq * KHZ_T);
+                dvfs_latency_end(lat, DVFS_LATENCY_APLL, t);
                 if(ret != 0) {
                         printk("frequency scaling error\n");
                         ret = -EINVAL;
@@ -562,23 +909,27 @@ static int s5pc110_target(struct cpufreq_policy *policy,
 		}
 
 #ifdef USE_DVS
+		t = dvfs_latency_start();
 #ifdef GPIO_BASED_DVS
 		set_voltage_dvs(index);
 #else
                 /* voltage scaling */
                 set_voltage(index);
 #endif
+		dvfs_latency_end(lat, DVFS_LATENCY_VOLTAGE, t);
 #endif
                 dvfs_change_direction = -1;
         }else{                                          // clock up
                 dvfs_change_direction = 1;
 #ifdef USE_DVS
+		t = dvfs_latency_start();
 #ifdef GPIO_BASED_DVS
 		set_voltage_dvs(index);
 #else
                 /* voltage scaling */
                 set_voltage(index);
 #endif
+		dvfs_latency_end(lat, DVFS_LATENCY_VOLTAGE, t);
 #endif
 
 		// ARM MCS value set
@@ -601,18 +952,27 @@ static int s5pc110_target(struct cpufreq_policy *policy,
 		}
 
                 /* frequency scaling */
+                t = dvfs_latency_start();
                 ret = clk_set_rate(mpu_clk, target_freq * KHZ_T);
+                dvfs_latency_end(lat, DVFS_LATENCY_APLL, t);
                 if(ret != 0) {
                         printk("frequency scaling error\n");
                         ret = -EINVAL;
                         goto s5pc110_target_end;
                 }
+                t = dvfs_latency_start();
                 ret = s5pc11x_clk_dsys_psys_change(index);
+                dvfs_latency_end(lat, DVFS_LATENCY_DIVIDER, t);
                 dvfs_change_direction = -1;
         }
 
 	//spin_unlock_irqrestore(&g_cpufreq_lock, irqflags);
 	cpufreq_notify_transition(&freqs, CPUFREQ_POSTCHANGE);
+	lat[DVFS_LATENCY_TOTAL] = ktime_us_delta(ktime_get(), start);
+	dvfs_latency_record(index < prevIndex, lat);
+	trace_s5pc110_dvfs_transition(req_freq, prevIndex, index,
+				      dvfs_floor_index, s5pc11x_cpufreq_level,
+				      lat[DVFS_LATENCY_TOTAL]);
 	prevIndex = index; // save to preIndex
 
 	mpu_clk->rate = freqs.new * KHZ_T;
@@ -698,7 +1058,6 @@ unsigned int get_min_cpufreq(void)
 
 static int __init s5pc110_cpu_init(struct cpufreq_policy *policy)
 {
-	u32 i;
 	extern int s5pc110_verion ;
 	//unsigned long irqflags;
 
@@ -746,7 +1105,6 @@ static int __init s5pc110_cpu_init(struct cpufreq_policy *policy)
 		S5PC11X_FREQ_TAB = 0;
 		S5PC11X_MAXFREQLEVEL = 6;
 		MAXFREQ_LEVEL_SUPPORTED = 6;
-		g_dvfs_high_lock_limit = 4;
 	}
 	else
 	{
@@ -754,7 +1112,6 @@ static int __init s5pc110_cpu_init(struct cpufreq_policy *policy)
 		S5PC11X_FREQ_TAB = 1;
 		S5PC11X_MAXFREQLEVEL = 3; /* Min Freq. 200Mhz */
 		MAXFREQ_LEVEL_SUPPORTED = 4;
-		g_dvfs_high_lock_limit = 3;		
 	}
 
 #endif
@@ -780,12 +1137,6 @@ static int __init s5pc110_cpu_init(struct cpufreq_policy *policy)
 	//register_early_suspend(&s5pc11x_freq_suspend);	
 #endif
 
-	#if ENABLE_DVFS_LOCK_HIGH
-	/*initialise the dvfs lock level table*/
-	for(i = 0; i < NUMBER_OF_LOCKTOKEN; i++)
-		g_dvfslockval[i] = MAXFREQ_LEVEL_SUPPORTED-1;
-	#endif
-
 
 	return cpufreq_frequency_table_cpuinfo(policy, s5pc110_freq_table[S5PC11X_FREQ_TAB]);
 }
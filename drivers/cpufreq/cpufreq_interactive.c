@@ -0,0 +1,618 @@
+/*
+ *  drivers/cpufreq/cpufreq_interactive.c
+ *
+ *  Copyright (C) 2010 Samsung Electronics
+ *
+ *  Based on cpufreq_conservative.c and cpufreq_ondemand.c
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/init.h>
+#include <linux/cpufreq.h>
+#include <linux/cpu.h>
+#include <linux/sysfs.h>
+#include <linux/timer.h>
+#include <linux/tick.h>
+#include <linux/input.h>
+#include <linux/workqueue.h>
+#include <linux/jiffies.h>
+#include <linux/kernel_stat.h>
+#include <linux/percpu.h>
+#include <linux/mutex.h>
+
+/*
+ * The interactive governor samples the load of a CPU on a short timer and
+ * jumps to hispeed_freq as soon as the CPU is busy or an input event (touch,
+ * key) arrives, instead of walking up one step per sample the way the
+ * conservative governor does.  Once raised, a frequency is held for at least
+ * min_sample_time before it is stepped down again, one level at a time.
+ *
+ * While the CPU runs at policy->min the sample timer is deferrable, so an
+ * idle CPU is not woken up just to be told that it is idle.  Above the
+ * minimum a normal timer is used so an idle CPU still gets stepped down.
+ */
+
+#define DEF_TIMER_RATE			(20 * 1000)	/* uS */
+#define DEF_MIN_SAMPLE_TIME		(80 * 1000)	/* uS */
+#define DEF_GO_HISPEED_LOAD		(85)
+#define DEF_DOWN_LOAD			(40)
+#define MIN_TIMER_RATE			(10 * 1000)
+#define TRANSITION_LATENCY_LIMIT	(10 * 1000 * 1000)
+
+#ifdef CONFIG_CPU_S5PC110
+#define DEF_HISPEED_FREQ		(800 * 1000)
+extern unsigned int s5pc11x_target_frq(unsigned int pred_freq, int flag);
+extern int dvfs_change_quick;
+#else
+#define DEF_HISPEED_FREQ		(0)	/* policy->max */
+#endif
+
+struct cpu_interactive_info {
+	struct cpufreq_policy *policy;
+	struct timer_list idle_timer;	/* deferrable, used at policy->min */
+	struct timer_list busy_timer;	/* used above policy->min */
+	struct work_struct work;
+	u64 prev_idle;
+	u64 prev_wall;
+	unsigned long hold_until;	/* jiffies, no step down before this */
+	unsigned int load;
+	int boost;
+	int enable;
+};
+static DEFINE_PER_CPU(struct cpu_interactive_info, cpu_interactive_info);
+
+static unsigned int interactive_enable;	/* number of CPUs using this policy */
+static int interactive_input_registered;
+
+/*
+ * interactive_mutex protects the tunables and serializes frequency changes
+ * between the sample work and the governor callbacks.
+ */
+static DEFINE_MUTEX(interactive_mutex);
+static struct workqueue_struct *interactive_wq;
+
+static struct interactive_tuners {
+	unsigned int timer_rate;
+	unsigned int min_sample_time;
+	unsigned int hispeed_freq;
+	unsigned int go_hispeed_load;
+	unsigned int down_load;
+	unsigned int input_boost;
+} interactive_tuners_ins = {
+	.timer_rate = DEF_TIMER_RATE,
+	.min_sample_time = DEF_MIN_SAMPLE_TIME,
+	.hispeed_freq = DEF_HISPEED_FREQ,
+	.go_hispeed_load = DEF_GO_HISPEED_LOAD,
+	.down_load = DEF_DOWN_LOAD,
+	.input_boost = 1,
+};
+
+static inline u64 get_cpu_idle_time_jiffy(unsigned int cpu, u64 *wall)
+{
+	cputime64_t busy_time;
+
+	busy_time = cputime64_add(kstat_cpu(cpu).cpustat.user,
+			kstat_cpu(cpu).cpustat.system);
+	busy_time = cputime64_add(busy_time, kstat_cpu(cpu).cpustat.irq);
+	busy_time = cputime64_add(busy_time, kstat_cpu(cpu).cpustat.softirq);
+	busy_time = cputime64_add(busy_time, kstat_cpu(cpu).cpustat.steal);
+	busy_time = cputime64_add(busy_time, kstat_cpu(cpu).cpustat.nice);
+
+	*wall = jiffies_to_usecs(get_jiffies_64());
+	return *wall - jiffies_to_usecs(busy_time);
+}
+
+static inline u64 get_cpu_idle_time(unsigned int cpu, u64 *wall)
+{
+	u64 idle_time = get_cpu_idle_time_us(cpu, wall);
+
+	if (idle_time == -1ULL)
+		return get_cpu_idle_time_jiffy(cpu, wall);
+
+	return idle_time;
+}
+
+static inline unsigned int hispeed_freq(struct cpufreq_policy *policy)
+{
+	unsigned int freq = interactive_tuners_ins.hispeed_freq;
+
+	if (!freq || freq > policy->max)
+		freq = policy->max;
+	if (freq < policy->min)
+		freq = policy->min;
+
+	return freq;
+}
+
+/*
+ * One step up or down from the current frequency.  On S5PC110 this goes
+ * through the platform transition table, which also applies the DVFS floor
+ * and the early-suspend level limit.
+ */
+static unsigned int interactive_step(struct cpufreq_policy *policy, int dir)
+{
+#ifdef CONFIG_CPU_S5PC110
+	return s5pc11x_target_frq(policy->cur, dir);
+#else
+	struct cpufreq_frequency_table *table;
+	unsigned int index;
+
+	table = cpufreq_frequency_get_table(policy->cpu);
+	if (!table)
+		return dir > 0 ? policy->max : policy->min;
+
+	if (cpufreq_frequency_table_target(policy, table,
+			dir > 0 ? policy->cur + 1 : policy->cur - 1,
+			dir > 0 ? CPUFREQ_RELATION_L : CPUFREQ_RELATION_H,
+			&index))
+		return policy->cur;
+
+	return table[index].frequency;
+#endif
+}
+
+static void interactive_timer_start(struct cpu_interactive_info *info)
+{
+	unsigned long delay = usecs_to_jiffies(interactive_tuners_ins.timer_rate);
+
+	if (info->policy->cur > info->policy->min) {
+		del_timer(&info->idle_timer);
+		mod_timer(&info->busy_timer, jiffies + delay);
+	} else {
+		del_timer(&info->busy_timer);
+		mod_timer(&info->idle_timer, jiffies + delay);
+	}
+}
+
+static void interactive_timer_stop(struct cpu_interactive_info *info)
+{
+	del_timer_sync(&info->idle_timer);
+	del_timer_sync(&info->busy_timer);
+}
+
+static void interactive_timer(unsigned long data)
+{
+	struct cpu_interactive_info *info = &per_cpu(cpu_interactive_info, data);
+
+	queue_work(interactive_wq, &info->work);
+}
+
+static void interactive_check_cpu(unsigned int cpu)
+{
+	struct cpu_interactive_info *info = &per_cpu(cpu_interactive_info, cpu);
+	struct cpufreq_policy *policy = info->policy;
+	unsigned int new_freq, load;
+	unsigned int delta_idle, delta_wall;
+	u64 cur_idle, cur_wall;
+	int quick = 0;
+
+	cur_idle = get_cpu_idle_time(cpu, &cur_wall);
+	delta_idle = (unsigned int)(cur_idle - info->prev_idle);
+	delta_wall = (unsigned int)(cur_wall - info->prev_wall);
+	info->prev_idle = cur_idle;
+	info->prev_wall = cur_wall;
+
+	if (!delta_wall || delta_idle > delta_wall)
+		load = 0;
+	else
+		load = 100 * (delta_wall - delta_idle) / delta_wall;
+	info->load = load;
+
+#ifdef CONFIG_CPU_S5PC110
+	/* a DVFS floor was raised, re-evaluate through the platform table */
+	if (dvfs_change_quick) {
+		dvfs_change_quick = 0;
+		quick = 1;
+	}
+#endif
+
+	if (info->boost) {
+		info->boost = 0;
+		new_freq = max(policy->cur, hispeed_freq(policy));
+		/* touch raises a DVFS floor too, which may be above hispeed */
+		if (quick)
+			new_freq = max(new_freq, interactive_step(policy, 1));
+	} else if (load >= interactive_tuners_ins.go_hispeed_load || quick) {
+		/*
+		 * Always go through interactive_step() so a DVFS floor
+		 * takes effect on this sample, not the next one.
+		 */
+		new_freq = interactive_step(policy, 1);
+		if (policy->cur < hispeed_freq(policy))
+			new_freq = max(new_freq, hispeed_freq(policy));
+	} else if (load < interactive_tuners_ins.down_load &&
+			time_after_eq(jiffies, info->hold_until)) {
+		new_freq = interactive_step(policy, -1);
+	} else {
+		return;
+	}
+
+	if (new_freq > policy->max)
+		new_freq = policy->max;
+	if (new_freq < policy->min)
+		new_freq = policy->min;
+
+	if (new_freq > policy->cur)
+		info->hold_until = jiffies +
+			usecs_to_jiffies(interactive_tuners_ins.min_sample_time);
+
+	if (new_freq != policy->cur)
+		__cpufreq_driver_target(policy, new_freq, CPUFREQ_RELATION_H);
+}
+
+static void do_interactive_work(struct work_struct *work)
+{
+	struct cpu_interactive_info *info =
+		container_of(work, struct cpu_interactive_info, work);
+
+	mutex_lock(&interactive_mutex);
+	if (info->enable) {
+		interactive_check_cpu(info->policy->cpu);
+		interactive_timer_start(info);
+	}
+	mutex_unlock(&interactive_mutex);
+}
+
+/************************** input boost ************************/
+static void interactive_input_event(struct input_handle *handle,
+		unsigned int type, unsigned int code, int value)
+{
+	unsigned int cpu;
+
+	if (!interactive_tuners_ins.input_boost)
+		return;
+
+	if (type != EV_ABS && type != EV_KEY)
+		return;
+
+	for_each_online_cpu(cpu) {
+		struct cpu_interactive_info *info =
+			&per_cpu(cpu_interactive_info, cpu);
+
+		if (!info->enable)
+			continue;
+
+		/* keep hispeed for as long as the user keeps interacting */
+		info->hold_until = jiffies +
+			usecs_to_jiffies(interactive_tuners_ins.min_sample_time);
+
+		if (info->policy->cur >= hispeed_freq(info->policy))
+			continue;
+
+		info->boost = 1;
+		queue_work(interactive_wq, &info->work);
+	}
+}
+
+static int interactive_input_connect(struct input_handler *handler,
+		struct input_dev *dev, const struct input_device_id *id)
+{
+	struct input_handle *handle;
+	int error;
+
+	handle = kzalloc(sizeof(struct input_handle), GFP_KERNEL);
+	if (!handle)
+		return -ENOMEM;
+
+	handle->dev = dev;
+	handle->handler = handler;
+	handle->name = "cpufreq_interactive";
+
+	error = input_register_handle(handle);
+	if (error)
+		goto err_free;
+
+	error = input_open_device(handle);
+	if (error)
+		goto err_unregister;
+
+	return 0;
+
+err_unregister:
+	input_unregister_handle(handle);
+err_free:
+	kfree(handle);
+	return error;
+}
+
+static void interactive_input_disconnect(struct input_handle *handle)
+{
+	input_close_device(handle);
+	input_unregister_handle(handle);
+	kfree(handle);
+}
+
+static const struct input_device_id interactive_input_ids[] = {
+	{	/* touchscreens */
+		.flags = INPUT_DEVICE_ID_MATCH_EVBIT |
+			 INPUT_DEVICE_ID_MATCH_ABSBIT,
+		.evbit = { BIT_MASK(EV_ABS) },
+		.absbit = { [BIT_WORD(ABS_X)] = BIT_MASK(ABS_X) },
+	},
+	{	/* keys */
+		.flags = INPUT_DEVICE_ID_MATCH_EVBIT,
+		.evbit = { BIT_MASK(EV_KEY) },
+	},
+	{ },
+};
+
+static struct input_handler interactive_input_handler = {
+	.event =	interactive_input_event,
+	.connect =	interactive_input_connect,
+	.disconnect =	interactive_input_disconnect,
+	.name =		"cpufreq_interactive",
+	.id_table =	interactive_input_ids,
+};
+
+/************************** sysfs interface ************************/
+#define show_one(file_name, object)					\
+static ssize_t show_##file_name						\
+(struct cpufreq_policy *unused, char *buf)				\
+{									\
+	return sprintf(buf, "%u\n", interactive_tuners_ins.object);	\
+}
+show_one(timer_rate, timer_rate);
+show_one(min_sample_time, min_sample_time);
+show_one(hispeed_freq, hispeed_freq);
+show_one(go_hispeed_load, go_hispeed_load);
+show_one(down_load, down_load);
+show_one(input_boost, input_boost);
+
+static ssize_t store_timer_rate(struct cpufreq_policy *unused,
+		const char *buf, size_t count)
+{
+	unsigned int input;
+	int ret;
+	ret = sscanf(buf, "%u", &input);
+	if (ret != 1 || input < MIN_TIMER_RATE)
+		return -EINVAL;
+
+	mutex_lock(&interactive_mutex);
+	interactive_tuners_ins.timer_rate = input;
+	mutex_unlock(&interactive_mutex);
+
+	return count;
+}
+
+static ssize_t store_min_sample_time(struct cpufreq_policy *unused,
+		const char *buf, size_t count)
+{
+	unsigned int input;
+	int ret;
+	ret = sscanf(buf, "%u", &input);
+	if (ret != 1)
+		return -EINVAL;
+
+	mutex_lock(&interactive_mutex);
+	interactive_tuners_ins.min_sample_time = input;
+	mutex_unlock(&interactive_mutex);
+
+	return count;
+}
+
+static ssize_t store_hispeed_freq(struct cpufreq_policy *unused,
+		const char *buf, size_t count)
+{
+	unsigned int input;
+	int ret;
+	ret = sscanf(buf, "%u", &input);
+	if (ret != 1)
+		return -EINVAL;
+
+	mutex_lock(&interactive_mutex);
+	interactive_tuners_ins.hispeed_freq = input;
+	mutex_unlock(&interactive_mutex);
+
+	return count;
+}
+
+static ssize_t store_go_hispeed_load(struct cpufreq_policy *unused,
+		const char *buf, size_t count)
+{
+	unsigned int input;
+	int ret;
+	ret = sscanf(buf, "%u", &input);
+
+	mutex_lock(&interactive_mutex);
+	if (ret != 1 || input > 100 ||
+			input <= interactive_tuners_ins.down_load) {
+		mutex_unlock(&interactive_mutex);
+		return -EINVAL;
+	}
+
+	interactive_tuners_ins.go_hispeed_load = input;
+	mutex_unlock(&interactive_mutex);
+
+	return count;
+}
+
+static ssize_t store_down_load(struct cpufreq_policy *unused,
+		const char *buf, size_t count)
+{
+	unsigned int input;
+	int ret;
+	ret = sscanf(buf, "%u", &input);
+
+	mutex_lock(&interactive_mutex);
+	if (ret != 1 || input >= interactive_tuners_ins.go_hispeed_load) {
+		mutex_unlock(&interactive_mutex);
+		return -EINVAL;
+	}
+
+	interactive_tuners_ins.down_load = input;
+	mutex_unlock(&interactive_mutex);
+
+	return count;
+}
+
+static ssize_t store_input_boost(struct cpufreq_policy *unused,
+		const char *buf, size_t count)
+{
+	unsigned int input;
+	int ret;
+	ret = sscanf(buf, "%u", &input);
+	if (ret != 1)
+		return -EINVAL;
+
+	interactive_tuners_ins.input_boost = !!input;
+
+	return count;
+}
+
+#define define_one_rw(_name) \
+static struct freq_attr _name = \
+__ATTR(_name, 0644, show_##_name, store_##_name)
+
+define_one_rw(timer_rate);
+define_one_rw(min_sample_time);
+define_one_rw(hispeed_freq);
+define_one_rw(go_hispeed_load);
+define_one_rw(down_load);
+define_one_rw(input_boost);
+
+static struct attribute * interactive_attributes[] = {
+	&timer_rate.attr,
+	&min_sample_time.attr,
+	&hispeed_freq.attr,
+	&go_hispeed_load.attr,
+	&down_load.attr,
+	&input_boost.attr,
+	NULL
+};
+
+static struct attribute_group interactive_attr_group = {
+	.attrs = interactive_attributes,
+	.name = "interactive",
+};
+
+/************************** sysfs end ************************/
+
+static int cpufreq_governor_interactive(struct cpufreq_policy *policy,
+				   unsigned int event)
+{
+	unsigned int cpu = policy->cpu;
+	struct cpu_interactive_info *this_info;
+	int rc;
+
+	this_info = &per_cpu(cpu_interactive_info, cpu);
+
+	switch (event) {
+	case CPUFREQ_GOV_START:
+		if ((!cpu_online(cpu)) || (!policy->cur))
+			return -EINVAL;
+
+		if (this_info->enable) /* Already enabled */
+			break;
+
+		mutex_lock(&interactive_mutex);
+
+		rc = sysfs_create_group(&policy->kobj, &interactive_attr_group);
+		if (rc) {
+			mutex_unlock(&interactive_mutex);
+			return rc;
+		}
+
+		if (interactive_enable == 0) {
+			rc = input_register_handler(&interactive_input_handler);
+			if (rc)
+				printk(KERN_WARNING "cpufreq_interactive: "
+					"no input boost, error %d\n", rc);
+			else
+				interactive_input_registered = 1;
+		}
+
+		this_info->policy = policy;
+		this_info->prev_idle = get_cpu_idle_time(cpu,
+						&this_info->prev_wall);
+		this_info->hold_until = jiffies;
+		this_info->boost = 0;
+		this_info->enable = 1;
+		interactive_enable++;
+
+		interactive_timer_start(this_info);
+		mutex_unlock(&interactive_mutex);
+		break;
+
+	case CPUFREQ_GOV_STOP:
+		mutex_lock(&interactive_mutex);
+		this_info->enable = 0;
+		sysfs_remove_group(&policy->kobj, &interactive_attr_group);
+		interactive_enable--;
+		if (interactive_enable == 0 && interactive_input_registered) {
+			input_unregister_handler(&interactive_input_handler);
+			interactive_input_registered = 0;
+		}
+		mutex_unlock(&interactive_mutex);
+
+		interactive_timer_stop(this_info);
+		cancel_work_sync(&this_info->work);
+		break;
+
+	case CPUFREQ_GOV_LIMITS:
+		mutex_lock(&interactive_mutex);
+		if (policy->max < this_info->policy->cur)
+			__cpufreq_driver_target(this_info->policy,
+					policy->max, CPUFREQ_RELATION_H);
+		else if (policy->min > this_info->policy->cur)
+			__cpufreq_driver_target(this_info->policy,
+					policy->min, CPUFREQ_RELATION_L);
+		mutex_unlock(&interactive_mutex);
+		break;
+	}
+	return 0;
+}
+
+#ifndef CONFIG_CPU_FREQ_DEFAULT_GOV_INTERACTIVE
+static
+#endif
+struct cpufreq_governor cpufreq_gov_interactive = {
+	.name			= "interactive",
+	.governor		= cpufreq_governor_interactive,
+	.max_transition_latency	= TRANSITION_LATENCY_LIMIT,
+	.owner			= THIS_MODULE,
+};
+
+static int __init cpufreq_gov_interactive_init(void)
+{
+	unsigned int cpu;
+
+	interactive_wq = create_singlethread_workqueue("kinteractive");
+	if (!interactive_wq)
+		return -ENOMEM;
+
+	for_each_possible_cpu(cpu) {
+		struct cpu_interactive_info *info =
+			&per_cpu(cpu_interactive_info, cpu);
+
+		setup_timer(&info->busy_timer, interactive_timer, cpu);
+		init_timer_deferrable(&info->idle_timer);
+		info->idle_timer.function = interactive_timer;
+		info->idle_timer.data = cpu;
+		INIT_WORK(&info->work, do_interactive_work);
+	}
+
+	return cpufreq_register_governor(&cpufreq_gov_interactive);
+}
+
+static void __exit cpufreq_gov_interactive_exit(void)
+{
+	cpufreq_unregister_governor(&cpufreq_gov_interactive);
+	destroy_workqueue(interactive_wq);
+}
+
+
+MODULE_DESCRIPTION ("'cpufreq_interactive' - A cpufreq governor that "
+		"ramps to a high speed on load and on input events");
+MODULE_LICENSE ("GPL");
+
+#ifdef CONFIG_CPU_FREQ_DEFAULT_GOV_INTERACTIVE
+fs_initcall(cpufreq_gov_interactive_init);
+#else
+module_init(cpufreq_gov_interactive_init);
+#endif
+module_exit(cpufreq_gov_interactive_exit);
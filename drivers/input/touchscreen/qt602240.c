@@ -4693,6 +4693,10 @@ uint8_t QT_Boot(void);
 
 #define USE_PERF_LEVEL_TS 1
 
+#ifdef CONFIG_CPU_FREQ
+static DEFINE_DVFS_FLOOR(touch_dvfs_floor, "touch");
+#endif
+
 #define USE_TS_EARLY_SUSPEND 1
 
 #define USE_TS_TA_DETECT_CHANGE_REG 1 //sooo.shin
@@ -8330,8 +8334,10 @@ void  get_message(struct work_struct * p)
 						if ( fingerInfo[i].pressure == -1 ) continue;
 
 						if(i == 0){
-							s5pc110_unlock_dvfs_high_level(DVFS_LOCK_TOKEN_4);
+						#ifdef CONFIG_CPU_FREQ
+							s5pc110_dvfs_floor_release(&touch_dvfs_floor);
 							set_dvfs_perf_level();
+						#endif
 							touch_state_val=0;
 							}
 						fingerInfo[i].pressure= 0;
@@ -8424,7 +8430,7 @@ void  get_message(struct work_struct * p)
 			#ifdef CONFIG_CPU_FREQ
 			#if USE_PERF_LEVEL_TS
 				if(id == 0){
-				s5pc110_unlock_dvfs_high_level(DVFS_LOCK_TOKEN_4);
+				s5pc110_dvfs_floor_release(&touch_dvfs_floor);
 				set_dvfs_perf_level();
 					touch_state_val=0;
 					}
@@ -8443,7 +8449,7 @@ void  get_message(struct work_struct * p)
 			#if USE_PERF_LEVEL_TS
 				if(id == 0){
 				set_dvfs_perf_level();
-				s5pc110_lock_dvfs_high_level(DVFS_LOCK_TOKEN_4,0);
+				s5pc110_dvfs_floor_request(&touch_dvfs_floor, 1000000);
 					touch_state_val=1;
 					}
 			#endif
@@ -8478,7 +8484,7 @@ void  get_message(struct work_struct * p)
 			#if USE_PERF_LEVEL_TS
 			if(id == 0){
 				set_dvfs_perf_level();
-				s5pc110_lock_dvfs_high_level(DVFS_LOCK_TOKEN_4,0);
+				s5pc110_dvfs_floor_request(&touch_dvfs_floor, 1000000);
 				}
 			#endif
 			#endif
@@ -8499,7 +8505,7 @@ void  get_message(struct work_struct * p)
 			#ifdef CONFIG_CPU_FREQ
 			#if USE_PERF_LEVEL_TS
 				if(id == 0){
-				s5pc110_unlock_dvfs_high_level(DVFS_LOCK_TOKEN_4);
+				s5pc110_dvfs_floor_release(&touch_dvfs_floor);
 				set_dvfs_perf_level();
 					}
 			#endif
@@ -37,6 +37,8 @@
 
 #ifdef CONFIG_CPU_FREQ
 #include <plat/s5pc11x-dvfs.h>
+
+static DEFINE_DVFS_FLOOR(fimc_dvfs_floor, "fimc0");
 #endif
 
 #include "fimc.h"
@@ -533,7 +535,7 @@ static int fimc_open(struct file *filp)
 #ifdef CONFIG_CPU_FREQ
 	// added by jamie to set minimum cpu freq (2009.10.30)
 	if (0 == ctrl->id)
-    	s5pc110_lock_dvfs_high_level(DVFS_LOCK_TOKEN_2, 2);
+    	s5pc110_dvfs_floor_request(&fimc_dvfs_floor, 600000);
 #endif 
 
 #ifdef CLEAR_FIMC2_BUFF
@@ -598,7 +600,7 @@ static int fimc_release(struct file *filp)
 #ifdef CONFIG_CPU_FREQ
 	// added by jamie to set minimum cpu freq (2009.10.30)
 	if (0 == ctrl->id)
-		s5pc110_unlock_dvfs_high_level(DVFS_LOCK_TOKEN_2);
+		s5pc110_dvfs_floor_release(&fimc_dvfs_floor);
 #endif
 
 	fimc_clk_en(ctrl, false);
@@ -66,6 +66,9 @@
 static struct resource *mfc_mem;
 static struct mutex mfc_mutex;
 static struct clk *mfc_clk;
+#ifdef CONFIG_CPU_FREQ
+static DEFINE_DVFS_FLOOR(mfc_dvfs_floor, "mfc");
+#endif
 
 static int mfc_open(struct inode *inode, struct file *file)
 {
@@ -79,7 +82,7 @@ static int mfc_open(struct inode *inode, struct file *file)
 	if (!mfc_is_running())
 	{
 #ifdef CONFIG_CPU_FREQ
-		s5pc110_lock_dvfs_high_level(DVFS_LOCK_TOKEN_1, 1);
+		s5pc110_dvfs_floor_request(&mfc_dvfs_floor, 800000);
 #endif
 #ifdef CONFIG_S5PC11X_LPAUDIO
 		s5pc110_set_lpaudio_lock(1);
@@ -201,7 +204,7 @@ out_release:
 	if (!mfc_is_running())
 	{
 #ifdef CONFIG_CPU_FREQ
-		s5pc110_unlock_dvfs_high_level(DVFS_LOCK_TOKEN_1);
+		s5pc110_dvfs_floor_release(&mfc_dvfs_floor);
 #endif
 #ifdef CONFIG_PM_PWR_GATING
 		s5pc110_unlock_power_domain(MFC_DOMAIN_LOCK_TOKEN);
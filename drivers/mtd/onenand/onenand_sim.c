@@ -35,6 +35,11 @@ static int manuf_id	= CONFIG_ONENAND_SIM_MANUFACTURER;
 static int device_id	= CONFIG_ONENAND_SIM_DEVICE_ID;
 static int version_id	= CONFIG_ONENAND_SIM_VERSION_ID;
 
+/* e.g. device_id=0x34 for a 2Gb part with 2 planes (2X program) */
+module_param(manuf_id, int, 0444);
+module_param(device_id, int, 0444);
+module_param(version_id, int, 0444);
+
 struct onenand_flash {
 	void __iomem *base;
 	void __iomem *data;
@@ -170,6 +175,7 @@ static void onenand_update_interrupt(struct onenand_chip *this, int cmd)
 
 	case ONENAND_CMD_PROG:
 	case ONENAND_CMD_PROGOOB:
+	case ONENAND_CMD_2X_PROG:
 		interrupt |= ONENAND_INT_WRITE;
 		break;
 
@@ -233,8 +239,9 @@ static void onenand_data_handle(struct onenand_chip *this, int cmd,
 	void __iomem *dest;
 	unsigned int i;
 
+	/* Note: the 'this->writesize' is a real page size */
 	if (dataram) {
-		main_offset = mtd->writesize;
+		main_offset = this->writesize;
 		spare_offset = mtd->oobsize;
 	} else {
 		main_offset = 0;
@@ -245,7 +252,7 @@ static void onenand_data_handle(struct onenand_chip *this, int cmd,
 	case ONENAND_CMD_READ:
 		src = ONENAND_CORE(flash) + offset;
 		dest = ONENAND_MAIN_AREA(this, main_offset);
-		memcpy(dest, src, mtd->writesize);
+		memcpy(dest, src, this->writesize);
 		/* Fall through */
 
 	case ONENAND_CMD_READOOB:
@@ -258,7 +265,7 @@ static void onenand_data_handle(struct onenand_chip *this, int cmd,
 		src = ONENAND_MAIN_AREA(this, main_offset);
 		dest = ONENAND_CORE(flash) + offset;
 		/* To handle partial write */
-		for (i = 0; i < (1 << mtd->subpage_sft); i++) {
+		for (i = 0; i < this->writesize / this->subpagesize; i++) {
 			int off = i * this->subpagesize;
 			if (!memcmp(src + off, ffchars, this->subpagesize))
 				continue;
@@ -283,10 +290,21 @@ static void onenand_data_handle(struct onenand_chip *this, int cmd,
 		memcpy(dest, src, mtd->oobsize);
 		break;
 
+	case ONENAND_CMD_2X_PROG:
+		/*
+		 * Plane0 (the even block) is programmed from DataRAM0,
+		 * plane1 (the odd block) from DataRAM1 at the same page.
+		 */
+		onenand_data_handle(this, ONENAND_CMD_PROG, 0, offset);
+		onenand_data_handle(this, ONENAND_CMD_PROG, 1,
+				    offset + (1 << this->erase_shift));
+		break;
+
 	case ONENAND_CMD_ERASE:
-		memset(ONENAND_CORE(flash) + offset, 0xff, mtd->erasesize);
+		/* mtd->erasesize is doubled in 2X program mode */
+		memset(ONENAND_CORE(flash) + offset, 0xff, 1 << this->erase_shift);
 		memset(ONENAND_CORE_SPARE(flash, this, offset), 0xff,
-		       (mtd->erasesize >> 5));
+		       (1 << this->erase_shift) >> 5);
 		break;
 
 	default:
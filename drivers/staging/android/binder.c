@@ -19,6 +19,7 @@
 #include <linux/fdtable.h>
 #include <linux/file.h>
 #include <linux/fs.h>
+#include <linux/highmem.h>
 #include <linux/list.h>
 #include <linux/miscdevice.h>
 #include <linux/mm.h>
@@ -29,8 +30,10 @@
 #include <linux/proc_fs.h>
 #include <linux/rbtree.h>
 #include <linux/sched.h>
+#include <linux/seq_file.h>
 #include <linux/uaccess.h>
 #include <linux/vmalloc.h>
+#include <trace/binder.h>
 #include "binder.h"
 
 static DEFINE_MUTEX(binder_lock);
@@ -41,17 +44,22 @@ static int binder_last_id;
 static struct proc_dir_entry *binder_proc_dir_entry_root;
 static struct proc_dir_entry *binder_proc_dir_entry_proc;
 static struct hlist_head binder_dead_nodes;
+static LIST_HEAD(binder_lru);
+static int binder_lru_count;
 static HLIST_HEAD(binder_deferred_list);
 static DEFINE_MUTEX(binder_deferred_lock);
 
-static int binder_read_proc_proc(
-	char *page, char **start, off_t off, int count, int *eof, void *data);
+static const struct file_operations binder_proc_fops;
 
 /* This is only defined in include/asm-arm/sizes.h */
 #ifndef SZ_1K
 #define SZ_1K                               0x400
 #endif
 
+#ifndef SZ_1M
+#define SZ_1M                               0x100000
+#endif
+
 #ifndef SZ_4M
 #define SZ_4M                               0x400000
 #endif
@@ -60,6 +68,19 @@ static int binder_read_proc_proc(
 
 #define BINDER_SMALL_BUF_SIZE (PAGE_SIZE * 64)
 
+/*
+ * Transactions whose data and offsets fit in this many bytes are copied from
+ * the sender into a per-thread buffer before binder_lock is taken, so a page
+ * fault on the sender's parcel never stalls every other binder user.
+ */
+#define BINDER_PREFETCH_SIZE                PAGE_SIZE
+
+/*
+ * Larger data, up to this size, is not staged but its pages are pinned with
+ * binder_lock dropped, and copied page by page from the kernel mapping.
+ */
+#define BINDER_PIN_MAX_SIZE                 SZ_1M
+
 enum {
 	BINDER_DEBUG_USER_ERROR             = 1U << 0,
 	BINDER_DEBUG_FAILED_TRANSACTION     = 1U << 1,
@@ -140,7 +161,7 @@ struct binder_transaction_log_entry {
 struct binder_transaction_log {
 	int next;
 	int full;
-	struct binder_transaction_log_entry entry[32];
+	struct binder_transaction_log_entry entry[256];
 };
 struct binder_transaction_log binder_transaction_log;
 struct binder_transaction_log binder_transaction_log_failed;
@@ -159,6 +180,43 @@ static struct binder_transaction_log_entry *binder_transaction_log_add(
 	return e;
 }
 
+/*
+ * Log2 latency histogram in microseconds: bucket 0 counts samples below
+ * 1 << BINDER_LATENCY_SHIFT us and each following bucket doubles the range,
+ * the last one collecting everything from about one second up.
+ */
+#define BINDER_LATENCY_SHIFT   4
+#define BINDER_LATENCY_BUCKETS 18
+
+enum {
+	BINDER_LATENCY_QUEUE,	/* queued until picked up by a thread */
+	BINDER_LATENCY_HANDLE,	/* picked up until the reply is sent */
+	BINDER_LATENCY_REPLY,	/* queued until the reply is sent (node), */
+				/* or picked up by the caller (proc) */
+	BINDER_LATENCY_COUNT
+};
+
+struct binder_latency {
+	u32 count[BINDER_LATENCY_BUCKETS];
+	u64 total_us;
+};
+
+static void binder_latency_add(struct binder_latency *latency, s64 us)
+{
+	u64 v;
+	int i = 0;
+
+	if (us < 0)
+		us = 0;
+	latency->total_us += us;
+	v = (u64)us >> BINDER_LATENCY_SHIFT;
+	while (v && i < BINDER_LATENCY_BUCKETS - 1) {
+		v >>= 1;
+		i++;
+	}
+	latency->count[i]++;
+}
+
 struct binder_work {
 	struct list_head entry;
 	enum {
@@ -193,6 +251,7 @@ struct binder_node {
 	unsigned accept_fds : 1;
 	int min_priority : 8;
 	struct list_head async_todo;
+	struct binder_latency latency[BINDER_LATENCY_COUNT];
 };
 
 struct binder_ref_death {
@@ -234,6 +293,18 @@ struct binder_buffer {
 	uint8_t data[0];
 };
 
+/*
+ * A page of a proc's buffer area. Pages no longer covered by any buffer stay
+ * mapped and are put on binder_lru so the next allocation can reuse them
+ * without touching the page tables; binder_lru_shrink releases them under
+ * memory pressure.
+ */
+struct binder_lru_page {
+	struct list_head lru;
+	struct page *page_ptr;
+	struct binder_proc *proc;
+};
+
 enum {
 	BINDER_DEFERRED_PUT_FILES    = 0x01,
 	BINDER_DEFERRED_FLUSH        = 0x02,
@@ -260,12 +331,13 @@ struct binder_proc {
 	struct rb_root allocated_buffers;
 	size_t free_async_space;
 
-	struct page **pages;
+	struct binder_lru_page *pages;
 	size_t buffer_size;
 	uint32_t buffer_free;
 	struct list_head todo;
 	wait_queue_head_t wait;
 	struct binder_stats stats;
+	struct binder_latency latency[BINDER_LATENCY_COUNT];
 	struct list_head delivered_death;
 	int max_threads;
 	int requested_threads;
@@ -296,6 +368,7 @@ struct binder_thread {
 		/* we are also waiting on */
 	wait_queue_head_t wait;
 	struct binder_stats stats;
+	void *prefetch_buf; /* BINDER_PREFETCH_SIZE, allocated on first use */
 };
 
 struct binder_transaction {
@@ -315,10 +388,17 @@ struct binder_transaction {
 	long	priority;
 	long	saved_priority;
 	uid_t	sender_euid;
+	ktime_t	enqueue_time;
+	ktime_t	dequeue_time;
+	ktime_t	call_time; /* enqueue_time of the call this replies to */
 };
 
 static void binder_defer_work(struct binder_proc *proc, int defer);
 
+DEFINE_TRACE(binder_transaction_enqueue);
+DEFINE_TRACE(binder_transaction_dequeue);
+DEFINE_TRACE(binder_transaction_reply);
+
 /*
  * copied from get_unused_fd_flags
  */
@@ -572,8 +652,10 @@ static int binder_update_page_range(struct binder_proc *proc, int allocate,
 	void *page_addr;
 	unsigned long user_page_addr;
 	struct vm_struct tmp_area;
+	struct binder_lru_page *lru_page;
 	struct page **page;
 	struct mm_struct *mm;
+	int need_map = 0;
 
 	if (binder_debug_mask & BINDER_DEBUG_BUFFER_ALLOC)
 		printk(KERN_INFO "binder: %d: %s pages %p-%p\n",
@@ -582,6 +664,29 @@ static int binder_update_page_range(struct binder_proc *proc, int allocate,
 	if (end <= start)
 		return 0;
 
+	if (allocate == 0) {
+		for (page_addr = start; page_addr < end;
+		     page_addr += PAGE_SIZE) {
+			lru_page = &proc->pages[(page_addr - proc->buffer) /
+						PAGE_SIZE];
+			BUG_ON(!lru_page->page_ptr);
+			BUG_ON(!list_empty(&lru_page->lru));
+			list_add_tail(&lru_page->lru, &binder_lru);
+			binder_lru_count++;
+		}
+		return 0;
+	}
+
+	for (page_addr = start; page_addr < end; page_addr += PAGE_SIZE) {
+		if (!proc->pages[(page_addr - proc->buffer) /
+				 PAGE_SIZE].page_ptr) {
+			need_map = 1;
+			break;
+		}
+	}
+	if (!need_map)
+		goto take_lru_pages;
+
 	if (vma)
 		mm = NULL;
 	else
@@ -592,9 +697,6 @@ static int binder_update_page_range(struct binder_proc *proc, int allocate,
 		vma = proc->vma;
 	}
 
-	if (allocate == 0)
-		goto free_range;
-
 	if (vma == NULL) {
 		printk(KERN_ERR "binder: %d: binder_alloc_buf failed to "
 		       "map pages in userspace, no vma\n", proc->pid);
@@ -604,9 +706,11 @@ static int binder_update_page_range(struct binder_proc *proc, int allocate,
 	for (page_addr = start; page_addr < end; page_addr += PAGE_SIZE) {
 		int ret;
 		struct page **page_array_ptr;
-		page = &proc->pages[(page_addr - proc->buffer) / PAGE_SIZE];
+		page = &proc->pages[(page_addr - proc->buffer) /
+				    PAGE_SIZE].page_ptr;
 
-		BUG_ON(*page);
+		if (*page)
+			continue;
 		*page = alloc_page(GFP_KERNEL | __GFP_ZERO);
 		if (*page == NULL) {
 			printk(KERN_ERR "binder: %d: binder_alloc_buf failed "
@@ -638,12 +742,25 @@ static int binder_update_page_range(struct binder_proc *proc, int allocate,
 		up_write(&mm->mmap_sem);
 		mmput(mm);
 	}
+take_lru_pages:
+	for (page_addr = start; page_addr < end; page_addr += PAGE_SIZE) {
+		lru_page = &proc->pages[(page_addr - proc->buffer) / PAGE_SIZE];
+		if (!list_empty(&lru_page->lru)) {
+			list_del_init(&lru_page->lru);
+			binder_lru_count--;
+		}
+	}
 	return 0;
 
-free_range:
+	/* unwind: release every page of the range below the failed one */
 	for (page_addr = end - PAGE_SIZE; page_addr >= start;
 	     page_addr -= PAGE_SIZE) {
-		page = &proc->pages[(page_addr - proc->buffer) / PAGE_SIZE];
+		lru_page = &proc->pages[(page_addr - proc->buffer) / PAGE_SIZE];
+		page = &lru_page->page_ptr;
+		if (!list_empty(&lru_page->lru)) {
+			list_del_init(&lru_page->lru);
+			binder_lru_count--;
+		}
 		if (vma)
 			zap_page_range(vma, (uintptr_t)page_addr +
 				proc->user_buffer_offset, PAGE_SIZE, NULL);
@@ -663,6 +780,66 @@ err_no_vma:
 	return -ENOMEM;
 }
 
+/*
+ * binder_lru_shrink - called from mm/vmscan.c :: shrink_slab
+ *
+ * Unmaps and frees up to 'nr_to_scan' unused buffer pages, oldest first.
+ * Pages whose owner's mmap_sem cannot be taken without blocking are skipped.
+ * Returns the number of pages left on binder_lru, or -1 if binder_lock is
+ * held (possibly by the allocation that got us here).
+ */
+static int binder_lru_shrink(int nr_to_scan, gfp_t gfp_mask)
+{
+	struct binder_lru_page *lru_page, *next;
+	int ret;
+
+	if (!nr_to_scan)
+		return binder_lru_count;
+
+	if (!mutex_trylock(&binder_lock))
+		return -1;
+
+	list_for_each_entry_safe(lru_page, next, &binder_lru, lru) {
+		struct binder_proc *proc = lru_page->proc;
+		struct mm_struct *mm = NULL;
+		void *page_addr;
+
+		if (nr_to_scan-- <= 0)
+			break;
+
+		page_addr = proc->buffer + (lru_page - proc->pages) * PAGE_SIZE;
+		if (proc->vma) {
+			mm = get_task_mm(proc->tsk);
+			if (mm == NULL)
+				continue;
+			if (!down_write_trylock(&mm->mmap_sem)) {
+				mmput(mm);
+				continue;
+			}
+			if (proc->vma)
+				zap_page_range(proc->vma, (uintptr_t)page_addr +
+					proc->user_buffer_offset, PAGE_SIZE,
+					NULL);
+			up_write(&mm->mmap_sem);
+			mmput(mm);
+		}
+		unmap_kernel_range((unsigned long)page_addr, PAGE_SIZE);
+		__free_page(lru_page->page_ptr);
+		lru_page->page_ptr = NULL;
+		list_del_init(&lru_page->lru);
+		binder_lru_count--;
+	}
+	ret = binder_lru_count;
+	mutex_unlock(&binder_lock);
+
+	return ret;
+}
+
+static struct shrinker binder_lru_shrinker = {
+	.shrink = binder_lru_shrink,
+	.seeks = DEFAULT_SEEKS,
+};
+
 static struct binder_buffer *binder_alloc_buf(struct binder_proc *proc,
 	size_t data_size, size_t offsets_size, int is_async)
 {
@@ -1257,6 +1434,158 @@ static void
 binder_transaction_buffer_release(struct binder_proc *proc,
 			struct binder_buffer *buffer, size_t *failed_at);
 
+/*
+ * Sender data fetched with binder_lock dropped, see
+ * binder_prefetch_transaction().
+ */
+struct binder_prefetch {
+	int buffered;		/* data and offsets in thread->prefetch_buf */
+	int nr_pages;		/* or data in pinned sender pages */
+	struct page **pages;
+};
+
+static int binder_pin_user_data(struct binder_prefetch *pf,
+	const void __user *ptr, size_t size)
+{
+	unsigned long start = (uintptr_t)ptr & PAGE_MASK;
+	int nr_pages, ret;
+
+	if (!access_ok(VERIFY_READ, ptr, size))
+		return 0;
+	nr_pages = (PAGE_ALIGN((uintptr_t)ptr + size) - start) / PAGE_SIZE;
+	pf->pages = kmalloc(nr_pages * sizeof(pf->pages[0]), GFP_KERNEL);
+	if (pf->pages == NULL)
+		return 0;
+
+	down_read(&current->mm->mmap_sem);
+	ret = get_user_pages(current, current->mm, start, nr_pages, 0, 0,
+			     pf->pages, NULL);
+	up_read(&current->mm->mmap_sem);
+	if (ret == nr_pages) {
+		pf->nr_pages = nr_pages;
+		return 1;
+	}
+	while (ret > 0)
+		page_cache_release(pf->pages[--ret]);
+	kfree(pf->pages);
+	pf->pages = NULL;
+	return 0;
+}
+
+static void binder_prefetch_release(struct binder_prefetch *pf)
+{
+	int i;
+
+	for (i = 0; i < pf->nr_pages; i++)
+		page_cache_release(pf->pages[i]);
+	kfree(pf->pages);
+}
+
+static void binder_copy_pinned_data(void *dst, struct binder_prefetch *pf,
+	struct binder_transaction_data *tr)
+{
+	size_t offset = (uintptr_t)tr->data.ptr.buffer & ~PAGE_MASK;
+	size_t size = tr->data_size;
+	int i;
+
+	for (i = 0; size; i++) {
+		size_t len = min_t(size_t, size, PAGE_SIZE - offset);
+		void *src = kmap(pf->pages[i]);
+		memcpy(dst, src + offset, len);
+		kunmap(pf->pages[i]);
+		dst += len;
+		size -= len;
+		offset = 0;
+	}
+}
+
+/*
+ * Fetch the transaction payload with binder_lock dropped, so a page fault on
+ * the sender's parcel never stalls every other binder user. Called with
+ * binder_lock held and before any binder state has been looked up, so
+ * nothing needs to be revalidated afterwards.
+ *
+ * Small payloads are copied into thread->prefetch_buf. For larger ones the
+ * pages backing the data are pinned; the offsets are still copied by the
+ * caller. If neither worked (no memory or a fault, which the caller will hit
+ * again and report), pf is left empty and the caller copies from user space
+ * itself.
+ */
+static void
+binder_prefetch_transaction(struct binder_thread *thread,
+	struct binder_transaction_data *tr, struct binder_prefetch *pf)
+{
+	size_t data_size = ALIGN(tr->data_size, sizeof(void *));
+
+	memset(pf, 0, sizeof(*pf));
+	if (tr->data_size > BINDER_PIN_MAX_SIZE ||
+	    tr->offsets_size > BINDER_PIN_MAX_SIZE)
+		return;
+
+	mutex_unlock(&binder_lock);
+	if (data_size + tr->offsets_size <= BINDER_PREFETCH_SIZE) {
+		if (thread->prefetch_buf == NULL)
+			thread->prefetch_buf = kmalloc(BINDER_PREFETCH_SIZE,
+						       GFP_KERNEL);
+		if (thread->prefetch_buf &&
+		    !copy_from_user(thread->prefetch_buf, tr->data.ptr.buffer,
+				    tr->data_size) &&
+		    !copy_from_user(thread->prefetch_buf + data_size,
+				    tr->data.ptr.offsets, tr->offsets_size))
+			pf->buffered = 1;
+	} else if (tr->data_size > BINDER_PREFETCH_SIZE)
+		binder_pin_user_data(pf, tr->data.ptr.buffer, tr->data_size);
+	mutex_lock(&binder_lock);
+}
+
+/*
+ * Account the time 'in_reply_to' spent in the replying thread, and the
+ * call's latency so far, against the replying proc and the called node.
+ */
+static void
+binder_transaction_replied(struct binder_proc *proc,
+	struct binder_transaction *t, struct binder_transaction *in_reply_to)
+{
+	ktime_t now = ktime_get();
+	s64 handle_us = ktime_us_delta(now, in_reply_to->dequeue_time);
+
+	binder_latency_add(&proc->latency[BINDER_LATENCY_HANDLE], handle_us);
+	if (in_reply_to->buffer && in_reply_to->buffer->target_node) {
+		struct binder_node *node = in_reply_to->buffer->target_node;
+		binder_latency_add(&node->latency[BINDER_LATENCY_HANDLE],
+				   handle_us);
+		binder_latency_add(&node->latency[BINDER_LATENCY_REPLY],
+			ktime_us_delta(now, in_reply_to->enqueue_time));
+	}
+	t->call_time = in_reply_to->enqueue_time;
+	trace_binder_transaction_reply(t->debug_id, in_reply_to->debug_id,
+				       handle_us);
+}
+
+/*
+ * Called when a thread of 'proc' picks 't' off a todo list.
+ */
+static void
+binder_transaction_dequeued(struct binder_proc *proc,
+	struct binder_thread *thread, struct binder_transaction *t)
+{
+	ktime_t now = ktime_get();
+	s64 wait_us = ktime_us_delta(now, t->enqueue_time);
+
+	if (t->buffer->target_node) {
+		binder_latency_add(&proc->latency[BINDER_LATENCY_QUEUE],
+				   wait_us);
+		binder_latency_add(
+			&t->buffer->target_node->latency[BINDER_LATENCY_QUEUE],
+			wait_us);
+		t->dequeue_time = now;
+	} else
+		binder_latency_add(&proc->latency[BINDER_LATENCY_REPLY],
+				   ktime_us_delta(now, t->call_time));
+	trace_binder_transaction_dequeue(t->debug_id, proc->pid, thread->pid,
+					 wait_us);
+}
+
 static void
 binder_transaction(struct binder_proc *proc, struct binder_thread *thread,
 	struct binder_transaction_data *tr, int reply)
@@ -1272,6 +1601,9 @@ binder_transaction(struct binder_proc *proc, struct binder_thread *thread,
 	struct binder_transaction *in_reply_to = NULL;
 	struct binder_transaction_log_entry *e;
 	uint32_t return_error;
+	struct binder_prefetch pf;
+
+	binder_prefetch_transaction(thread, tr, &pf);
 
 	e = binder_transaction_log_add(&binder_transaction_log);
 	e->call_type = reply ? 2 : !!(tr->flags & TF_ONE_WAY);
@@ -1440,13 +1772,21 @@ binder_transaction(struct binder_proc *proc, struct binder_thread *thread,
 
 	offp = (size_t *)(t->buffer->data + ALIGN(tr->data_size, sizeof(void *)));
 
-	if (copy_from_user(t->buffer->data, tr->data.ptr.buffer, tr->data_size)) {
+	if (pf.buffered) {
+		memcpy(t->buffer->data, thread->prefetch_buf, tr->data_size);
+		memcpy(offp, thread->prefetch_buf +
+		       ALIGN(tr->data_size, sizeof(void *)), tr->offsets_size);
+	} else if (pf.nr_pages) {
+		binder_copy_pinned_data(t->buffer->data, &pf, tr);
+	} else if (copy_from_user(t->buffer->data, tr->data.ptr.buffer,
+				  tr->data_size)) {
 		binder_user_error("binder: %d:%d got transaction with invalid "
 			"data ptr\n", proc->pid, thread->pid);
 		return_error = BR_FAILED_REPLY;
 		goto err_copy_data_failed;
 	}
-	if (copy_from_user(offp, tr->data.ptr.offsets, tr->offsets_size)) {
+	if (!pf.buffered && copy_from_user(offp, tr->data.ptr.offsets,
+					   tr->offsets_size)) {
 		binder_user_error("binder: %d:%d got transaction with invalid "
 			"offsets ptr\n", proc->pid, thread->pid);
 		return_error = BR_FAILED_REPLY;
@@ -1594,6 +1934,7 @@ binder_transaction(struct binder_proc *proc, struct binder_thread *thread,
 	}
 	if (reply) {
 		BUG_ON(t->buffer->async_transaction != 0);
+		binder_transaction_replied(proc, t, in_reply_to);
 		binder_pop_transaction(target_thread, in_reply_to);
 	} else if (!(t->flags & TF_ONE_WAY)) {
 		BUG_ON(t->buffer->async_transaction != 0);
@@ -1610,11 +1951,17 @@ binder_transaction(struct binder_proc *proc, struct binder_thread *thread,
 			target_node->has_async_transaction = 1;
 	}
 	t->work.type = BINDER_WORK_TRANSACTION;
+	t->enqueue_time = ktime_get();
+	trace_binder_transaction_enqueue(t->debug_id, reply, proc->pid,
+					 target_proc->pid,
+					 target_node ? target_node->debug_id : 0,
+					 tr->data_size);
 	list_add_tail(&t->work.entry, target_list);
 	tcomplete->type = BINDER_WORK_TRANSACTION_COMPLETE;
 	list_add_tail(&tcomplete->entry, &thread->todo);
 	if (target_wait)
 		wake_up_interruptible(target_wait);
+	binder_prefetch_release(&pf);
 	return;
 
 err_get_unused_fd_failed:
@@ -1659,6 +2006,7 @@ err_no_context_mgr_node:
 		binder_send_failed_reply(in_reply_to, return_error);
 	} else
 		thread->return_error = return_error;
+	binder_prefetch_release(&pf);
 }
 
 static void
@@ -2391,6 +2739,7 @@ retry:
 			       tr.data.ptr.buffer, tr.data.ptr.offsets);
 
 		list_del(&t->work.entry);
+		binder_transaction_dequeued(proc, thread, t);
 		t->buffer->allow_user_free = 1;
 		if (cmd == BR_TRANSACTION && !(t->flags & TF_ONE_WAY)) {
 			t->to_parent = thread->transaction_stack;
@@ -2512,6 +2861,7 @@ static int binder_free_thread(struct binder_proc *proc, struct binder_thread *th
 	if (send_reply)
 		binder_send_failed_reply(send_reply, BR_DEAD_REPLY);
 	binder_release_work(&thread->todo);
+	kfree(thread->prefetch_buf);
 	kfree(thread);
 	binder_stats.obj_deleted[BINDER_STAT_THREAD]++;
 	return active_transactions;
@@ -2707,6 +3057,7 @@ static struct vm_operations_struct binder_vm_ops = {
 static int binder_mmap(struct file *filp, struct vm_area_struct *vma)
 {
 	int ret;
+	int i;
 	struct vm_struct *area;
 	struct binder_proc *proc = filp->private_data;
 	const char *failure_string;
@@ -2759,6 +3110,10 @@ static int binder_mmap(struct file *filp, struct vm_area_struct *vma)
 		goto err_alloc_pages_failed;
 	}
 	proc->buffer_size = vma->vm_end - vma->vm_start;
+	for (i = 0; i < proc->buffer_size / PAGE_SIZE; i++) {
+		INIT_LIST_HEAD(&proc->pages[i].lru);
+		proc->pages[i].proc = proc;
+	}
 
 	vma->vm_ops = &binder_vm_ops;
 	vma->vm_private_data = proc;
@@ -2821,7 +3176,7 @@ static int binder_open(struct inode *nodp, struct file *filp)
 		char strbuf[11];
 		snprintf(strbuf, sizeof(strbuf), "%u", proc->pid);
 		remove_proc_entry(strbuf, binder_proc_dir_entry_proc);
-		create_proc_read_entry(strbuf, S_IRUGO, binder_proc_dir_entry_proc, binder_read_proc_proc, proc);
+		proc_create_data(strbuf, S_IRUGO, binder_proc_dir_entry_proc, &binder_proc_fops, proc);
 	}
 
 	return 0;
@@ -2956,12 +3311,17 @@ static void binder_deferred_release(struct binder_proc *proc)
 	if (proc->pages) {
 		int i;
 		for (i = 0; i < proc->buffer_size / PAGE_SIZE; i++) {
-			if (proc->pages[i]) {
+			if (!proc->pages[i].page_ptr)
+				continue;
+			if (!list_empty(&proc->pages[i].lru)) {
+				list_del(&proc->pages[i].lru);
+				binder_lru_count--;
+			} else {
 				if (binder_debug_mask & BINDER_DEBUG_BUFFER_ALLOC)
 					printk(KERN_INFO "binder_release: %d: page %d at %p not freed\n", proc->pid, i, proc->buffer + i * PAGE_SIZE);
-				__free_page(proc->pages[i]);
 				page_count++;
 			}
+			__free_page(proc->pages[i].page_ptr);
 		}
 		kfree(proc->pages);
 		vfree(proc->buffer);
@@ -3027,43 +3387,38 @@ static void binder_defer_work(struct binder_proc *proc, int defer)
 	mutex_unlock(&binder_deferred_lock);
 }
 
-static char *print_binder_transaction(char *buf, char *end, const char *prefix, struct binder_transaction *t)
+static void print_binder_transaction(struct seq_file *m, const char *prefix,
+				     struct binder_transaction *t)
 {
-	buf += snprintf(buf, end - buf, "%s %d: %p from %d:%d to %d:%d code %x flags %x pri %ld r%d",
-			prefix, t->debug_id, t, t->from ? t->from->proc->pid : 0,
-			t->from ? t->from->pid : 0,
-			t->to_proc ? t->to_proc->pid : 0,
-			t->to_thread ? t->to_thread->pid : 0,
-			t->code, t->flags, t->priority, t->need_reply);
-	if (buf >= end)
-		return buf;
+	seq_printf(m, "%s %d: %p from %d:%d to %d:%d code %x flags %x pri %ld r%d",
+		   prefix, t->debug_id, t, t->from ? t->from->proc->pid : 0,
+		   t->from ? t->from->pid : 0,
+		   t->to_proc ? t->to_proc->pid : 0,
+		   t->to_thread ? t->to_thread->pid : 0,
+		   t->code, t->flags, t->priority, t->need_reply);
 	if (t->buffer == NULL) {
-		buf += snprintf(buf, end - buf, " buffer free\n");
-		return buf;
-	}
-	if (t->buffer->target_node) {
-		buf += snprintf(buf, end - buf, " node %d",
-				t->buffer->target_node->debug_id);
-		if (buf >= end)
-			return buf;
+		seq_printf(m, " buffer free\n");
+		return;
 	}
-	buf += snprintf(buf, end - buf, " size %zd:%zd data %p\n",
-			t->buffer->data_size, t->buffer->offsets_size,
-			t->buffer->data);
-	return buf;
+	if (t->buffer->target_node)
+		seq_printf(m, " node %d", t->buffer->target_node->debug_id);
+	seq_printf(m, " size %zd:%zd data %p\n",
+		   t->buffer->data_size, t->buffer->offsets_size,
+		   t->buffer->data);
 }
 
-static char *print_binder_buffer(char *buf, char *end, const char *prefix, struct binder_buffer *buffer)
+static void print_binder_buffer(struct seq_file *m, const char *prefix,
+				struct binder_buffer *buffer)
 {
-	buf += snprintf(buf, end - buf, "%s %d: %p size %zd:%zd %s\n",
-			prefix, buffer->debug_id, buffer->data,
-			buffer->data_size, buffer->offsets_size,
-			buffer->transaction ? "active" : "delivered");
-	return buf;
+	seq_printf(m, "%s %d: %p size %zd:%zd %s\n",
+		   prefix, buffer->debug_id, buffer->data,
+		   buffer->data_size, buffer->offsets_size,
+		   buffer->transaction ? "active" : "delivered");
 }
 
-static char *print_binder_work(char *buf, char *end, const char *prefix,
-	const char *transaction_prefix, struct binder_work *w)
+static void print_binder_work(struct seq_file *m, const char *prefix,
+			      const char *transaction_prefix,
+			      struct binder_work *w)
 {
 	struct binder_node *node;
 	struct binder_transaction *t;
@@ -3071,154 +3426,136 @@ static char *print_binder_work(char *buf, char *end, const char *prefix,
 	switch (w->type) {
 	case BINDER_WORK_TRANSACTION:
 		t = container_of(w, struct binder_transaction, work);
-		buf = print_binder_transaction(buf, end, transaction_prefix, t);
+		print_binder_transaction(m, transaction_prefix, t);
 		break;
 	case BINDER_WORK_TRANSACTION_COMPLETE:
-		buf += snprintf(buf, end - buf,
-				"%stransaction complete\n", prefix);
+		seq_printf(m, "%stransaction complete\n", prefix);
 		break;
 	case BINDER_WORK_NODE:
 		node = container_of(w, struct binder_node, work);
-		buf += snprintf(buf, end - buf, "%snode work %d: u%p c%p\n",
-				prefix, node->debug_id, node->ptr, node->cookie);
+		seq_printf(m, "%snode work %d: u%p c%p\n",
+			   prefix, node->debug_id, node->ptr, node->cookie);
 		break;
 	case BINDER_WORK_DEAD_BINDER:
-		buf += snprintf(buf, end - buf, "%shas dead binder\n", prefix);
+		seq_printf(m, "%shas dead binder\n", prefix);
 		break;
 	case BINDER_WORK_DEAD_BINDER_AND_CLEAR:
-		buf += snprintf(buf, end - buf,
-				"%shas cleared dead binder\n", prefix);
+		seq_printf(m, "%shas cleared dead binder\n", prefix);
 		break;
 	case BINDER_WORK_CLEAR_DEATH_NOTIFICATION:
-		buf += snprintf(buf, end - buf,
-				"%shas cleared death notification\n", prefix);
+		seq_printf(m, "%shas cleared death notification\n", prefix);
 		break;
 	default:
-		buf += snprintf(buf, end - buf, "%sunknown work: type %d\n",
-				prefix, w->type);
+		seq_printf(m, "%sunknown work: type %d\n", prefix, w->type);
 		break;
 	}
-	return buf;
 }
 
-static char *print_binder_thread(char *buf, char *end, struct binder_thread *thread, int print_always)
+static void print_binder_thread(struct seq_file *m,
+				struct binder_thread *thread,
+				int print_always)
 {
 	struct binder_transaction *t;
 	struct binder_work *w;
-	char *start_buf = buf;
-	char *header_buf;
+	size_t start_pos = m->count;
+	size_t header_pos;
 
-	buf += snprintf(buf, end - buf, "  thread %d: l %02x\n", thread->pid, thread->looper);
-	header_buf = buf;
+	seq_printf(m, "  thread %d: l %02x\n", thread->pid, thread->looper);
+	header_pos = m->count;
 	t = thread->transaction_stack;
 	while (t) {
-		if (buf >= end)
-			break;
 		if (t->from == thread) {
-			buf = print_binder_transaction(buf, end, "    outgoing transaction", t);
+			print_binder_transaction(m, "    outgoing transaction", t);
 			t = t->from_parent;
 		} else if (t->to_thread == thread) {
-			buf = print_binder_transaction(buf, end, "    incoming transaction", t);
+			print_binder_transaction(m, "    incoming transaction", t);
 			t = t->to_parent;
 		} else {
-			buf = print_binder_transaction(buf, end, "    bad transaction", t);
+			print_binder_transaction(m, "    bad transaction", t);
 			t = NULL;
 		}
 	}
 	list_for_each_entry(w, &thread->todo, entry) {
-		if (buf >= end)
-			break;
-		buf = print_binder_work(buf, end, "    ",
-					"    pending transaction", w);
+		print_binder_work(m, "    ", "    pending transaction", w);
 	}
-	if (!print_always && buf == header_buf)
-		buf = start_buf;
-	return buf;
+	if (!print_always && m->count == header_pos &&
+	    m->count < m->size)
+		m->count = start_pos;
 }
 
-static char *print_binder_node(char *buf, char *end, struct binder_node *node)
+static void print_binder_node(struct seq_file *m, struct binder_node *node)
 {
 	struct binder_ref *ref;
 	struct hlist_node *pos;
 	struct binder_work *w;
 	int count;
+
 	count = 0;
 	hlist_for_each_entry(ref, pos, &node->refs, node_entry)
 		count++;
 
-	buf += snprintf(buf, end - buf, "  node %d: u%p c%p hs %d hw %d ls %d lw %d is %d iw %d",
-			node->debug_id, node->ptr, node->cookie,
-			node->has_strong_ref, node->has_weak_ref,
-			node->local_strong_refs, node->local_weak_refs,
-			node->internal_strong_refs, count);
-	if (buf >= end)
-		return buf;
+	seq_printf(m, "  node %d: u%p c%p hs %d hw %d ls %d lw %d is %d iw %d",
+		   node->debug_id, node->ptr, node->cookie,
+		   node->has_strong_ref, node->has_weak_ref,
+		   node->local_strong_refs, node->local_weak_refs,
+		   node->internal_strong_refs, count);
 	if (count) {
-		buf += snprintf(buf, end - buf, " proc");
-		if (buf >= end)
-			return buf;
-		hlist_for_each_entry(ref, pos, &node->refs, node_entry) {
-			buf += snprintf(buf, end - buf, " %d", ref->proc->pid);
-			if (buf >= end)
-				return buf;
-		}
-	}
-	buf += snprintf(buf, end - buf, "\n");
-	list_for_each_entry(w, &node->async_todo, entry) {
-		if (buf >= end)
-			break;
-		buf = print_binder_work(buf, end, "    ",
-					"    pending async transaction", w);
+		seq_printf(m, " proc");
+		hlist_for_each_entry(ref, pos, &node->refs, node_entry)
+			seq_printf(m, " %d", ref->proc->pid);
 	}
-	return buf;
+	seq_printf(m, "\n");
+	list_for_each_entry(w, &node->async_todo, entry)
+		print_binder_work(m, "    ",
+				  "    pending async transaction", w);
 }
 
-static char *print_binder_ref(char *buf, char *end, struct binder_ref *ref)
+static void print_binder_ref(struct seq_file *m, struct binder_ref *ref)
 {
-	buf += snprintf(buf, end - buf, "  ref %d: desc %d %snode %d s %d w %d d %p\n",
-			ref->debug_id, ref->desc, ref->node->proc ? "" : "dead ",
-			ref->node->debug_id, ref->strong, ref->weak, ref->death);
-	return buf;
+	seq_printf(m, "  ref %d: desc %d %snode %d s %d w %d d %p\n",
+		   ref->debug_id, ref->desc, ref->node->proc ? "" : "dead ",
+		   ref->node->debug_id, ref->strong, ref->weak, ref->death);
 }
 
-static char *print_binder_proc(char *buf, char *end, struct binder_proc *proc, int print_all)
+static void print_binder_proc(struct seq_file *m,
+			      struct binder_proc *proc, int print_all)
 {
 	struct binder_work *w;
 	struct rb_node *n;
-	char *start_buf = buf;
-	char *header_buf;
+	size_t start_pos = m->count;
+	size_t header_pos;
 
-	buf += snprintf(buf, end - buf, "proc %d\n", proc->pid);
-	header_buf = buf;
+	seq_printf(m, "proc %d\n", proc->pid);
+	header_pos = m->count;
 
-	for (n = rb_first(&proc->threads); n != NULL && buf < end; n = rb_next(n))
-		buf = print_binder_thread(buf, end, rb_entry(n, struct binder_thread, rb_node), print_all);
-	for (n = rb_first(&proc->nodes); n != NULL && buf < end; n = rb_next(n)) {
-		struct binder_node *node = rb_entry(n, struct binder_node, rb_node);
+	for (n = rb_first(&proc->threads); n != NULL; n = rb_next(n))
+		print_binder_thread(m, rb_entry(n, struct binder_thread,
+						rb_node), print_all);
+	for (n = rb_first(&proc->nodes); n != NULL; n = rb_next(n)) {
+		struct binder_node *node = rb_entry(n, struct binder_node,
+						    rb_node);
 		if (print_all || node->has_async_transaction)
-			buf = print_binder_node(buf, end, node);
+			print_binder_node(m, node);
 	}
 	if (print_all) {
-		for (n = rb_first(&proc->refs_by_desc); n != NULL && buf < end; n = rb_next(n))
-			buf = print_binder_ref(buf, end, rb_entry(n, struct binder_ref, rb_node_desc));
-	}
-	for (n = rb_first(&proc->allocated_buffers); n != NULL && buf < end; n = rb_next(n))
-		buf = print_binder_buffer(buf, end, "  buffer", rb_entry(n, struct binder_buffer, rb_node));
-	list_for_each_entry(w, &proc->todo, entry) {
-		if (buf >= end)
-			break;
-		buf = print_binder_work(buf, end, "  ",
-					"  pending transaction", w);
+		for (n = rb_first(&proc->refs_by_desc);
+		     n != NULL;
+		     n = rb_next(n))
+			print_binder_ref(m, rb_entry(n, struct binder_ref,
+						     rb_node_desc));
 	}
+	for (n = rb_first(&proc->allocated_buffers); n != NULL; n = rb_next(n))
+		print_binder_buffer(m, "  buffer",
+				    rb_entry(n, struct binder_buffer, rb_node));
+	list_for_each_entry(w, &proc->todo, entry)
+		print_binder_work(m, "  ", "  pending transaction", w);
 	list_for_each_entry(w, &proc->delivered_death, entry) {
-		if (buf >= end)
-			break;
-		buf += snprintf(buf, end - buf, "  has delivered dead binder\n");
+		seq_printf(m, "  has delivered dead binder\n");
 		break;
 	}
-	if (!print_all && buf == header_buf)
-		buf = start_buf;
-	return buf;
+	if (!print_all && m->count == header_pos &&
+	    m->count < m->size)
+		m->count = start_pos;
 }
 
 static const char *binder_return_strings[] = {
@@ -3272,89 +3609,141 @@ static const char *binder_objstat_strings[] = {
 	"transaction_complete"
 };
 
-static char *print_binder_stats(char *buf, char *end, const char *prefix, struct binder_stats *stats)
+static const char *binder_latency_strings[] = {
+	"queue",
+	"handle",
+	"reply"
+};
+
+static void print_binder_stats(struct seq_file *m, const char *prefix,
+			       struct binder_stats *stats)
 {
 	int i;
 
 	BUILD_BUG_ON(ARRAY_SIZE(stats->bc) != ARRAY_SIZE(binder_command_strings));
 	for (i = 0; i < ARRAY_SIZE(stats->bc); i++) {
 		if (stats->bc[i])
-			buf += snprintf(buf, end - buf, "%s%s: %d\n", prefix,
-					binder_command_strings[i], stats->bc[i]);
-		if (buf >= end)
-			return buf;
+			seq_printf(m, "%s%s: %d\n", prefix,
+				   binder_command_strings[i], stats->bc[i]);
 	}
 
 	BUILD_BUG_ON(ARRAY_SIZE(stats->br) != ARRAY_SIZE(binder_return_strings));
 	for (i = 0; i < ARRAY_SIZE(stats->br); i++) {
 		if (stats->br[i])
-			buf += snprintf(buf, end - buf, "%s%s: %d\n", prefix,
-					binder_return_strings[i], stats->br[i]);
-		if (buf >= end)
-			return buf;
+			seq_printf(m, "%s%s: %d\n", prefix,
+				   binder_return_strings[i], stats->br[i]);
 	}
 
 	BUILD_BUG_ON(ARRAY_SIZE(stats->obj_created) != ARRAY_SIZE(binder_objstat_strings));
 	BUILD_BUG_ON(ARRAY_SIZE(stats->obj_created) != ARRAY_SIZE(stats->obj_deleted));
 	for (i = 0; i < ARRAY_SIZE(stats->obj_created); i++) {
 		if (stats->obj_created[i] || stats->obj_deleted[i])
-			buf += snprintf(buf, end - buf, "%s%s: active %d total %d\n", prefix,
-					binder_objstat_strings[i],
-					stats->obj_created[i] - stats->obj_deleted[i],
-					stats->obj_created[i]);
-		if (buf >= end)
-			return buf;
+			seq_printf(m, "%s%s: active %d total %d\n", prefix,
+				   binder_objstat_strings[i],
+				   stats->obj_created[i] - stats->obj_deleted[i],
+				   stats->obj_created[i]);
 	}
-	return buf;
 }
 
-static char *print_binder_proc_stats(char *buf, char *end, struct binder_proc *proc)
+/*
+ * One line per non-empty histogram: sample count, average, then the count
+ * of each bucket up to the last non-empty one. Bucket 0 is below
+ * 1 << BINDER_LATENCY_SHIFT us, each following bucket doubles the range.
+ */
+static void print_binder_latency(struct seq_file *m, const char *prefix,
+				 struct binder_latency *latency)
+{
+	int i, j, last;
+	u32 samples;
+	u64 avg;
+
+	BUILD_BUG_ON(ARRAY_SIZE(binder_latency_strings) != BINDER_LATENCY_COUNT);
+	for (i = 0; i < BINDER_LATENCY_COUNT; i++) {
+		samples = 0;
+		last = 0;
+		for (j = 0; j < BINDER_LATENCY_BUCKETS; j++) {
+			samples += latency[i].count[j];
+			if (latency[i].count[j])
+				last = j;
+		}
+		if (!samples)
+			continue;
+		avg = latency[i].total_us;
+		do_div(avg, samples);
+		seq_printf(m, "%s%s latency: %u avg %lluus,", prefix,
+			   binder_latency_strings[i], samples,
+			   (unsigned long long)avg);
+		for (j = 0; j <= last; j++)
+			seq_printf(m, " %u", latency[i].count[j]);
+		seq_printf(m, "\n");
+	}
+}
+
+static void print_binder_proc_stats(struct seq_file *m,
+				    struct binder_proc *proc)
 {
 	struct binder_work *w;
 	struct rb_node *n;
 	int count, strong, weak;
+	size_t free_size, largest_free;
+	int i, mapped, lru;
 
-	buf += snprintf(buf, end - buf, "proc %d\n", proc->pid);
-	if (buf >= end)
-		return buf;
+	seq_printf(m, "proc %d\n", proc->pid);
 	count = 0;
 	for (n = rb_first(&proc->threads); n != NULL; n = rb_next(n))
 		count++;
-	buf += snprintf(buf, end - buf, "  threads: %d\n", count);
-	if (buf >= end)
-		return buf;
-	buf += snprintf(buf, end - buf, "  requested threads: %d+%d/%d\n"
+	seq_printf(m, "  threads: %d\n", count);
+	seq_printf(m, "  requested threads: %d+%d/%d\n"
 			"  ready threads %d\n"
 			"  free async space %zd\n", proc->requested_threads,
 			proc->requested_threads_started, proc->max_threads,
 			proc->ready_threads, proc->free_async_space);
-	if (buf >= end)
-		return buf;
 	count = 0;
 	for (n = rb_first(&proc->nodes); n != NULL; n = rb_next(n))
 		count++;
-	buf += snprintf(buf, end - buf, "  nodes: %d\n", count);
-	if (buf >= end)
-		return buf;
+	seq_printf(m, "  nodes: %d\n", count);
 	count = 0;
 	strong = 0;
 	weak = 0;
 	for (n = rb_first(&proc->refs_by_desc); n != NULL; n = rb_next(n)) {
-		struct binder_ref *ref = rb_entry(n, struct binder_ref, rb_node_desc);
+		struct binder_ref *ref = rb_entry(n, struct binder_ref,
+						  rb_node_desc);
 		count++;
 		strong += ref->strong;
 		weak += ref->weak;
 	}
-	buf += snprintf(buf, end - buf, "  refs: %d s %d w %d\n", count, strong, weak);
-	if (buf >= end)
-		return buf;
+	seq_printf(m, "  refs: %d s %d w %d\n", count, strong, weak);
 
 	count = 0;
 	for (n = rb_first(&proc->allocated_buffers); n != NULL; n = rb_next(n))
 		count++;
-	buf += snprintf(buf, end - buf, "  buffers: %d\n", count);
-	if (buf >= end)
-		return buf;
+	seq_printf(m, "  buffers: %d\n", count);
+
+	count = 0;
+	free_size = 0;
+	largest_free = 0;
+	for (n = rb_first(&proc->free_buffers); n != NULL; n = rb_next(n)) {
+		struct binder_buffer *buffer = rb_entry(n, struct binder_buffer,
+							rb_node);
+		size_t size = binder_buffer_size(proc, buffer);
+		count++;
+		free_size += size;
+		if (size > largest_free)
+			largest_free = size;
+	}
+	mapped = 0;
+	lru = 0;
+	for (i = 0; proc->pages && i < proc->buffer_size / PAGE_SIZE; i++) {
+		if (!proc->pages[i].page_ptr)
+			continue;
+		mapped++;
+		if (!list_empty(&proc->pages[i].lru))
+			lru++;
+	}
+	seq_printf(m, "  free buffers: %d, %zd bytes, largest %zd\n"
+			"  pages: %d mapped, %d unused of %zd\n", count,
+			free_size, largest_free, mapped, lru,
+			proc->buffer_size / PAGE_SIZE);
 
 	count = 0;
 	list_for_each_entry(w, &proc->todo, entry) {
@@ -3366,219 +3755,145 @@ static char *print_binder_proc_stats(char *buf, char *end, struct binder_proc *p
 			break;
 		}
 	}
-	buf += snprintf(buf, end - buf, "  pending transactions: %d\n", count);
-	if (buf >= end)
-		return buf;
+	seq_printf(m, "  pending transactions: %d\n", count);
 
-	buf = print_binder_stats(buf, end, "  ", &proc->stats);
+	print_binder_stats(m, "  ", &proc->stats);
+	print_binder_latency(m, "  ", proc->latency);
+	for (n = rb_first(&proc->nodes); n != NULL; n = rb_next(n)) {
+		struct binder_node *node = rb_entry(n, struct binder_node,
+						    rb_node);
+		size_t start_pos = m->count;
+		size_t header_pos;
 
-	return buf;
+		seq_printf(m, "  node %d:\n", node->debug_id);
+		header_pos = m->count;
+		print_binder_latency(m, "    ", node->latency);
+		if (m->count == header_pos && m->count < m->size)
+			m->count = start_pos;
+	}
 }
 
 
-static int binder_read_proc_state(
-	char *page, char **start, off_t off, int count, int *eof, void *data)
+static int binder_state_show(struct seq_file *m, void *unused)
 {
 	struct binder_proc *proc;
 	struct hlist_node *pos;
 	struct binder_node *node;
-	int len = 0;
-	char *buf = page;
-	char *end = page + PAGE_SIZE;
 	int do_lock = !binder_debug_no_lock;
 
-	if (off)
-		return 0;
-
 	if (do_lock)
 		mutex_lock(&binder_lock);
 
-	buf += snprintf(buf, end - buf, "binder state:\n");
+	seq_printf(m, "binder state:\n");
 
 	if (!hlist_empty(&binder_dead_nodes))
-		buf += snprintf(buf, end - buf, "dead nodes:\n");
-	hlist_for_each_entry(node, pos, &binder_dead_nodes, dead_node) {
-		if (buf >= end)
-			break;
-		buf = print_binder_node(buf, end, node);
-	}
+		seq_printf(m, "dead nodes:\n");
+	hlist_for_each_entry(node, pos, &binder_dead_nodes, dead_node)
+		print_binder_node(m, node);
 
-	hlist_for_each_entry(proc, pos, &binder_procs, proc_node) {
-		if (buf >= end)
-			break;
-		buf = print_binder_proc(buf, end, proc, 1);
-	}
+	hlist_for_each_entry(proc, pos, &binder_procs, proc_node)
+		print_binder_proc(m, proc, 1);
 	if (do_lock)
 		mutex_unlock(&binder_lock);
-	if (buf > page + PAGE_SIZE)
-		buf = page + PAGE_SIZE;
-
-	*start = page + off;
-
-	len = buf - page;
-	if (len > off)
-		len -= off;
-	else
-		len = 0;
-
-	return len < count ? len  : count;
+	return 0;
 }
 
-static int binder_read_proc_stats(
-	char *page, char **start, off_t off, int count, int *eof, void *data)
+static int binder_stats_show(struct seq_file *m, void *unused)
 {
 	struct binder_proc *proc;
 	struct hlist_node *pos;
-	int len = 0;
-	char *p = page;
 	int do_lock = !binder_debug_no_lock;
 
-	if (off)
-		return 0;
-
 	if (do_lock)
 		mutex_lock(&binder_lock);
 
-	p += snprintf(p, PAGE_SIZE, "binder stats:\n");
+	seq_printf(m, "binder stats:\n");
 
-	p = print_binder_stats(p, page + PAGE_SIZE, "", &binder_stats);
+	print_binder_stats(m, "", &binder_stats);
+	seq_printf(m, "lru pages: %d\n", binder_lru_count);
 
-	hlist_for_each_entry(proc, pos, &binder_procs, proc_node) {
-		if (p >= page + PAGE_SIZE)
-			break;
-		p = print_binder_proc_stats(p, page + PAGE_SIZE, proc);
-	}
+	hlist_for_each_entry(proc, pos, &binder_procs, proc_node)
+		print_binder_proc_stats(m, proc);
 	if (do_lock)
 		mutex_unlock(&binder_lock);
-	if (p > page + PAGE_SIZE)
-		p = page + PAGE_SIZE;
-
-	*start = page + off;
-
-	len = p - page;
-	if (len > off)
-		len -= off;
-	else
-		len = 0;
-
-	return len < count ? len  : count;
+	return 0;
 }
 
-static int binder_read_proc_transactions(
-	char *page, char **start, off_t off, int count, int *eof, void *data)
+static int binder_transactions_show(struct seq_file *m, void *unused)
 {
 	struct binder_proc *proc;
 	struct hlist_node *pos;
-	int len = 0;
-	char *buf = page;
-	char *end = page + PAGE_SIZE;
 	int do_lock = !binder_debug_no_lock;
 
-	if (off)
-		return 0;
-
 	if (do_lock)
 		mutex_lock(&binder_lock);
 
-	buf += snprintf(buf, end - buf, "binder transactions:\n");
-	hlist_for_each_entry(proc, pos, &binder_procs, proc_node) {
-		if (buf >= end)
-			break;
-		buf = print_binder_proc(buf, end, proc, 0);
-	}
+	seq_printf(m, "binder transactions:\n");
+	hlist_for_each_entry(proc, pos, &binder_procs, proc_node)
+		print_binder_proc(m, proc, 0);
 	if (do_lock)
 		mutex_unlock(&binder_lock);
-	if (buf > page + PAGE_SIZE)
-		buf = page + PAGE_SIZE;
-
-	*start = page + off;
-
-	len = buf - page;
-	if (len > off)
-		len -= off;
-	else
-		len = 0;
-
-	return len < count ? len  : count;
+	return 0;
 }
 
-static int binder_read_proc_proc(
-	char *page, char **start, off_t off, int count, int *eof, void *data)
+static int binder_proc_show(struct seq_file *m, void *unused)
 {
-	struct binder_proc *proc = data;
-	int len = 0;
-	char *p = page;
+	struct binder_proc *proc = m->private;
 	int do_lock = !binder_debug_no_lock;
 
-	if (off)
-		return 0;
-
 	if (do_lock)
 		mutex_lock(&binder_lock);
-	p += snprintf(p, PAGE_SIZE, "binder proc state:\n");
-	p = print_binder_proc(p, page + PAGE_SIZE, proc, 1);
+	seq_printf(m, "binder proc state:\n");
+	print_binder_proc(m, proc, 1);
 	if (do_lock)
 		mutex_unlock(&binder_lock);
-
-	if (p > page + PAGE_SIZE)
-		p = page + PAGE_SIZE;
-	*start = page + off;
-
-	len = p - page;
-	if (len > off)
-		len -= off;
-	else
-		len = 0;
-
-	return len < count ? len  : count;
+	return 0;
 }
 
-static char *print_binder_transaction_log_entry(char *buf, char *end, struct binder_transaction_log_entry *e)
+static void print_binder_transaction_log_entry(struct seq_file *m,
+					struct binder_transaction_log_entry *e)
 {
-	buf += snprintf(buf, end - buf, "%d: %s from %d:%d to %d:%d node %d handle %d size %d:%d\n",
-			e->debug_id, (e->call_type == 2) ? "reply" :
-			((e->call_type == 1) ? "async" : "call "), e->from_proc,
-			e->from_thread, e->to_proc, e->to_thread, e->to_node,
-			e->target_handle, e->data_size, e->offsets_size);
-	return buf;
+	seq_printf(m, "%d: %s from %d:%d to %d:%d node %d handle %d size %d:%d\n",
+		   e->debug_id, (e->call_type == 2) ? "reply" :
+		   ((e->call_type == 1) ? "async" : "call "), e->from_proc,
+		   e->from_thread, e->to_proc, e->to_thread, e->to_node,
+		   e->target_handle, e->data_size, e->offsets_size);
 }
 
-static int binder_read_proc_transaction_log(
-	char *page, char **start, off_t off, int count, int *eof, void *data)
+static int binder_transaction_log_show(struct seq_file *m, void *unused)
 {
-	struct binder_transaction_log *log = data;
-	int len = 0;
+	struct binder_transaction_log *log = m->private;
 	int i;
-	char *buf = page;
-	char *end = page + PAGE_SIZE;
-
-	if (off)
-		return 0;
 
 	if (log->full) {
-		for (i = log->next; i < ARRAY_SIZE(log->entry); i++) {
-			if (buf >= end)
-				break;
-			buf = print_binder_transaction_log_entry(buf, end, &log->entry[i]);
-		}
-	}
-	for (i = 0; i < log->next; i++) {
-		if (buf >= end)
-			break;
-		buf = print_binder_transaction_log_entry(buf, end, &log->entry[i]);
+		for (i = log->next; i < ARRAY_SIZE(log->entry); i++)
+			print_binder_transaction_log_entry(m, &log->entry[i]);
 	}
+	for (i = 0; i < log->next; i++)
+		print_binder_transaction_log_entry(m, &log->entry[i]);
+	return 0;
+}
 
-	*start = page + off;
-
-	len = buf - page;
-	if (len > off)
-		len -= off;
-	else
-		len = 0;
-
-	return len < count ? len  : count;
+#define BINDER_PROC_ENTRY(name) \
+static int binder_##name##_open(struct inode *inode, struct file *file) \
+{ \
+	return single_open(file, binder_##name##_show, PDE(inode)->data); \
+} \
+\
+static const struct file_operations binder_##name##_fops = { \
+	.owner = THIS_MODULE, \
+	.open = binder_##name##_open, \
+	.read = seq_read, \
+	.llseek = seq_lseek, \
+	.release = single_release, \
 }
 
+BINDER_PROC_ENTRY(state);
+BINDER_PROC_ENTRY(stats);
+BINDER_PROC_ENTRY(transactions);
+BINDER_PROC_ENTRY(proc);
+BINDER_PROC_ENTRY(transaction_log);
+
 static struct file_operations binder_fops = {
 	.owner = THIS_MODULE,
 	.poll = binder_poll,
@@ -3603,12 +3918,14 @@ static int __init binder_init(void)
 	if (binder_proc_dir_entry_root)
 		binder_proc_dir_entry_proc = proc_mkdir("proc", binder_proc_dir_entry_root);
 	ret = misc_register(&binder_miscdev);
+	if (ret == 0)
+		register_shrinker(&binder_lru_shrinker);
 	if (binder_proc_dir_entry_root) {
-		create_proc_read_entry("state", S_IRUGO, binder_proc_dir_entry_root, binder_read_proc_state, NULL);
-		create_proc_read_entry("stats", S_IRUGO, binder_proc_dir_entry_root, binder_read_proc_stats, NULL);
-		create_proc_read_entry("transactions", S_IRUGO, binder_proc_dir_entry_root, binder_read_proc_transactions, NULL);
-		create_proc_read_entry("transaction_log", S_IRUGO, binder_proc_dir_entry_root, binder_read_proc_transaction_log, &binder_transaction_log);
-		create_proc_read_entry("failed_transaction_log", S_IRUGO, binder_proc_dir_entry_root, binder_read_proc_transaction_log, &binder_transaction_log_failed);
+		proc_create("state", S_IRUGO, binder_proc_dir_entry_root, &binder_state_fops);
+		proc_create("stats", S_IRUGO, binder_proc_dir_entry_root, &binder_stats_fops);
+		proc_create("transactions", S_IRUGO, binder_proc_dir_entry_root, &binder_transactions_fops);
+		proc_create_data("transaction_log", S_IRUGO, binder_proc_dir_entry_root, &binder_transaction_log_fops, &binder_transaction_log);
+		proc_create_data("failed_transaction_log", S_IRUGO, binder_proc_dir_entry_root, &binder_transaction_log_fops, &binder_transaction_log_failed);
 	}
 	return ret;
 }
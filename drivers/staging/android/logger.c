@@ -23,6 +23,17 @@
 #include <linux/uaccess.h>
 #include <linux/poll.h>
 #include <linux/time.h>
+#ifdef CONFIG_ANDROID_LOGGER_PERSIST
+#include <linux/io.h>
+#include <linux/lzo.h>
+#include <linux/notifier.h>
+#include <linux/platform_device.h>
+#include <linux/proc_fs.h>
+#include <linux/reboot.h>
+#include <linux/rslib.h>
+#include <linux/vmalloc.h>
+#include <linux/workqueue.h>
+#endif
 #include "logger.h"
 
 #include <asm/ioctls.h>
@@ -81,41 +92,62 @@ static struct struct_marks_ver_mark marks_ver_mark = {
 	.second_start_addr=0x40000000
 };
 
-static char klog_buf[256];
-
 /*
  * struct logger_log - represents a specific log, such as 'main' or 'radio'
  *
  * This structure lives from module insertion until module removal, so it does
- * not need additional reference counting. The structure is protected by the
- * mutex 'mutex'.
+ * not need additional reference counting.
+ *
+ * Positions (w_pos, c_pos, head and a reader's r_pos) count bytes written
+ * since boot and only ever grow; logger_offset() maps them into the ring.
+ * Writers reserve space under 'lock' and copy their entry in without it, so
+ * concurrent writers never wait on each other's copy_from_user(). Bytes up to
+ * c_pos are complete; between c_pos and w_pos writes are still in flight.
  */
 struct logger_log {
 	unsigned char *		buffer;	/* the ring buffer itself */
 	struct miscdevice	misc;	/* misc device representing the log */
-	wait_queue_head_t	wq;	/* wait queue for readers */
+	wait_queue_head_t	wq;	/* wait queue for readers and writers */
 	struct list_head	readers; /* this log's readers */
-	struct mutex		mutex;	/* mutex protecting buffer */
-	size_t			w_off;	/* current write head offset */
-	size_t			head;	/* new readers start here */
+	spinlock_t		lock;	/* protects everything below */
+	size_t			w_pos;	/* end of the last reserved entry */
+	size_t			c_pos;	/* end of the last complete entry */
+	int			writers; /* writes between c_pos and w_pos */
+	size_t			head;	/* oldest intact entry */
 	size_t			size;	/* size of the log */
+#ifdef CONFIG_ANDROID_LOGGER_PERSIST
+	struct logger_persist *	persist; /* copy kept in persistent RAM */
+#endif
 };
 
 /*
  * struct logger_reader - a logging device open for reading
  *
  * This object lives from open to release, so we don't need additional
- * reference counting. The structure is protected by log->mutex.
+ * reference counting. The structure is protected by log->lock.
+ *
+ * Readers are not moved when a writer laps them; a reader found behind
+ * log->head simply restarts from there on its next read.
  */
 struct logger_reader {
 	struct logger_log *	log;	/* associated log */
 	struct list_head	list;	/* entry in logger_log's list */
-	size_t			r_off;	/* current read head offset */
+	size_t			r_pos;	/* current read position */
+	unsigned char *		bounce;	/* LOGGER_ENTRY_MAX_LEN bytes */
 };
 
 /* logger_offset - returns index 'n' into the log via (optimized) modulus */
 #define logger_offset(n)	((n) & (log->size - 1))
 
+/* logger_before - is position 'a' older than position 'b'? */
+#define logger_before(a, b)	((ssize_t)((a) - (b)) < 0)
+
+#ifdef CONFIG_ANDROID_LOGGER_PERSIST
+static void logger_persist_commit(struct logger_log *log);
+#else
+static inline void logger_persist_commit(struct logger_log *log) { }
+#endif
+
 /*
  * file_get_log - Given a file structure, return the associated log
  *
@@ -143,7 +175,7 @@ static inline struct logger_log * file_get_log(struct file *file)
  * get_entry_len - Grabs the length of the payload of the next entry starting
  * from 'off'.
  *
- * Caller needs to hold log->mutex.
+ * Caller needs to hold log->lock and 'off' must be below log->c_pos.
  */
 static __u32 get_entry_len(struct logger_log *log, size_t off)
 {
@@ -162,16 +194,29 @@ static __u32 get_entry_len(struct logger_log *log, size_t off)
 }
 
 /*
- * do_read_log_to_user - reads exactly 'count' bytes from 'log' into the
- * user-space buffer 'buf'. Returns 'count' on success.
+ * reader_catch_up - move 'reader' to the oldest intact entry if a writer
+ * lapped it. Returns the number of complete bytes left to read.
+ *
+ * Caller must hold log->lock.
+ */
+static size_t reader_catch_up(struct logger_log *log,
+			      struct logger_reader *reader)
+{
+	if (logger_before(reader->r_pos, log->head))
+		reader->r_pos = log->head;
+	return log->c_pos - reader->r_pos;
+}
+
+/*
+ * do_read_log - copies the 'count' bytes at the reader's position into its
+ * bounce buffer at 'off' and advances the reader.
  *
- * Caller must hold log->mutex.
+ * Caller must hold log->lock.
  */
-static ssize_t do_read_log_to_user(struct logger_log *log,
-				   struct logger_reader *reader,
-				   char __user *buf,
-				   size_t count)
+static void do_read_log(struct logger_log *log, struct logger_reader *reader,
+			size_t off, size_t count)
 {
+	size_t r_off = logger_offset(reader->r_pos);
 	size_t len;
 
 	/*
@@ -179,50 +224,36 @@ static ssize_t do_read_log_to_user(struct logger_log *log,
 	 * the current read head offset up to 'count' bytes or to the end of
 	 * the log, whichever comes first.
 	 */
-	len = min(count, log->size - reader->r_off);
-	if (copy_to_user(buf, log->buffer + reader->r_off, len))
-		return -EFAULT;
+	len = min(count, log->size - r_off);
+	memcpy(reader->bounce + off, log->buffer + r_off, len);
 
 	/*
 	 * Second, we read any remaining bytes, starting back at the head of
 	 * the log.
 	 */
 	if (count != len)
-		if (copy_to_user(buf + len, log->buffer, count - len))
-			return -EFAULT;
-
-	reader->r_off = logger_offset(reader->r_off + count);
+		memcpy(reader->bounce + off + len, log->buffer, count - len);
 
-	return count;
+	reader->r_pos += count;
 }
 
 /*
- * logger_read - our log's read() method
- *
- * Behavior:
+ * logger_wait - block until 'reader' has something to read
  *
- * 	- O_NONBLOCK works
- * 	- If there are no log entries to read, blocks until log is written to
- * 	- Atomically reads exactly one log entry
- *
- * Optimal read size is LOGGER_ENTRY_MAX_LEN. Will set errno to EINVAL if read
- * buffer is insufficient to hold next entry.
+ * Returns zero, or -EAGAIN for O_NONBLOCK and -EINTR on a signal.
  */
-static ssize_t logger_read(struct file *file, char __user *buf,
-			   size_t count, loff_t *pos)
+static int logger_wait(struct file *file, struct logger_reader *reader)
 {
-	struct logger_reader *reader = file->private_data;
 	struct logger_log *log = reader->log;
-	ssize_t ret;
+	int ret;
 	DEFINE_WAIT(wait);
 
-start:
 	while (1) {
 		prepare_to_wait(&log->wq, &wait, TASK_INTERRUPTIBLE);
 
-		mutex_lock(&log->mutex);
-		ret = (log->w_off == reader->r_off);
-		mutex_unlock(&log->mutex);
+		spin_lock(&log->lock);
+		ret = !reader_catch_up(log, reader);
+		spin_unlock(&log->lock);
 		if (!ret)
 			break;
 
@@ -240,125 +271,220 @@ start:
 	}
 
 	finish_wait(&log->wq, &wait);
+	return ret;
+}
+
+/*
+ * logger_read - our log's read() method
+ *
+ * Behavior:
+ *
+ * 	- O_NONBLOCK works
+ * 	- If there are no log entries to read, blocks until log is written to
+ * 	- Atomically reads exactly one log entry
+ *
+ * Optimal read size is LOGGER_ENTRY_MAX_LEN. Will set errno to EINVAL if read
+ * buffer is insufficient to hold next entry.
+ */
+static ssize_t logger_read(struct file *file, char __user *buf,
+			   size_t count, loff_t *pos)
+{
+	struct logger_reader *reader = file->private_data;
+	struct logger_log *log = reader->log;
+	ssize_t ret;
+
+start:
+	ret = logger_wait(file, reader);
 	if (ret)
 		return ret;
 
-	mutex_lock(&log->mutex);
+	spin_lock(&log->lock);
 
 	/* is there still something to read or did we race? */
-	if (unlikely(log->w_off == reader->r_off)) {
-		mutex_unlock(&log->mutex);
+	if (unlikely(!reader_catch_up(log, reader))) {
+		spin_unlock(&log->lock);
 		goto start;
 	}
 
 	/* get the size of the next entry */
-	ret = get_entry_len(log, reader->r_off);
+	ret = get_entry_len(log, logger_offset(reader->r_pos));
 	if (count < ret) {
-		ret = -EINVAL;
-		goto out;
+		spin_unlock(&log->lock);
+		return -EINVAL;
 	}
 
 	/* get exactly one entry from the log */
-	ret = do_read_log_to_user(log, reader, buf, ret);
+	do_read_log(log, reader, 0, ret);
+	spin_unlock(&log->lock);
 
-out:
-	mutex_unlock(&log->mutex);
+	if (copy_to_user(buf, reader->bounce, ret))
+		return -EFAULT;
 
 	return ret;
 }
 
 /*
- * get_next_entry - return the offset of the first valid entry at least 'len'
- * bytes after 'off'.
+ * logger_read_batch - the LOGGER_READ_BATCH ioctl
  *
- * Caller must hold log->mutex.
+ * Like read(), but fills 'buf' with as many whole entries as fit. Blocks
+ * only if there is nothing to read at all. Returns the number of bytes read.
  */
-static size_t get_next_entry(struct logger_log *log, size_t off, size_t len)
+static long logger_read_batch(struct file *file, void __user *arg)
 {
-	size_t count = 0;
+	struct logger_reader *reader = file->private_data;
+	struct logger_log *log = reader->log;
+	struct logger_read_batch batch;
+	size_t copied = 0;
+	long ret;
 
-	do {
-		size_t nr = get_entry_len(log, off);
-		off = logger_offset(off + nr);
-		count += nr;
-	} while (count < len);
+	if (copy_from_user(&batch, arg, sizeof(batch)))
+		return -EFAULT;
+
+	ret = logger_wait(file, reader);
+	if (ret)
+		return ret;
+
+	while (copied < batch.len) {
+		size_t n = 0;
+
+		spin_lock(&log->lock);
+		while (reader_catch_up(log, reader)) {
+			size_t len = get_entry_len(log,
+						   logger_offset(reader->r_pos));
+			if (n + len > LOGGER_ENTRY_MAX_LEN ||
+			    copied + n + len > batch.len)
+				break;
+			do_read_log(log, reader, n, len);
+			n += len;
+		}
+		spin_unlock(&log->lock);
+
+		if (!n)
+			break;
+		if (copy_to_user(batch.buf + copied, reader->bounce, n))
+			return -EFAULT;
+		copied += n;
+	}
+
+	/* the next entry does not fit at all */
+	if (!copied)
+		return -EINVAL;
 
-	return off;
+	return copied;
 }
 
 /*
- * clock_interval - is a < c < b in mod-space? Put another way, does the line
- * from a to b cross c?
+ * logger_has_room - can 'len' bytes be reserved without overwriting a write
+ * that is still in flight?
  */
-static inline int clock_interval(size_t a, size_t b, size_t c)
-{
-	if (b < a) {
-		if (a < c || b >= c)
-			return 1;
-	} else {
-		if (a < c && b >= c)
-			return 1;
+static inline int logger_has_room(struct logger_log *log, size_t len)
+{
+	return log->w_pos + len - log->c_pos <= log->size;
+}
+
+/*
+ * logger_reserve - reserve 'len' bytes at the write head, pulling log->head
+ * forward past every entry they will overwrite. Returns the position of the
+ * reserved space, which must be filled and then released with
+ * logger_commit().
+ */
+static size_t logger_reserve(struct logger_log *log, size_t len)
+{
+	size_t pos;
+
+	spin_lock(&log->lock);
+	while (unlikely(!logger_has_room(log, len))) {
+		spin_unlock(&log->lock);
+		wait_event(log->wq, logger_has_room(log, len));
+		spin_lock(&log->lock);
 	}
 
-	return 0;
+	while (logger_before(log->head, log->w_pos + len - log->size))
+		log->head += get_entry_len(log, logger_offset(log->head));
+
+	pos = log->w_pos;
+	log->w_pos += len;
+	log->writers++;
+	spin_unlock(&log->lock);
+
+	return pos;
 }
 
 /*
- * fix_up_readers - walk the list of all readers and "fix up" any who were
- * lapped by the writer; also do the same for the default "start head".
- * We do this by "pulling forward" the readers and start head to the first
- * entry after the new write head.
- *
- * The caller needs to hold log->mutex.
+ * logger_commit - finish a write started with logger_reserve(). Entries
+ * become visible to readers once every write in flight has finished.
  */
-static void fix_up_readers(struct logger_log *log, size_t len)
+static void logger_commit(struct logger_log *log)
 {
-	size_t old = log->w_off;
-	size_t new = logger_offset(old + len);
-	struct logger_reader *reader;
+	int done;
 
-	if (clock_interval(old, new, log->head))
-		log->head = get_next_entry(log, log->head, len);
+	spin_lock(&log->lock);
+	done = !--log->writers;
+	if (done) {
+		log->c_pos = log->w_pos;
+		logger_persist_commit(log);
+	}
+	spin_unlock(&log->lock);
 
-	list_for_each_entry(reader, &log->readers, list)
-		if (clock_interval(old, new, reader->r_off))
-			reader->r_off = get_next_entry(log, reader->r_off, len);
+	/* wake up any blocked readers, and writers waiting for room */
+	if (done)
+		wake_up(&log->wq);
 }
 
 /*
- * do_write_log - writes 'len' bytes from 'buf' to 'log'
+ * do_write_log - writes 'count' bytes from 'buf' to 'log' at position 'pos'
  *
- * The caller needs to hold log->mutex.
+ * The caller must have reserved the space with logger_reserve().
  */
-static void do_write_log(struct logger_log *log, const void *buf, size_t count)
+static void do_write_log(struct logger_log *log, size_t pos, const void *buf,
+			 size_t count)
 {
+	size_t off = logger_offset(pos);
 	size_t len;
 
-	len = min(count, log->size - log->w_off);
-	memcpy(log->buffer + log->w_off, buf, len);
+	len = min(count, log->size - off);
+	memcpy(log->buffer + off, buf, len);
 
 	if (count != len)
 		memcpy(log->buffer, buf + len, count - len);
+}
 
-	log->w_off = logger_offset(log->w_off + count);
+/*
+ * do_clear_log - zeroes 'count' bytes of 'log' at position 'pos'
+ *
+ * The caller must have reserved the space with logger_reserve().
+ */
+static void do_clear_log(struct logger_log *log, size_t pos, size_t count)
+{
+	size_t off = logger_offset(pos);
+	size_t len;
+
+	len = min(count, log->size - off);
+	memset(log->buffer + off, 0, len);
 
+	if (count != len)
+		memset(log->buffer, 0, count - len);
 }
 
 /*
  * do_write_log_user - writes 'len' bytes from the user-space buffer 'buf' to
- * the log 'log'
+ * the log 'log' at position 'pos'
  *
- * The caller needs to hold log->mutex.
+ * The caller must have reserved the space with logger_reserve().  A
+ * boot-time "!@" marker is copied to 'klog_buf', which belongs to the
+ * caller because concurrent writers no longer hold a common lock here.
  *
  * Returns 'count' on success, negative error code on failure.
  */
-static ssize_t do_write_log_from_user(struct logger_log *log,
-				      const void __user *buf, size_t count)
+static ssize_t do_write_log_from_user(struct logger_log *log, size_t pos,
+				      const void __user *buf, size_t count,
+				      char *klog_buf)
 {
+	size_t off = logger_offset(pos);
 	size_t len;
 
-	len = min(count, log->size - log->w_off);
-	if (len && copy_from_user(log->buffer + log->w_off, buf, len))
+	len = min(count, log->size - off);
+	if (len && copy_from_user(log->buffer + off, buf, len))
 		return -EFAULT;
 
 	if (count != len)
@@ -369,19 +495,17 @@ static ssize_t do_write_log_from_user(struct logger_log *log,
 /* [LINUSYS] added by khoonk for calculating boot-time  on 20070508  */
 	memset(klog_buf,0,255);
 
-	if(strncmp(log->buffer  + log->w_off,  "!@", 2) == 0) {
+	if(strncmp(log->buffer  + off,  "!@", 2) == 0) {
 		if (count < 255)
-			memcpy(klog_buf,log->buffer  + log->w_off, count);			
+			memcpy(klog_buf,log->buffer  + off, count);			
 		else
-			memcpy(klog_buf,log->buffer  + log->w_off, 255);			
+			memcpy(klog_buf,log->buffer  + off, 255);			
 
 		klog_buf[255]=0;
 }
 /* [LINUSYS] added by khoonk for calculating boot-time  on 20070508  */
 #endif	
 
-	log->w_off = logger_offset(log->w_off + count);
-
 	return count;
 }
 
@@ -394,11 +518,13 @@ ssize_t logger_aio_write(struct kiocb *iocb, const struct iovec *iov,
 			 unsigned long nr_segs, loff_t ppos)
 {
 	struct logger_log *log = file_get_log(iocb->ki_filp);
-	size_t orig = log->w_off;
 	struct logger_entry header;
 	struct timespec now;
+	size_t pos;
 	ssize_t ret = 0;
+	char klog_buf[256];
 
+	klog_buf[0] = 0;
 	now = current_kernel_time();
 
 	header.pid = current->tgid;
@@ -411,17 +537,10 @@ ssize_t logger_aio_write(struct kiocb *iocb, const struct iovec *iov,
 	if (unlikely(!header.len))
 		return 0;
 
-	mutex_lock(&log->mutex);
+	pos = logger_reserve(log, sizeof(struct logger_entry) + header.len);
 
-	/*
-	 * Fix up any readers, pulling them forward to the first readable
-	 * entry after (what will be) the new write offset. We do this now
-	 * because if we partially fail, we can end up with clobbered log
-	 * entries that encroach on readable buffer.
-	 */
-	fix_up_readers(log, sizeof(struct logger_entry) + header.len);
-
-	do_write_log(log, &header, sizeof(struct logger_entry));
+	do_write_log(log, pos, &header, sizeof(struct logger_entry));
+	pos += sizeof(struct logger_entry);
 
 	while (nr_segs-- > 0) {
 		size_t len;
@@ -431,21 +550,21 @@ ssize_t logger_aio_write(struct kiocb *iocb, const struct iovec *iov,
 		len = min_t(size_t, iov->iov_len, header.len - ret);
 
 		/* write out this segment's payload */
-		nr = do_write_log_from_user(log, iov->iov_base, len);
+		nr = do_write_log_from_user(log, pos, iov->iov_base, len,
+					    klog_buf);
 		if (unlikely(nr < 0)) {
-			log->w_off = orig;
-			mutex_unlock(&log->mutex);
-			return nr;
+			/* the space is claimed, leave a blank entry in it */
+			do_clear_log(log, pos, header.len - ret);
+			ret = nr;
+			break;
 		}
 
 		iov++;
+		pos += nr;
 		ret += nr;
 	}
 
-	mutex_unlock(&log->mutex);
-
-	/* wake up any blocked readers */
-	wake_up_interruptible(&log->wq);
+	logger_commit(log);
 
 #if 1
 /* [LINUSYS] added by khoonk for calculating boot-time  on 20070508  */
@@ -486,13 +605,19 @@ static int logger_open(struct inode *inode, struct file *file)
 		if (!reader)
 			return -ENOMEM;
 
+		reader->bounce = kmalloc(LOGGER_ENTRY_MAX_LEN, GFP_KERNEL);
+		if (!reader->bounce) {
+			kfree(reader);
+			return -ENOMEM;
+		}
+
 		reader->log = log;
 		INIT_LIST_HEAD(&reader->list);
 
-		mutex_lock(&log->mutex);
-		reader->r_off = log->head;
+		spin_lock(&log->lock);
+		reader->r_pos = log->head;
 		list_add_tail(&reader->list, &log->readers);
-		mutex_unlock(&log->mutex);
+		spin_unlock(&log->lock);
 
 		file->private_data = reader;
 	} else
@@ -510,7 +635,12 @@ static int logger_release(struct inode *ignored, struct file *file)
 {
 	if (file->f_mode & FMODE_READ) {
 		struct logger_reader *reader = file->private_data;
+		struct logger_log *log = reader->log;
+
+		spin_lock(&log->lock);
 		list_del(&reader->list);
+		spin_unlock(&log->lock);
+		kfree(reader->bounce);
 		kfree(reader);
 	}
 
@@ -540,10 +670,10 @@ static unsigned int logger_poll(struct file *file, poll_table *wait)
 
 	poll_wait(file, &log->wq, wait);
 
-	mutex_lock(&log->mutex);
-	if (log->w_off != reader->r_off)
+	spin_lock(&log->lock);
+	if (reader_catch_up(log, reader))
 		ret |= POLLIN | POLLRDNORM;
-	mutex_unlock(&log->mutex);
+	spin_unlock(&log->lock);
 
 	return ret;
 }
@@ -554,7 +684,13 @@ static long logger_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 	struct logger_reader *reader;
 	long ret = -ENOTTY;
 
-	mutex_lock(&log->mutex);
+	if (cmd == LOGGER_READ_BATCH) {
+		if (!(file->f_mode & FMODE_READ))
+			return -EBADF;
+		return logger_read_batch(file, (void __user *)arg);
+	}
+
+	spin_lock(&log->lock);
 
 	switch (cmd) {
 	case LOGGER_GET_LOG_BUF_SIZE:
@@ -566,10 +702,7 @@ static long logger_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 			break;
 		}
 		reader = file->private_data;
-		if (log->w_off >= reader->r_off)
-			ret = log->w_off - reader->r_off;
-		else
-			ret = (log->size - reader->r_off) + log->w_off;
+		ret = reader_catch_up(log, reader);
 		break;
 	case LOGGER_GET_NEXT_ENTRY_LEN:
 		if (!(file->f_mode & FMODE_READ)) {
@@ -577,8 +710,8 @@ static long logger_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 			break;
 		}
 		reader = file->private_data;
-		if (log->w_off != reader->r_off)
-			ret = get_entry_len(log, reader->r_off);
+		if (reader_catch_up(log, reader))
+			ret = get_entry_len(log, logger_offset(reader->r_pos));
 		else
 			ret = 0;
 		break;
@@ -588,13 +721,13 @@ static long logger_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 			break;
 		}
 		list_for_each_entry(reader, &log->readers, list)
-			reader->r_off = log->w_off;
-		log->head = log->w_off;
+			reader->r_pos = log->c_pos;
+		log->head = log->c_pos;
 		ret = 0;
 		break;
 	}
 
-	mutex_unlock(&log->mutex);
+	spin_unlock(&log->lock);
 
 	return ret;
 }
@@ -627,8 +760,10 @@ static struct logger_log VAR = { \
 	}, \
 	.wq = __WAIT_QUEUE_HEAD_INITIALIZER(VAR .wq), \
 	.readers = LIST_HEAD_INIT(VAR .readers), \
-	.mutex = __MUTEX_INITIALIZER(VAR .mutex), \
-	.w_off = 0, \
+	.lock = __SPIN_LOCK_UNLOCKED(VAR .lock), \
+	.w_pos = 0, \
+	.c_pos = 0, \
+	.writers = 0, \
 	.head = 0, \
 	.size = SIZE, \
 };
@@ -651,6 +786,605 @@ static struct logger_log * get_log_from_minor(int minor)
 	return NULL;
 }
 
+#ifdef CONFIG_ANDROID_LOGGER_PERSIST
+/*
+ * Persistent log storage
+ *
+ * A board can hand us RAM that survives a warm reset as the "logger_persist"
+ * platform device, with one memory resource per log named after the log
+ * ("log_main", "log_radio"). Complete entries are archived into it a chunk
+ * at a time, LZO-compressed if configured, and protected with the same
+ * Reed-Solomon code as the RAM console. On the next boot the archive is
+ * decoded and offered as /proc/last_log_main etc., in the binary format
+ * read(2) returns from /dev/log/.
+ *
+ * The archive trails the live log by less than a chunk; that tail is
+ * flushed on panic and on reboot.
+ */
+
+#define LOGGER_PERSIST_SIG	0x474f4c50	/* PLOG */
+#define LOGGER_PERSIST_CHUNK	CONFIG_ANDROID_LOGGER_PERSIST_CHUNK_SIZE
+
+struct logger_persist_buffer {
+	uint32_t	sig;
+	uint32_t	first;	/* offset of the oldest record */
+	uint32_t	end;	/* offset just past the newest record */
+	uint32_t	used;	/* bytes from 'first' to 'end' */
+	uint8_t		data[0];
+};
+
+/*
+ * Each record holds a chunk of whole entries. A record is compressed if and
+ * only if len < raw_len.
+ */
+struct logger_persist_record {
+	__u16		len;	/* bytes stored after this header */
+	__u16		raw_len; /* bytes of entries it holds */
+};
+
+struct logger_persist {
+	struct logger_persist_buffer *buffer;
+	size_t			size;	/* bytes in buffer->data */
+	size_t			arch_pos; /* log position archived so far */
+#ifdef CONFIG_ANDROID_RAM_CONSOLE_ERROR_CORRECTION
+	uint8_t *		par;	/* ECC_SIZE bytes per data block */
+#endif
+	char *			old_log; /* entries from the last boot */
+	size_t			old_log_size;
+};
+
+static struct logger_log *logger_persist_logs[] = { &log_main, &log_radio };
+
+/*
+ * The worker archives under logger_persist_mutex, so compression stays
+ * preemptible. The scratch space and the archives themselves are owned by
+ * whoever holds the LOGGER_PERSIST_BUSY bit, which the worker takes per
+ * chunk and the panic flush, possibly in interrupt context, only tries for.
+ */
+static DEFINE_MUTEX(logger_persist_mutex);
+static unsigned long logger_persist_flags;
+#define LOGGER_PERSIST_BUSY	0
+static unsigned char *logger_persist_raw;
+#ifdef CONFIG_ANDROID_LOGGER_PERSIST_LZO
+static unsigned char *logger_persist_lzo;
+static void *logger_persist_wrkmem;
+#endif
+
+#ifdef CONFIG_ANDROID_RAM_CONSOLE_ERROR_CORRECTION
+#define ECC_BLOCK_SIZE CONFIG_ANDROID_RAM_CONSOLE_ERROR_CORRECTION_DATA_SIZE
+#define ECC_SIZE CONFIG_ANDROID_RAM_CONSOLE_ERROR_CORRECTION_ECC_SIZE
+#define ECC_SYMSIZE CONFIG_ANDROID_RAM_CONSOLE_ERROR_CORRECTION_SYMBOL_SIZE
+#define ECC_POLY CONFIG_ANDROID_RAM_CONSOLE_ERROR_CORRECTION_POLYNOMIAL
+
+static struct rs_control *logger_persist_rs;
+
+static void logger_persist_encode_rs8(void *data, size_t len, uint8_t *ecc)
+{
+	int i;
+	uint16_t par[ECC_SIZE];
+
+	memset(par, 0, sizeof(par));
+	encode_rs8(logger_persist_rs, data, len, par, 0);
+	for (i = 0; i < ECC_SIZE; i++)
+		ecc[i] = par[i];
+}
+
+static int logger_persist_decode_rs8(void *data, size_t len, uint8_t *ecc)
+{
+	int i;
+	uint16_t par[ECC_SIZE];
+
+	for (i = 0; i < ECC_SIZE; i++)
+		par[i] = ecc[i];
+	return decode_rs8(logger_persist_rs, data, par, len,
+			  NULL, 0, NULL, 0, NULL);
+}
+
+/* logger_persist_ecc - refresh the parity of the blocks under a range */
+static void logger_persist_ecc(struct logger_persist *p, size_t off,
+			       size_t len)
+{
+	size_t block = off & ~(ECC_BLOCK_SIZE - 1);
+
+	do {
+		logger_persist_encode_rs8(p->buffer->data + block,
+			min_t(size_t, ECC_BLOCK_SIZE, p->size - block),
+			p->par + (block / ECC_BLOCK_SIZE) * ECC_SIZE);
+		block += ECC_BLOCK_SIZE;
+	} while (block < off + len);
+}
+
+static void logger_persist_update_header(struct logger_persist *p)
+{
+	logger_persist_encode_rs8(p->buffer, sizeof(*p->buffer), p->par +
+		DIV_ROUND_UP(p->size, ECC_BLOCK_SIZE) * ECC_SIZE);
+}
+
+/*
+ * logger_persist_correct - run the error correction over the header and, if
+ * the header is ours, over the data.
+ */
+static void logger_persist_correct(struct logger_persist *p, const char *name)
+{
+	size_t block;
+	int corrected = 0, bad = 0, numerr;
+
+	numerr = logger_persist_decode_rs8(p->buffer, sizeof(*p->buffer),
+		p->par + DIV_ROUND_UP(p->size, ECC_BLOCK_SIZE) * ECC_SIZE);
+	if (numerr > 0)
+		corrected += numerr;
+	else if (numerr < 0)
+		bad++;
+
+	if (p->buffer->sig != LOGGER_PERSIST_SIG)
+		return;
+
+	for (block = 0; block < p->size; block += ECC_BLOCK_SIZE) {
+		numerr = logger_persist_decode_rs8(p->buffer->data + block,
+			min_t(size_t, ECC_BLOCK_SIZE, p->size - block),
+			p->par + (block / ECC_BLOCK_SIZE) * ECC_SIZE);
+		if (numerr > 0)
+			corrected += numerr;
+		else if (numerr < 0)
+			bad++;
+	}
+
+	if (corrected || bad)
+		printk(KERN_INFO "logger: '%s' persistent log: %d corrected "
+		       "bytes, %d unrecoverable blocks\n",
+		       name, corrected, bad);
+}
+#else
+static inline void logger_persist_ecc(struct logger_persist *p, size_t off,
+				      size_t len) { }
+static inline void logger_persist_update_header(struct logger_persist *p) { }
+static inline void logger_persist_correct(struct logger_persist *p,
+					  const char *name) { }
+#endif
+
+static void logger_persist_read(struct logger_persist *p, size_t off,
+				void *buf, size_t count)
+{
+	size_t len = min(count, p->size - off);
+
+	memcpy(buf, p->buffer->data + off, len);
+	if (count != len)
+		memcpy(buf + len, p->buffer->data, count - len);
+}
+
+static void logger_persist_write(struct logger_persist *p, size_t off,
+				 const void *buf, size_t count)
+{
+	size_t len = min(count, p->size - off);
+
+	memcpy(p->buffer->data + off, buf, len);
+	logger_persist_ecc(p, off, len);
+	if (count != len) {
+		memcpy(p->buffer->data, buf + len, count - len);
+		logger_persist_ecc(p, 0, count - len);
+	}
+}
+
+/*
+ * logger_persist_store - append a record, dropping the oldest ones to make
+ * room. The header is updated before and after the record is written, so a
+ * reset in between loses at most the record being written.
+ */
+static void logger_persist_store(struct logger_persist *p, const void *buf,
+				 size_t len, size_t raw_len)
+{
+	struct logger_persist_buffer *buffer = p->buffer;
+	struct logger_persist_record rec;
+	size_t need = sizeof(rec) + len;
+
+	while (buffer->used + need > p->size) {
+		logger_persist_read(p, buffer->first, &rec, sizeof(rec));
+		if (unlikely(sizeof(rec) + rec.len > buffer->used)) {
+			/* corrupted; start over */
+			buffer->first = buffer->end;
+			buffer->used = 0;
+			break;
+		}
+		buffer->first = (buffer->first + sizeof(rec) + rec.len) %
+				p->size;
+		buffer->used -= sizeof(rec) + rec.len;
+	}
+	logger_persist_update_header(p);
+
+	rec.len = len;
+	rec.raw_len = raw_len;
+	logger_persist_write(p, buffer->end, &rec, sizeof(rec));
+	logger_persist_write(p, (buffer->end + sizeof(rec)) % p->size,
+			     buf, len);
+
+	buffer->end = (buffer->end + need) % p->size;
+	buffer->used += need;
+	logger_persist_update_header(p);
+}
+
+/*
+ * logger_persist_chunk - archive up to a chunk of complete entries from
+ * 'log'. Less than a chunk is only taken when flushing, which must not
+ * block and so stores the entries uncompressed. Returns the number of log
+ * bytes archived.
+ *
+ * Caller must hold the LOGGER_PERSIST_BUSY bit.
+ */
+static size_t logger_persist_chunk(struct logger_log *log, int flush)
+{
+	struct logger_persist *p = log->persist;
+	size_t pos, off, len, n = 0;
+
+	if (flush) {
+		if (!spin_trylock(&log->lock))
+			return 0;
+	} else
+		spin_lock(&log->lock);
+
+	if (logger_before(p->arch_pos, log->head))
+		p->arch_pos = log->head;
+
+	pos = p->arch_pos;
+	while (pos + n != log->c_pos) {
+		len = get_entry_len(log, logger_offset(pos + n));
+		if (n + len > LOGGER_PERSIST_CHUNK)
+			break;
+		n += len;
+	}
+	if (!flush && pos + n == log->c_pos && n < LOGGER_PERSIST_CHUNK)
+		n = 0;
+
+	off = logger_offset(pos);
+	len = min(n, log->size - off);
+	memcpy(logger_persist_raw, log->buffer + off, len);
+	if (n != len)
+		memcpy(logger_persist_raw + len, log->buffer, n - len);
+	p->arch_pos += n;
+
+	spin_unlock(&log->lock);
+
+	if (!n)
+		return 0;
+
+#ifdef CONFIG_ANDROID_LOGGER_PERSIST_LZO
+	if (!flush &&
+	    lzo1x_1_compress(logger_persist_raw, n, logger_persist_lzo, &len,
+			     logger_persist_wrkmem) == LZO_E_OK && len < n) {
+		logger_persist_store(p, logger_persist_lzo, len, n);
+		return n;
+	}
+#endif
+	logger_persist_store(p, logger_persist_raw, n, n);
+	return n;
+}
+
+static int logger_persist_get(void)
+{
+	return !test_and_set_bit(LOGGER_PERSIST_BUSY, &logger_persist_flags);
+}
+
+static void logger_persist_put(void)
+{
+	smp_mb__before_clear_bit();
+	clear_bit(LOGGER_PERSIST_BUSY, &logger_persist_flags);
+}
+
+/* logger_persist_work_fn - archive whole chunks */
+static void logger_persist_work_fn(struct work_struct *work)
+{
+	size_t n;
+	int i;
+
+	mutex_lock(&logger_persist_mutex);
+	for (i = 0; i < ARRAY_SIZE(logger_persist_logs); i++) {
+		struct logger_log *log = logger_persist_logs[i];
+
+		if (!log->persist)
+			continue;
+		do {
+			if (!logger_persist_get())
+				goto out;
+			n = logger_persist_chunk(log, 0);
+			logger_persist_put();
+		} while (n);
+	}
+out:
+	mutex_unlock(&logger_persist_mutex);
+}
+
+static DECLARE_WORK(logger_persist_work, logger_persist_work_fn);
+
+/*
+ * logger_persist_commit - kick the archiver once a chunk's worth of entries
+ * is complete.
+ *
+ * Caller must hold log->lock.
+ */
+static void logger_persist_commit(struct logger_log *log)
+{
+	struct logger_persist *p = log->persist;
+
+	if (p && log->c_pos - p->arch_pos >= LOGGER_PERSIST_CHUNK)
+		schedule_work(&logger_persist_work);
+}
+
+/*
+ * logger_persist_flush - archive everything, on a best effort basis. Gives
+ * up if the worker is in the middle of a chunk.
+ */
+static void logger_persist_flush(void)
+{
+	int i;
+
+	if (!logger_persist_get())
+		return;
+
+	for (i = 0; i < ARRAY_SIZE(logger_persist_logs); i++) {
+		struct logger_log *log = logger_persist_logs[i];
+
+		if (log->persist)
+			while (logger_persist_chunk(log, 1))
+				;
+	}
+
+	logger_persist_put();
+}
+
+static int logger_persist_panic(struct notifier_block *nb,
+				unsigned long event, void *unused)
+{
+	logger_persist_flush();
+	return NOTIFY_DONE;
+}
+
+/* a reboot can wait for the worker to finish its chunk */
+static int logger_persist_reboot(struct notifier_block *nb,
+				 unsigned long event, void *unused)
+{
+	mutex_lock(&logger_persist_mutex);
+	logger_persist_flush();
+	mutex_unlock(&logger_persist_mutex);
+	return NOTIFY_DONE;
+}
+
+static struct notifier_block logger_persist_panic_nb = {
+	.notifier_call = logger_persist_panic,
+};
+
+static struct notifier_block logger_persist_reboot_nb = {
+	.notifier_call = logger_persist_reboot,
+};
+
+/*
+ * logger_persist_walk - step over the record at 'off' if it is sane.
+ * Returns the record's size, or zero at the end of the archive.
+ */
+static size_t logger_persist_walk(struct logger_persist *p, size_t off,
+				  size_t left,
+				  struct logger_persist_record *rec)
+{
+	if (left < sizeof(*rec))
+		return 0;
+	logger_persist_read(p, off, rec, sizeof(*rec));
+	if (!rec->len || rec->len > rec->raw_len ||
+	    rec->raw_len > LOGGER_PERSIST_CHUNK ||
+	    sizeof(*rec) + rec->len > left)
+		return 0;
+	return sizeof(*rec) + rec->len;
+}
+
+/*
+ * logger_persist_recover - unpack the archive left by the previous boot
+ * into p->old_log. Records that fail to decompress are skipped.
+ */
+static void __devinit logger_persist_recover(struct logger_persist *p,
+					     const char *name)
+{
+	struct logger_persist_buffer *buffer = p->buffer;
+	struct logger_persist_record rec;
+	size_t off, left, step, total = 0;
+	int dropped = 0;
+
+	logger_persist_correct(p, name);
+
+	if (buffer->sig != LOGGER_PERSIST_SIG || buffer->first >= p->size ||
+	    buffer->used > p->size ||
+	    (buffer->first + buffer->used) % p->size != buffer->end) {
+		printk(KERN_INFO "logger: no persistent log for '%s'\n", name);
+		return;
+	}
+
+	for (off = buffer->first, left = buffer->used;
+	     (step = logger_persist_walk(p, off, left, &rec));
+	     off = (off + step) % p->size, left -= step)
+		total += rec.raw_len;
+	if (!total)
+		return;
+
+	p->old_log = vmalloc(total);
+	if (!p->old_log) {
+		printk(KERN_ERR "logger: failed to allocate %zu bytes for "
+		       "the last '%s'\n", total, name);
+		return;
+	}
+
+	for (off = buffer->first, left = buffer->used;
+	     (step = logger_persist_walk(p, off, left, &rec));
+	     off = (off + step) % p->size, left -= step) {
+		char *dst = p->old_log + p->old_log_size;
+		size_t src = (off + sizeof(rec)) % p->size;
+
+		if (rec.len == rec.raw_len) {
+			logger_persist_read(p, src, dst, rec.len);
+			p->old_log_size += rec.len;
+			continue;
+		}
+#ifdef CONFIG_ANDROID_LOGGER_PERSIST_LZO
+		{
+			size_t len = rec.raw_len;
+
+			logger_persist_read(p, src, logger_persist_lzo,
+					    rec.len);
+			if (lzo1x_decompress_safe(logger_persist_lzo, rec.len,
+						  dst, &len) == LZO_E_OK &&
+			    len == rec.raw_len) {
+				p->old_log_size += len;
+				continue;
+			}
+		}
+#endif
+		dropped++;
+	}
+
+	printk(KERN_INFO "logger: recovered %zu bytes of the last '%s'",
+	       p->old_log_size, name);
+	if (dropped)
+		printk(", %d chunks lost", dropped);
+	printk("\n");
+}
+
+static ssize_t logger_persist_read_old(struct file *file, char __user *buf,
+				       size_t len, loff_t *offset)
+{
+	struct logger_persist *p = PDE(file->f_path.dentry->d_inode)->data;
+	loff_t pos = *offset;
+	ssize_t count;
+
+	if (pos >= p->old_log_size)
+		return 0;
+
+	count = min(len, (size_t)(p->old_log_size - pos));
+	if (copy_to_user(buf, p->old_log + pos, count))
+		return -EFAULT;
+
+	*offset += count;
+	return count;
+}
+
+static const struct file_operations logger_persist_fops = {
+	.owner = THIS_MODULE,
+	.read = logger_persist_read_old,
+};
+
+static int __devinit logger_persist_attach(struct logger_log *log,
+					   struct resource *res)
+{
+	struct logger_persist *p;
+	size_t buffer_size = res->end - res->start + 1;
+	ssize_t size;
+	char name[32];
+
+	size = buffer_size - sizeof(struct logger_persist_buffer);
+#ifdef CONFIG_ANDROID_RAM_CONSOLE_ERROR_CORRECTION
+	size -= (DIV_ROUND_UP(size, ECC_BLOCK_SIZE) + 1) * ECC_SIZE;
+#endif
+	if (size < 2 * (LOGGER_PERSIST_CHUNK +
+			(ssize_t)sizeof(struct logger_persist_record))) {
+		printk(KERN_ERR "logger: persistent area for '%s' too small\n",
+		       log->misc.name);
+		return -EINVAL;
+	}
+
+	p = kzalloc(sizeof(*p), GFP_KERNEL);
+	if (!p)
+		return -ENOMEM;
+
+	p->buffer = ioremap(res->start, buffer_size);
+	if (!p->buffer) {
+		printk(KERN_ERR "logger: failed to map persistent area for "
+		       "'%s'\n", log->misc.name);
+		kfree(p);
+		return -ENOMEM;
+	}
+	p->size = size;
+#ifdef CONFIG_ANDROID_RAM_CONSOLE_ERROR_CORRECTION
+	p->par = p->buffer->data + p->size;
+#endif
+
+	logger_persist_recover(p, log->misc.name);
+
+	p->buffer->sig = LOGGER_PERSIST_SIG;
+	p->buffer->first = 0;
+	p->buffer->end = 0;
+	p->buffer->used = 0;
+	logger_persist_update_header(p);
+
+	if (p->old_log_size) {
+		snprintf(name, sizeof(name), "last_%s", log->misc.name);
+		if (!proc_create_data(name, S_IRUSR, NULL,
+				      &logger_persist_fops, p))
+			printk(KERN_ERR "logger: failed to create /proc/%s\n",
+			       name);
+	}
+
+	spin_lock(&log->lock);
+	p->arch_pos = log->head;
+	log->persist = p;
+	spin_unlock(&log->lock);
+
+	printk(KERN_INFO "logger: keeping %zuK of '%s' in persistent RAM\n",
+	       p->size >> 10, log->misc.name);
+
+	return 0;
+}
+
+static int __devinit logger_persist_probe(struct platform_device *pdev)
+{
+	struct resource *res;
+	int i, attached = 0;
+
+#ifdef CONFIG_ANDROID_RAM_CONSOLE_ERROR_CORRECTION
+	logger_persist_rs = init_rs(ECC_SYMSIZE, ECC_POLY, 0, 1, ECC_SIZE);
+	if (!logger_persist_rs)
+		return -ENOMEM;
+#endif
+	logger_persist_raw = kmalloc(LOGGER_PERSIST_CHUNK, GFP_KERNEL);
+	if (!logger_persist_raw)
+		goto err_alloc;
+#ifdef CONFIG_ANDROID_LOGGER_PERSIST_LZO
+	logger_persist_lzo = kmalloc(lzo1x_worst_compress(LOGGER_PERSIST_CHUNK),
+				     GFP_KERNEL);
+	logger_persist_wrkmem = vmalloc(LZO1X_1_MEM_COMPRESS);
+	if (!logger_persist_lzo || !logger_persist_wrkmem)
+		goto err_alloc;
+#endif
+
+	for (i = 0; i < ARRAY_SIZE(logger_persist_logs); i++) {
+		struct logger_log *log = logger_persist_logs[i];
+
+		res = platform_get_resource_byname(pdev, IORESOURCE_MEM,
+						   log->misc.name);
+		if (res && !logger_persist_attach(log, res))
+			attached++;
+	}
+	if (!attached)
+		goto err_alloc;
+
+	atomic_notifier_chain_register(&panic_notifier_list,
+				       &logger_persist_panic_nb);
+	register_reboot_notifier(&logger_persist_reboot_nb);
+	return 0;
+
+err_alloc:
+#ifdef CONFIG_ANDROID_LOGGER_PERSIST_LZO
+	vfree(logger_persist_wrkmem);
+	kfree(logger_persist_lzo);
+#endif
+	kfree(logger_persist_raw);
+#ifdef CONFIG_ANDROID_RAM_CONSOLE_ERROR_CORRECTION
+	free_rs(logger_persist_rs);
+#endif
+	return -ENOMEM;
+}
+
+static struct platform_driver logger_persist_driver = {
+	.probe = logger_persist_probe,
+	.driver = {
+		.name = "logger_persist",
+	},
+};
+#endif /* CONFIG_ANDROID_LOGGER_PERSIST */
+
 static int __init init_log(struct logger_log *log)
 {
 	int ret;
@@ -681,7 +1415,12 @@ static int __init logger_init(void)
 	plat_log_mark.p_audio = _buf_log_audio;
 
 	marks_ver_mark.log_mark_version = 1; 
-	
+
+#ifdef CONFIG_ANDROID_LOGGER_PERSIST
+	/* boards register the area early, so this attaches before any use */
+	platform_driver_register(&logger_persist_driver);
+#endif
+
 	ret = init_log(&log_main);
 	if (unlikely(ret))
 		goto out;
@@ -39,11 +39,21 @@ struct logger_entry {
 #define LOGGER_ENTRY_MAX_PAYLOAD	\
 	(LOGGER_ENTRY_MAX_LEN - sizeof(struct logger_entry))
 
+/*
+ * Argument of LOGGER_READ_BATCH: 'buf' is filled with as many whole entries
+ * as fit in 'len' bytes.
+ */
+struct logger_read_batch {
+	char __user	*buf;
+	size_t		len;
+};
+
 #define __LOGGERIO	0xAE
 
 #define LOGGER_GET_LOG_BUF_SIZE		_IO(__LOGGERIO, 1) /* size of log */
 #define LOGGER_GET_LOG_LEN		_IO(__LOGGERIO, 2) /* used log len */
 #define LOGGER_GET_NEXT_ENTRY_LEN	_IO(__LOGGERIO, 3) /* next entry len */
 #define LOGGER_FLUSH_LOG		_IO(__LOGGERIO, 4) /* flush log */
+#define LOGGER_READ_BATCH		_IOW(__LOGGERIO, 5, struct logger_read_batch) /* read many entries */
 
 #endif /* _LINUX_LOGGER_H */
@@ -18,6 +18,13 @@
 #include <linux/mm.h>
 #include <linux/oom.h>
 #include <linux/sched.h>
+#include <linux/spinlock.h>
+#include <linux/swap.h>
+#include <linux/vmstat.h>
+#include <linux/kobject.h>
+#include <linux/sysfs.h>
+#include <linux/ashmem.h>
+#include <linux/profile.h>
 
 static int lowmem_shrink(int nr_to_scan, gfp_t gfp_mask);
 
@@ -42,23 +49,227 @@ static size_t lowmem_minfree[6] = {
 static int lowmem_minfree_size = 4;
 static int lowmem_file_free = 23500;
 
+/*
+ * In pressure mode the file pages compared against minfree are scaled by
+ * how well reclaim did over the last window, and pages that ashmem or swap
+ * can give back are counted as well.
+ */
+static uint32_t lowmem_pressure;
+static uint32_t lowmem_pressure_window_ms = 1000;
+
+/* protects everything below */
+static DEFINE_SPINLOCK(lowmem_lock);
+
+/*
+ * The last victim, while it may still be freeing its memory. Killing again
+ * before it is gone only takes out more processes than the shortage needs.
+ */
+static struct pid *lowmem_deathpending;
+static unsigned long lowmem_deathpending_start;
+static unsigned long lowmem_deathpending_timeout;
+static int lowmem_deathpending_size;
+
+/* reclaim efficiency, in percent of the pages scanned in the last window */
+static unsigned long lowmem_window_end = INITIAL_JIFFIES;
+static unsigned long lowmem_window_scanned;
+static unsigned long lowmem_window_reclaimed;
+static int lowmem_efficiency = 100;
+
+/* kill accounting, exported in /sys/kernel/lowmemorykiller/ */
+static unsigned int lowmem_kills[OOM_ADJ_BUCKETS];
+static unsigned int lowmem_freed;
+static unsigned int lowmem_stuck;
+static u64 lowmem_freed_bytes;
+static unsigned long lowmem_free_time_total;
+static unsigned long lowmem_free_time_max;
+
 #define lowmem_print(level, x...) do { if(lowmem_debug_level >= (level)) printk(x); } while(0)
 
 module_param_named(cost, lowmem_shrinker.seeks, int, S_IRUGO | S_IWUSR);
 module_param_array_named(adj, lowmem_adj, int, &lowmem_adj_size, S_IRUGO | S_IWUSR);
 module_param_array_named(minfree, lowmem_minfree, uint, &lowmem_minfree_size, S_IRUGO | S_IWUSR);
 module_param_named(debug_level, lowmem_debug_level, uint, S_IRUGO | S_IWUSR);
+module_param_named(pressure, lowmem_pressure, uint, S_IRUGO | S_IWUSR);
+module_param_named(pressure_window_ms, lowmem_pressure_window_ms, uint, S_IRUGO | S_IWUSR);
 // module_param_named(filefree, lowmem_file_free, int, S_IRUGO | S_IWUSR);
 
-static int lowmem_shrink(int nr_to_scan, gfp_t gfp_mask)
+/*
+ * lowmem_victim_gone - account the last victim as having freed its memory.
+ *
+ * Caller must hold lowmem_lock.
+ */
+static void lowmem_victim_gone(void)
+{
+	unsigned long elapsed = jiffies - lowmem_deathpending_start;
+
+	lowmem_freed++;
+	lowmem_freed_bytes += (u64)lowmem_deathpending_size << PAGE_SHIFT;
+	lowmem_free_time_total += elapsed;
+	if (elapsed > lowmem_free_time_max)
+		lowmem_free_time_max = elapsed;
+	put_pid(lowmem_deathpending);
+	lowmem_deathpending = NULL;
+}
+
+/*
+ * lowmem_victim_exiting - is the last victim still on its way out? Gives up
+ * on it, and counts it as stuck, if it still holds its mm a second after
+ * the kill.
+ */
+static int lowmem_victim_exiting(void)
+{
+	struct task_struct *p;
+	int exiting = 0;
+
+	spin_lock(&lowmem_lock);
+	if (lowmem_deathpending) {
+		rcu_read_lock();
+		p = pid_task(lowmem_deathpending, PIDTYPE_PID);
+		exiting = p && p->mm;
+		rcu_read_unlock();
+		if (!exiting)
+			lowmem_victim_gone();
+		else if (time_after(jiffies, lowmem_deathpending_timeout)) {
+			lowmem_stuck++;
+			put_pid(lowmem_deathpending);
+			lowmem_deathpending = NULL;
+			exiting = 0;
+		}
+	}
+	spin_unlock(&lowmem_lock);
+
+	return exiting;
+}
+
+/*
+ * With CONFIG_PROFILING the victim is settled as soon as it exits; without
+ * it, on the next shrinker call.
+ */
+static int lowmem_task_exit(struct notifier_block *self, unsigned long val,
+			    void *data)
+{
+	struct task_struct *task = data;
+
+	spin_lock(&lowmem_lock);
+	if (lowmem_deathpending && task_pid(task) == lowmem_deathpending)
+		lowmem_victim_gone();
+	spin_unlock(&lowmem_lock);
+
+	return NOTIFY_OK;
+}
+
+static struct notifier_block lowmem_task_exit_nb = {
+	.notifier_call = lowmem_task_exit,
+};
+
+static void lowmem_set_victim(struct task_struct *p, int tasksize)
+{
+	spin_lock(&lowmem_lock);
+	put_pid(lowmem_deathpending);
+	lowmem_deathpending = get_task_pid(p, PIDTYPE_PID);
+	lowmem_deathpending_start = jiffies;
+	lowmem_deathpending_timeout = jiffies + HZ;
+	lowmem_deathpending_size = tasksize;
+	lowmem_kills[p->oomkilladj - OOM_DISABLE]++;
+	spin_unlock(&lowmem_lock);
+}
+
+#ifdef CONFIG_VM_EVENT_COUNTERS
+/*
+ * lowmem_update_efficiency - once per window, work out what share of the
+ * pages vmscan looked at it managed to reclaim. A low share means the page
+ * cache is being refaulted as fast as it is dropped.
+ */
+static void lowmem_update_efficiency(void)
+{
+	unsigned long events[NR_VM_EVENT_ITEMS];
+	unsigned long scanned = 0, reclaimed = 0;
+	int i;
+
+	if (time_before(jiffies, lowmem_window_end))
+		return;
+
+	all_vm_events(events);
+	for (i = PGREFILL_MOVABLE + 1; i <= PGSTEAL_MOVABLE; i++)
+		reclaimed += events[i];
+	for (i = PGSTEAL_MOVABLE + 1; i <= PGSCAN_DIRECT_MOVABLE; i++)
+		scanned += events[i];
+
+	spin_lock(&lowmem_lock);
+	if (scanned != lowmem_window_scanned)
+		lowmem_efficiency = min_t(unsigned long, 100,
+			100 * (reclaimed - lowmem_window_reclaimed) /
+			(scanned - lowmem_window_scanned));
+	else
+		lowmem_efficiency = 100;
+	lowmem_window_scanned = scanned;
+	lowmem_window_reclaimed = reclaimed;
+	lowmem_window_end = jiffies +
+			    msecs_to_jiffies(lowmem_pressure_window_ms);
+	spin_unlock(&lowmem_lock);
+}
+#else
+static inline void lowmem_update_efficiency(void) { }
+#endif
+
+/*
+ * lowmem_pressure_file - the pages we count as about to be free, besides
+ * the free ones, in pressure mode
+ */
+static int lowmem_pressure_file(int other_file)
+{
+	long other = other_file;
+
+	lowmem_update_efficiency();
+	other = other * lowmem_efficiency / 100;
+	other += ashmem_unpinned_pages();
+	if (total_swap_pages)
+		other += min(nr_swap_pages,
+			     (long)global_page_state(NR_INACTIVE_ANON));
+	return other;
+}
+
+/*
+ * lowmem_select - pick the largest process in the highest populated
+ * oomkilladj bucket at or above 'min_adj'.
+ *
+ * Caller must hold tasklist_lock.
+ */
+static struct task_struct *lowmem_select(int min_adj, int *selected_tasksize)
 {
 	struct task_struct *p;
 	struct task_struct *selected = NULL;
-	int rem = 0;
 	int tasksize;
+	int adj;
+
+	min_adj = max(min_adj, OOM_DISABLE);
+	for (adj = OOM_ADJUST_MAX; adj >= min_adj && !selected; adj--) {
+		list_for_each_entry(p, oom_adj_bucket(adj), oom_adj_list) {
+			if (!p->mm)
+				continue;
+			tasksize = get_mm_rss(p->mm);
+			if (tasksize <= 0)
+				continue;
+			if (selected && tasksize <= *selected_tasksize)
+				continue;
+			selected = p;
+			*selected_tasksize = tasksize;
+			lowmem_print(2, "select %d (%s), adj %d, size %d, to kill\n",
+			             p->pid, p->comm, p->oomkilladj, tasksize);
+		}
+	}
+
+	return selected;
+}
+
+static int lowmem_shrink(int nr_to_scan, gfp_t gfp_mask)
+{
+	struct task_struct *selected;
+	int rem = 0;
 	int i;
 	int min_adj = OOM_ADJUST_MAX + 1;
 	int selected_tasksize = 0;
+	int exiting;
 	int array_size = ARRAY_SIZE(lowmem_adj);
 	int other_free = global_page_state(NR_FREE_PAGES);
 	/* hs0501.yang Changed criterion of LMK 
@@ -74,6 +285,9 @@ static int lowmem_shrink(int nr_to_scan, gfp_t gfp_mask)
 	if(lowmem_minfree_size < array_size)
 		array_size = lowmem_minfree_size;
 
+	if (lowmem_pressure)
+		other_file = lowmem_pressure_file(other_file);
+
 	for(i = 0; i < array_size; i++) {
 #if 1	// yjjung_20100524, compare the sum of free+file with lowmem_minfree 
 		if (other_free + other_file < lowmem_minfree[i])
@@ -92,35 +306,26 @@ static int lowmem_shrink(int nr_to_scan, gfp_t gfp_mask)
 		global_page_state(NR_ACTIVE_FILE) +
 		global_page_state(NR_INACTIVE_ANON) +
 		global_page_state(NR_INACTIVE_FILE);
+	/* settle the last victim on every call, so its exit time is close */
+	exiting = lowmem_victim_exiting();
 	if (nr_to_scan <= 0 || min_adj == OOM_ADJUST_MAX + 1) {
 		lowmem_print(5, "lowmem_shrink %d, %x, return %d\n", nr_to_scan, gfp_mask, rem);
 		return rem;
 	}
 
-	read_lock(&tasklist_lock);
-	for_each_process(p) {
-		if (p->oomkilladj < min_adj || !p->mm)
-			continue;
-		tasksize = get_mm_rss(p->mm);
-		if (tasksize <= 0)
-			continue;
-		if (selected) {
-			if (p->oomkilladj < selected->oomkilladj)
-				continue;
-			if (p->oomkilladj == selected->oomkilladj &&
-			    tasksize <= selected_tasksize)
-				continue;
-		}
-		selected = p;
-		selected_tasksize = tasksize;
-		lowmem_print(2, "select %d (%s), adj %d, size %d, to kill\n",
-		             p->pid, p->comm, p->oomkilladj, tasksize);
+	if (exiting) {
+		lowmem_print(4, "lowmem_shrink %d, %x, victim exiting, return %d\n", nr_to_scan, gfp_mask, rem);
+		return rem;
 	}
+
+	read_lock(&tasklist_lock);
+	selected = lowmem_select(min_adj, &selected_tasksize);
 	if(selected != NULL) {
 		lowmem_print(1, "send sigkill to %d (%s), adj %d, size %d\n",
 		             selected->pid, selected->comm,
 		             selected->oomkilladj, selected_tasksize);
 		force_sig(SIGKILL, selected);
+		lowmem_set_victim(selected, selected_tasksize);
 		rem -= selected_tasksize;
 	}
 	lowmem_print(4, "lowmem_shrink %d, %x, return %d\n", nr_to_scan, gfp_mask, rem);
@@ -128,15 +333,104 @@ static int lowmem_shrink(int nr_to_scan, gfp_t gfp_mask)
 	return rem;
 }
 
+static ssize_t kills_show(struct kobject *kobj, struct kobj_attribute *attr,
+			  char *buf)
+{
+	ssize_t len = 0;
+	int i;
+
+	spin_lock(&lowmem_lock);
+	for (i = 0; i < OOM_ADJ_BUCKETS; i++)
+		if (lowmem_kills[i])
+			len += scnprintf(buf + len, PAGE_SIZE - len, "%d %u\n",
+					 i + OOM_DISABLE, lowmem_kills[i]);
+	spin_unlock(&lowmem_lock);
+
+	return len;
+}
+
+static ssize_t freed_show(struct kobject *kobj, struct kobj_attribute *attr,
+			  char *buf)
+{
+	ssize_t len;
+
+	spin_lock(&lowmem_lock);
+	len = sprintf(buf, "%u %llu\n", lowmem_freed,
+		      (unsigned long long)lowmem_freed_bytes);
+	spin_unlock(&lowmem_lock);
+
+	return len;
+}
+
+static ssize_t time_to_free_show(struct kobject *kobj,
+				 struct kobj_attribute *attr, char *buf)
+{
+	ssize_t len;
+
+	spin_lock(&lowmem_lock);
+	len = sprintf(buf, "%u %u %u\n",
+		      lowmem_freed ? jiffies_to_msecs(lowmem_free_time_total) /
+				     lowmem_freed : 0,
+		      jiffies_to_msecs(lowmem_free_time_max), lowmem_stuck);
+	spin_unlock(&lowmem_lock);
+
+	return len;
+}
+
+static ssize_t efficiency_show(struct kobject *kobj,
+			       struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%d\n", lowmem_efficiency);
+}
+
+/*
+ * kills:        "<adj> <count>" for every level that lost a process
+ * freed:        victims seen exiting, and the resident bytes they held
+ * time_to_free: average and worst milliseconds from the kill until the
+ *               victim released its memory, and victims that never did
+ * efficiency:   percent of scanned pages reclaimed in the last window
+ */
+static struct kobj_attribute lowmem_attrs[] = {
+	__ATTR_RO(kills),
+	__ATTR_RO(freed),
+	__ATTR_RO(time_to_free),
+	__ATTR_RO(efficiency),
+};
+
+static struct attribute *lowmem_attr_list[] = {
+	&lowmem_attrs[0].attr,
+	&lowmem_attrs[1].attr,
+	&lowmem_attrs[2].attr,
+	&lowmem_attrs[3].attr,
+	NULL,
+};
+
+static struct attribute_group lowmem_attr_group = {
+	.attrs = lowmem_attr_list,
+};
+
+static struct kobject *lowmem_kobj;
+
 static int __init lowmem_init(void)
 {
+	profile_event_register(PROFILE_TASK_EXIT, &lowmem_task_exit_nb);
 	register_shrinker(&lowmem_shrinker);
+
+	lowmem_kobj = kobject_create_and_add("lowmemorykiller", kernel_kobj);
+	if (!lowmem_kobj ||
+	    sysfs_create_group(lowmem_kobj, &lowmem_attr_group))
+		printk(KERN_WARNING "lowmemorykiller: no sysfs statistics\n");
 	return 0;
 }
 
 static void __exit lowmem_exit(void)
 {
+	if (lowmem_kobj) {
+		sysfs_remove_group(lowmem_kobj, &lowmem_attr_group);
+		kobject_put(lowmem_kobj);
+	}
 	unregister_shrinker(&lowmem_shrinker);
+	profile_event_unregister(PROFILE_TASK_EXIT, &lowmem_task_exit_nb);
 }
 
 module_init(lowmem_init);
@@ -0,0 +1,105 @@
+/**
+ *   @mainpage   Flex Sector Remapper : LinuStoreIII_1.2.0_b032-FSR_1.2.1p1_b129_RTM
+ *
+ *   @section Intro
+ *       Flash Translation Layer for Flex-OneNAND and OneNAND
+ *
+ *    @section  Copyright
+ *---------------------------------------------------------------------------*
+ *                                                                           *
+ * Copyright (C) 2003-2010 Samsung Electronics                               *
+ * This program is free software; you can redistribute it and/or modify      *
+ * it under the terms of the GNU General Public License version 2 as         *
+ * published by the Free Software Foundation.                                *
+ *                                                                           *
+ *---------------------------------------------------------------------------*
+ *
+ *     @section Description
+ *
+ */
+
+/**
+ * @file      FSR_LLD_RAM.h
+ * @brief     declarations of exported functions of the RAM simulator LLD
+ * @remark
+ * REVISION HISTORY
+ * @n  first writing
+ *
+ */
+
+#ifndef _FSR_RAM_LLD_H_
+#define _FSR_RAM_LLD_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*****************************************************************************/
+/* exported common APIs                                                      */
+/*****************************************************************************/
+INT32   FSR_RAM_Init            (UINT32         nFlag);
+INT32   FSR_RAM_Open            (UINT32         nDev,
+                                 VOID          *pParam,
+                                 UINT32         nFlag);
+INT32   FSR_RAM_Close           (UINT32         nDev,
+                                 UINT32         nFlag);
+INT32   FSR_RAM_Read            (UINT32         nDev,
+                                 UINT32         nPbn,
+                                 UINT32         nPgOffset,
+                                 UINT8         *pMBuf,
+                                 FSRSpareBuf   *pSBuf,
+                                 UINT32         nFlag);
+INT32   FSR_RAM_ReadOptimal     (UINT32         nDev,
+                                 UINT32         nPbn,
+                                 UINT32         nPgOffset,
+                                 UINT8         *pMBuf,
+                                 FSRSpareBuf   *pSBuf,
+                                 UINT32         nFlag);
+INT32   FSR_RAM_Write           (UINT32         nDev,
+                                 UINT32         nPbn,
+                                 UINT32         nPgOffset,
+                                 UINT8         *pMBuf,
+                                 FSRSpareBuf   *pSBuf,
+                                 UINT32         nFlag);
+INT32   FSR_RAM_Erase           (UINT32         nDev,
+                                 UINT32        *pnPbn,
+                                 UINT32         nNumOfBlks,
+                                 UINT32         nFlag);
+INT32   FSR_RAM_CopyBack        (UINT32         nDev,
+                                 LLDCpBkArg    *pstCpArg,
+                                 UINT32         nFlag);
+INT32   FSR_RAM_ChkBadBlk       (UINT32         nDev,
+                                 UINT32         nPbn,
+                                 UINT32         nFlag);
+INT32   FSR_RAM_FlushOp         (UINT32         nDev,
+                                 UINT32         nDieIdx,
+                                 UINT32         nFlag);
+INT32   FSR_RAM_GetBlockInfo    (UINT32         nDev,
+                                 UINT32         nPbn,
+                                 UINT32        *pBlockType,
+                                 UINT32        *pPgsPerBlk);
+INT32   FSR_RAM_GetDevSpec      (UINT32         nDev,
+                                 FSRDevSpec    *pstDevSpec,
+                                 UINT32         nFlag);
+INT32   FSR_RAM_GetPlatformInfo (UINT32         nDev,
+                               LLDPlatformInfo *pLLDPltInfo);
+INT32   FSR_RAM_GetPrevOpData   (UINT32         nDev,
+                                 UINT8         *pMBuf,
+                                 FSRSpareBuf   *pSBuf,
+                                 UINT32         nDieIdx,
+                                 UINT32         nFlag);
+INT32   FSR_RAM_IOCtl           (UINT32         nDev,
+                                 UINT32         nCode,
+                                 UINT8         *pBufI,
+                                 UINT32         nLenI,
+                                 UINT8         *pBufO,
+                                 UINT32         nLenO,
+                                 UINT32        *pByteRet);
+INT32   FSR_RAM_InitLLDStat     (VOID);
+INT32   FSR_RAM_GetStat         (FSRLLDStat    *pstStat);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* _FSR_RAM_LLD_H_ */
@@ -0,0 +1,1666 @@
+/**
+ *   @mainpage   Flex Sector Remapper : LinuStoreIII_1.2.0_b032-FSR_1.2.1p1_b129_RTM
+ *
+ *   @section Intro
+ *       Flash Translation Layer for Flex-OneNAND and OneNAND
+ *
+ *   @section  Copyright
+ *---------------------------------------------------------------------------*
+ *                                                                           *
+ * Copyright (C) 2003-2010 Samsung Electronics                               *
+ * This program is free software; you can redistribute it and/or modify      *
+ * it under the terms of the GNU General Public License version 2 as         *
+ * published by the Free Software Foundation.                                *
+ *                                                                           *
+ *---------------------------------------------------------------------------*
+ *
+ *     @section Description
+ *
+ */
+
+/**
+ * @file      FSR_LLD_RAM.c
+ * @brief     This file implements a Low Level Driver which simulates
+ * @n         a SLC OneNAND device in system memory
+ * @remark    The array keeps main and spare of every page back to back,
+ * @n         with the spare laid out the way 4K OneNAND stores it
+ * @n         (6 user bytes and 10 H/W ECC bytes per sector). An image
+ * @n         dumped from a real device with FSR_LLD_FLAG_DUMP_ON can be
+ * @n         loaded as is, which is how a volume with valid BBM meta data
+ * @n         gets in front of the read only BML.
+ * @n
+ * @n         Busy time of load, program and erase is modelled against the
+ * @n         wall clock, so a transfer which follows a load only waits for
+ * @n         the part of tR the caller has not already spent elsewhere.
+ * REVISION HISTORY
+ * @n  first writing
+ */
+
+/******************************************************************************/
+/* Header file inclusions                                                     */
+/******************************************************************************/
+#define     FSR_NO_INCLUDE_BML_HEADER
+#define     FSR_NO_INCLUDE_STL_HEADER
+
+#include    "FSR.h"
+#include    "FSR_LLD_RAM.h"
+
+#include    <linux/moduleparam.h>
+#include    <linux/vmalloc.h>
+#include    <linux/delay.h>
+#include    <linux/ktime.h>
+#include    <asm/io.h>
+
+/******************************************************************************/
+/*   Local Configurations                                                     */
+/*                                                                            */
+/* - FSR_LLD_STRICT_CHK             : To check parameters strictly            */
+/******************************************************************************/
+#define     FSR_LLD_STRICT_CHK
+
+/******************************************************************************/
+/* Local #defines                                                             */
+/******************************************************************************/
+#define     FSR_RAM_MAX_DEVS                (FSR_MAX_DEVS)
+#define     FSR_RAM_SECTOR_SIZE             (FSR_SECTOR_SIZE)
+#define     FSR_RAM_SPARE_PER_SCT           (16)
+
+/* Out of 8 words of spare area of 1 sector, 3 words are for LLD user        */
+#define     FSR_RAM_SPARE_USER_AREA         (3)
+#define     FSR_RAM_SPARE_HW_ECC_AREA       (5)
+
+#define     FSR_RAM_NUM_OF_BAD_MARK_PAGES   (2)
+#define     FSR_RAM_MAX_BADMARK             (4)
+#define     FSR_RAM_MAX_BBMMETA             (2)
+#define     FSR_RAM_MAX_INJECTED_BADBLKS    (32)
+
+#define     FSR_RAM_MID                     (0x00EC)
+#define     FSR_RAM_DID_2K                  (0x0030)
+#define     FSR_RAM_DID_4K                  (0x0050)
+
+/* The largest user spare: FSRSpareBufBase + FSR_MAX_SPARE_BUF_EXT exts      */
+#define     FSR_RAM_MAX_USER_SPARE          (FSR_SPARE_BUF_BASE_SIZE +         \
+                                             FSR_SPARE_BUF_EXT_SIZE * FSR_MAX_SPARE_BUF_EXT)
+
+/* Longest busy wait handed to udelay() at once                              */
+#define     FSR_RAM_MAX_UDELAY              (1000)
+
+/******************************************************************************/
+/* Local typedefs                                                             */
+/******************************************************************************/
+typedef struct
+{
+    BOOL32      bOpen;
+
+    UINT8      *pArray;         /**< main + spare of every page              */
+    UINT8      *pDataRAM;       /**< page which sits in DataRAM              */
+    UINT8      *pCpBkBuf;       /**< staging page for copyback random-in     */
+
+    UINT32      nNumOfBlks;
+    UINT32      nPgsPerBlk;
+    UINT32      nSctsPerPG;
+    UINT32      nMainSize;      /**< bytes of main of 1 page                 */
+    UINT32      nSpareSize;     /**< bytes of spare of 1 page                */
+    UINT32      nPgSize;        /**< nMainSize + nSpareSize                  */
+
+    ktime_t     tReady;         /**< time the current array op completes     */
+    INT32       nPrevOpRe;      /**< deferred result of the previous op      */
+} RAMCxt;
+
+/******************************************************************************/
+/* Static variables definitions                                               */
+/******************************************************************************/
+PRIVATE RAMCxt         *gpstRAMCxt[FSR_RAM_MAX_DEVS];
+PRIVATE FSRLLDStat      gstRAMStat;
+
+PRIVATE const UINT16    gnBadMarkValue[FSR_RAM_MAX_BADMARK]   =
+                            { 0xFFFF,         /* FSR_LLD_FLAG_WR_NOBADMARK    */
+                              0x2222,         /* FSR_LLD_FLAG_WR_EBADMARK     */
+                              0x4444,         /* FSR_LLD_FLAG_WR_WBADMARK     */
+                              0x8888,         /* FSR_LLD_FLAG_WR_LBADMARK     */
+                            };
+
+PRIVATE const UINT16    gnBBMMetaValue[FSR_RAM_MAX_BBMMETA]   =
+                            { 0xFFFF,
+                              FSR_LLD_BBM_META_MARK
+                            };
+
+/*
+ * Geometry and timing of the simulated device. The defaults follow the
+ * 4Gb 4K OneNAND (tR 45us, tPROG 240us, tBERS 500us) on a small array.
+ * Transfer times are in nsec per KB moved through DataRAM, 0 for no cost.
+ */
+PRIVATE UINT32          gnSimBlks           = 128;
+PRIVATE UINT32          gnSimPgsPerBlk      = 64;
+PRIVATE UINT32          gnSimSctsPerPG      = 8;
+PRIVATE UINT32          gnSimLoadTime       = 45;
+PRIVATE UINT32          gnSimProgTime       = 240;
+PRIVATE UINT32          gnSimEraseTime      = 500;
+PRIVATE UINT32          gnSimRdTransTime    = 0;
+PRIVATE UINT32          gnSimWrTransTime    = 0;
+PRIVATE UINT32          gnSimBadBlks[FSR_RAM_MAX_INJECTED_BADBLKS];
+PRIVATE UINT32          gnSimNumOfBadBlks   = 0;
+PRIVATE ULONG           gnSimImageAddr      = 0;
+PRIVATE ULONG           gnSimImageSize      = 0;
+
+module_param_named(sim_blocks,          gnSimBlks,          uint, 0444);
+module_param_named(sim_pages_per_block, gnSimPgsPerBlk,     uint, 0444);
+module_param_named(sim_sectors_per_page,gnSimSctsPerPG,     uint, 0444);
+module_param_named(sim_load_us,         gnSimLoadTime,      uint, 0644);
+module_param_named(sim_prog_us,         gnSimProgTime,      uint, 0644);
+module_param_named(sim_erase_us,        gnSimEraseTime,     uint, 0644);
+module_param_named(sim_rd_ns_per_kb,    gnSimRdTransTime,   uint, 0644);
+module_param_named(sim_wr_ns_per_kb,    gnSimWrTransTime,   uint, 0644);
+module_param_array_named(sim_bad_blocks, gnSimBadBlks, uint, &gnSimNumOfBadBlks, 0444);
+module_param_named(sim_image_addr,      gnSimImageAddr,     ulong, 0444);
+module_param_named(sim_image_size,      gnSimImageSize,     ulong, 0444);
+
+/******************************************************************************/
+/* Local function prototypes                                                  */
+/******************************************************************************/
+PRIVATE INT32   _StrictChk          (UINT32       nDev,
+                                     UINT32       nPbn,
+                                     UINT32       nPgOffset);
+PRIVATE UINT8  *_GetPage            (RAMCxt      *pstCxt,
+                                     UINT32       nPbn,
+                                     UINT32       nPgOffset);
+PRIVATE VOID    _SetBusy            (RAMCxt      *pstCxt,
+                                     UINT32       nUsec);
+PRIVATE VOID    _WaitReady          (RAMCxt      *pstCxt);
+PRIVATE VOID    _WaitTransfer       (UINT32       nBytes,
+                                     UINT32       nNsecPerKB);
+PRIVATE VOID    _ProgramBytes       (UINT8       *pDst,
+                                     const UINT8 *pSrc,
+                                     UINT32       nSize);
+PRIVATE VOID    _ReadSpare          (RAMCxt      *pstCxt,
+                                     FSRSpareBuf *pstDest,
+                                     UINT8       *pSrc);
+PRIVATE VOID    _WriteSpare         (RAMCxt      *pstCxt,
+                                     UINT8       *pDest,
+                                     FSRSpareBuf *pstSrc,
+                                     UINT32       nFlag);
+PRIVATE BOOL32  _IsBadMark          (UINT16       nBadMarkInfo);
+
+/******************************************************************************/
+/* Code Implementation                                                        */
+/******************************************************************************/
+
+/**
+ * @brief           This function checks the validity of parameter
+ *
+ * @param[in]       nDev        : Physical Device Number
+ * @param[in]       nPbn        : Physical Block  Number
+ * @param[in]       nPgOffset   : Page Offset within a block
+ *
+ * @return          FSR_LLD_SUCCESS
+ * @return          FSR_LLD_INVALID_PARAM
+ *
+ * @remark
+ *
+ */
+PRIVATE INT32
+_StrictChk(UINT32       nDev,
+           UINT32       nPbn,
+           UINT32       nPgOffset)
+{
+    RAMCxt     *pstCxt;
+
+    if (nDev >= FSR_RAM_MAX_DEVS)
+    {
+        FSR_DBZ_RTLMOUT(FSR_DBZ_ERROR,
+            (TEXT("[RAM:ERR]   Invalid Device Number (nDev = %d)\r\n"), nDev));
+        return FSR_LLD_INVALID_PARAM;
+    }
+
+    pstCxt = gpstRAMCxt[nDev];
+
+    if ((pstCxt == NULL) || (pstCxt->bOpen == FALSE32))
+    {
+        FSR_DBZ_RTLMOUT(FSR_DBZ_ERROR,
+            (TEXT("[RAM:ERR]   Device is not opened (nDev = %d)\r\n"), nDev));
+        return FSR_LLD_INVALID_PARAM;
+    }
+
+    if ((nPbn >= pstCxt->nNumOfBlks) || (nPgOffset >= pstCxt->nPgsPerBlk))
+    {
+        FSR_DBZ_RTLMOUT(FSR_DBZ_ERROR,
+            (TEXT("[RAM:ERR]   Pbn:%d, PgOffset:%d is out of range\r\n"),
+            nPbn, nPgOffset));
+        return FSR_LLD_INVALID_PARAM;
+    }
+
+    return FSR_LLD_SUCCESS;
+}
+
+
+
+/**
+ * @brief           This function returns the address of a page in the array
+ *
+ * @param[in]       pstCxt      : Pointer to the device context
+ * @param[in]       nPbn        : Physical Block  Number
+ * @param[in]       nPgOffset   : Page Offset within a block
+ *
+ * @return          main area of the page, spare follows at + nMainSize
+ *
+ * @remark
+ *
+ */
+PRIVATE UINT8 *
+_GetPage(RAMCxt *pstCxt,
+         UINT32  nPbn,
+         UINT32  nPgOffset)
+{
+    return pstCxt->pArray +
+           (nPbn * pstCxt->nPgsPerBlk + nPgOffset) * pstCxt->nPgSize;
+}
+
+
+
+/**
+ * @brief           This function starts the busy time of an array operation
+ *
+ * @param[in]       pstCxt      : Pointer to the device context
+ * @param[in]       nUsec       : busy time in usec
+ *
+ * @return          none
+ *
+ * @remark          the operation is complete as soon as the call returns,
+ * @n               only the moment it may be observed is pushed back.
+ *
+ */
+PRIVATE VOID
+_SetBusy(RAMCxt *pstCxt,
+         UINT32  nUsec)
+{
+    pstCxt->tReady = ktime_add_us(ktime_get(), nUsec);
+}
+
+
+
+/**
+ * @brief           This function waits until the previous array op is over
+ *
+ * @param[in]       pstCxt      : Pointer to the device context
+ *
+ * @return          none
+ *
+ * @remark
+ *
+ */
+PRIVATE VOID
+_WaitReady(RAMCxt *pstCxt)
+{
+    s64         nRemain;
+
+    while ((nRemain = ktime_us_delta(pstCxt->tReady, ktime_get())) > 0)
+    {
+        udelay((nRemain > FSR_RAM_MAX_UDELAY) ?
+               FSR_RAM_MAX_UDELAY : (UINT32) nRemain);
+    }
+}
+
+
+
+/**
+ * @brief           This function spends the bus time of a DataRAM transfer
+ *
+ * @param[in]       nBytes      : the number of bytes transferred
+ * @param[in]       nNsecPerKB  : transfer time in nsec per KB
+ *
+ * @return          none
+ *
+ * @remark
+ *
+ */
+PRIVATE VOID
+_WaitTransfer(UINT32 nBytes,
+              UINT32 nNsecPerKB)
+{
+    UINT32      nUsec;
+
+    if (nNsecPerKB == 0)
+    {
+        return;
+    }
+
+    nUsec = (UINT32) (((u64) nBytes * nNsecPerKB) >> 10) / 1000;
+
+    while (nUsec > FSR_RAM_MAX_UDELAY)
+    {
+        udelay(FSR_RAM_MAX_UDELAY);
+        nUsec -= FSR_RAM_MAX_UDELAY;
+    }
+
+    if (nUsec > 0)
+    {
+        udelay(nUsec);
+    }
+}
+
+
+
+/**
+ * @brief           This function programs bytes into the array
+ *
+ * @param[out]      pDst        : Pointer to the array
+ * @param[in]       pSrc        : Pointer to the data
+ * @param[in]       nSize       : the number of bytes
+ *
+ * @return          none
+ *
+ * @remark          programming only clears bits, as NAND cells do.
+ * @n               a page written twice without erase keeps the AND of both.
+ *
+ */
+PRIVATE VOID
+_ProgramBytes(      UINT8  *pDst,
+              const UINT8  *pSrc,
+                    UINT32  nSize)
+{
+    UINT32      nIdx;
+
+    if ((((UINT32) pDst | (UINT32) pSrc | nSize) & 0x3) == 0)
+    {
+              UINT32 *pDst32 = (UINT32 *) pDst;
+        const UINT32 *pSrc32 = (const UINT32 *) pSrc;
+
+        for (nIdx = 0; nIdx < (nSize >> 2); nIdx++)
+        {
+            pDst32[nIdx] &= pSrc32[nIdx];
+        }
+        return;
+    }
+
+    for (nIdx = 0; nIdx < nSize; nIdx++)
+    {
+        pDst[nIdx] &= pSrc[nIdx];
+    }
+}
+
+
+
+/**
+ * @brief           This function reads the user part of a spare area
+ *
+ * @param[in]       pstCxt      : Pointer to the device context
+ * @param[out]      pstDest     : Pointer to the host buffer
+ * @param[in]       pSrc        : Pointer to the spare area in the array
+ *
+ * @return          none
+ *
+ * @remark          words which the page size has no room for read as 0xFFFF
+ *
+ */
+PRIVATE VOID
+_ReadSpare(RAMCxt      *pstCxt,
+           FSRSpareBuf *pstDest,
+           UINT8       *pSrc)
+{
+    UINT16      nUser[FSR_RAM_MAX_USER_SPARE / sizeof(UINT16)];
+    UINT16     *pSrc16;
+    UINT32      nNumOfWords;
+    UINT32      nIdx;
+    UINT32      nExtIdx;
+    UINT32      nExt;
+
+    pSrc16      = (UINT16 *) pSrc;
+    nNumOfWords = pstCxt->nSctsPerPG * FSR_RAM_SPARE_USER_AREA;
+
+    FSR_OAM_MEMSET(nUser, 0xFF, sizeof(nUser));
+
+    for (nIdx = 0; (nIdx < nNumOfWords) &&
+                   (nIdx < FSR_RAM_MAX_USER_SPARE / sizeof(UINT16)); nIdx++)
+    {
+        nUser[nIdx] = *pSrc16++;
+
+        if ((nIdx % FSR_RAM_SPARE_USER_AREA) == FSR_RAM_SPARE_USER_AREA - 1)
+        {
+            /* skip H/W ECC area */
+            pSrc16 += FSR_RAM_SPARE_HW_ECC_AREA;
+        }
+    }
+
+    FSR_OAM_MEMCPY(pstDest->pstSpareBufBase, &nUser[0], FSR_SPARE_BUF_BASE_SIZE);
+
+    nExt = pstDest->nNumOfMetaExt;
+    if (nExt > FSR_MAX_SPARE_BUF_EXT)
+    {
+        nExt = FSR_MAX_SPARE_BUF_EXT;
+    }
+
+    for (nExtIdx = 0; nExtIdx < nExt; nExtIdx++)
+    {
+        FSR_OAM_MEMCPY(&(pstDest->pstSTLMetaExt[nExtIdx]),
+                       (UINT8 *) &nUser[0] + FSR_SPARE_BUF_BASE_SIZE +
+                       nExtIdx * FSR_SPARE_BUF_EXT_SIZE,
+                       FSR_SPARE_BUF_EXT_SIZE);
+    }
+}
+
+
+
+/**
+ * @brief           This function programs the user part of a spare area
+ *
+ * @param[in]       pstCxt      : Pointer to the device context
+ * @param[out]      pDest       : Pointer to the spare area in the array
+ * @param[in]       pstSrc      : Pointer to the host buffer, may be NULL
+ * @param[in]       nFlag       : bad mark and BBM meta flags
+ *
+ * @return          none
+ *
+ * @remark          bad mark and BBM meta mark come from nFlag, not pstSrc
+ *
+ */
+PRIVATE VOID
+_WriteSpare(RAMCxt      *pstCxt,
+            UINT8       *pDest,
+            FSRSpareBuf *pstSrc,
+            UINT32       nFlag)
+{
+    UINT16      nUser[FSR_RAM_MAX_USER_SPARE / sizeof(UINT16)];
+    UINT16     *pDest16;
+    UINT32      nNumOfWords;
+    UINT32      nIdx;
+    UINT32      nExtIdx;
+    UINT32      nExt;
+
+    FSR_OAM_MEMSET(nUser, 0xFF, sizeof(nUser));
+
+    if (pstSrc != NULL)
+    {
+        FSR_OAM_MEMCPY(&nUser[0], pstSrc->pstSpareBufBase, FSR_SPARE_BUF_BASE_SIZE);
+
+        nExt = pstSrc->nNumOfMetaExt;
+        if (nExt > FSR_MAX_SPARE_BUF_EXT)
+        {
+            nExt = FSR_MAX_SPARE_BUF_EXT;
+        }
+
+        for (nExtIdx = 0; nExtIdx < nExt; nExtIdx++)
+        {
+            FSR_OAM_MEMCPY((UINT8 *) &nUser[0] + FSR_SPARE_BUF_BASE_SIZE +
+                           nExtIdx * FSR_SPARE_BUF_EXT_SIZE,
+                           &(pstSrc->pstSTLMetaExt[nExtIdx]),
+                           FSR_SPARE_BUF_EXT_SIZE);
+        }
+
+        nUser[1] = gnBBMMetaValue[(nFlag & FSR_LLD_FLAG_BBM_META_MASK) >>
+                                  FSR_LLD_FLAG_BBM_META_BASEBIT];
+    }
+
+    nUser[0] = gnBadMarkValue[(nFlag & FSR_LLD_FLAG_BADMARK_MASK) >>
+                              FSR_LLD_FLAG_BADMARK_BASEBIT];
+
+    pDest16     = (UINT16 *) pDest;
+    nNumOfWords = pstCxt->nSctsPerPG * FSR_RAM_SPARE_USER_AREA;
+
+    for (nIdx = 0; (nIdx < nNumOfWords) &&
+                   (nIdx < FSR_RAM_MAX_USER_SPARE / sizeof(UINT16)); nIdx++)
+    {
+        *pDest16++ &= nUser[nIdx];
+
+        if ((nIdx % FSR_RAM_SPARE_USER_AREA) == FSR_RAM_SPARE_USER_AREA - 1)
+        {
+            /* skip H/W ECC area */
+            pDest16 += FSR_RAM_SPARE_HW_ECC_AREA;
+        }
+    }
+}
+
+
+
+/**
+ * @brief           This function checks a bad mark by bit majority
+ *
+ * @param[in]       nBadMarkInfo : first word of spare of the block
+ *
+ * @return          TRUE32 if more than half of the bits are 0
+ *
+ * @remark          same rule as the 4K OneNAND LLD
+ *
+ */
+PRIVATE BOOL32
+_IsBadMark(UINT16 nBadMarkInfo)
+{
+    UINT32      nBitOffset;
+    UINT32      nCntOfBit1 = 0;
+
+    for (nBitOffset = 0; nBitOffset < sizeof(UINT16) * 8; nBitOffset++)
+    {
+        if ((nBadMarkInfo & (1 << nBitOffset)) != 0)
+        {
+            nCntOfBit1++;
+        }
+    }
+
+    return (nCntOfBit1 < sizeof(UINT16) * 8 - nCntOfBit1) ? TRUE32 : FALSE32;
+}
+
+
+
+/**
+ * @brief           This function initializes the RAM simulator LLD
+ *
+ * @param[in]       nFlag       : FSR_LLD_FLAG_NONE
+ *
+ * @return          FSR_LLD_SUCCESS
+ *
+ * @remark
+ *
+ */
+PUBLIC INT32
+FSR_RAM_Init(UINT32 nFlag)
+{
+    UINT32      nDev;
+
+    FSR_DBZ_DBGMOUT(FSR_DBZ_LLD_IF | FSR_DBZ_LLD_LOG,
+        (TEXT("[RAM:IN ] ++%s(nFlag:0x%08x)\r\n"), __FSR_FUNC__, nFlag));
+
+    for (nDev = 0; nDev < FSR_RAM_MAX_DEVS; nDev++)
+    {
+        if ((gpstRAMCxt[nDev] != NULL) && (gpstRAMCxt[nDev]->bOpen == TRUE32))
+        {
+            return FSR_LLD_ALREADY_INITIALIZED;
+        }
+    }
+
+    FSR_OAM_MEMSET(&gstRAMStat, 0x00, sizeof(gstRAMStat));
+
+    FSR_DBZ_DBGMOUT(FSR_DBZ_LLD_IF | FSR_DBZ_LLD_LOG,
+        (TEXT("[RAM:OUT] --%s()\r\n"), __FSR_FUNC__));
+
+    return FSR_LLD_SUCCESS;
+}
+
+
+
+/**
+ * @brief           This function allocates the array of a simulated device
+ *
+ * @param[in]       nDev        : Physical Device Number
+ * @param[in]       pParam      : FsrVolParm, unused
+ * @param[in]       nFlag       : FSR_LLD_FLAG_NONE
+ *
+ * @return          FSR_LLD_SUCCESS
+ * @return          FSR_LLD_INVALID_PARAM
+ * @return          FSR_LLD_OPEN_FAILURE
+ * @return          FSR_LLD_MALLOC_FAIL
+ *
+ * @remark          the array starts out erased, then injected bad blocks
+ * @n               get their bad mark and dev 0 is loaded from the image
+ * @n               given by sim_image_addr/sim_image_size if any.
+ *
+ */
+PUBLIC INT32
+FSR_RAM_Open(UINT32         nDev,
+             VOID          *pParam,
+             UINT32         nFlag)
+{
+    RAMCxt     *pstCxt;
+    UINT8      *pImage;
+    UINT8      *pSpare;
+    UINT32      nArraySize;
+    UINT32      nCopySize;
+    UINT32      nIdx;
+    UINT32      nPgIdx;
+    INT32       nLLDRe = FSR_LLD_SUCCESS;
+
+    FSR_DBZ_DBGMOUT(FSR_DBZ_LLD_IF | FSR_DBZ_LLD_LOG,
+        (TEXT("[RAM:IN ] ++%s(nDev:%d, nFlag:0x%08x)\r\n"),
+        __FSR_FUNC__, nDev, nFlag));
+
+    do
+    {
+        if (nDev >= FSR_RAM_MAX_DEVS)
+        {
+            nLLDRe = FSR_LLD_INVALID_PARAM;
+            break;
+        }
+
+        if ((gpstRAMCxt[nDev] != NULL) && (gpstRAMCxt[nDev]->bOpen == TRUE32))
+        {
+            break;
+        }
+
+        if ((gnSimBlks == 0) || (gnSimBlks > 0xFFFF) ||
+            (gnSimPgsPerBlk == 0) || (gnSimPgsPerBlk > 256) ||
+            ((gnSimSctsPerPG != 4) && (gnSimSctsPerPG != 8)))
+        {
+            FSR_DBZ_RTLMOUT(FSR_DBZ_ERROR,
+                (TEXT("[RAM:ERR]   bad geometry: blks %d, pgs/blk %d, scts/pg %d\r\n"),
+                gnSimBlks, gnSimPgsPerBlk, gnSimSctsPerPG));
+            nLLDRe = FSR_LLD_OPEN_FAILURE;
+            break;
+        }
+
+        pstCxt = gpstRAMCxt[nDev];
+        if (pstCxt == NULL)
+        {
+            pstCxt = (RAMCxt *) FSR_OAM_Malloc(sizeof(RAMCxt));
+            if (pstCxt == NULL)
+            {
+                nLLDRe = FSR_LLD_MALLOC_FAIL;
+                break;
+            }
+            gpstRAMCxt[nDev] = pstCxt;
+        }
+
+        FSR_OAM_MEMSET(pstCxt, 0x00, sizeof(RAMCxt));
+
+        pstCxt->nNumOfBlks  = gnSimBlks;
+        pstCxt->nPgsPerBlk  = gnSimPgsPerBlk;
+        pstCxt->nSctsPerPG  = gnSimSctsPerPG;
+        pstCxt->nMainSize   = gnSimSctsPerPG * FSR_RAM_SECTOR_SIZE;
+        pstCxt->nSpareSize  = gnSimSctsPerPG * FSR_RAM_SPARE_PER_SCT;
+        pstCxt->nPgSize     = pstCxt->nMainSize + pstCxt->nSpareSize;
+
+        nArraySize = pstCxt->nNumOfBlks * pstCxt->nPgsPerBlk * pstCxt->nPgSize;
+
+        pstCxt->pArray = (UINT8 *) vmalloc(nArraySize);
+        if (pstCxt->pArray == NULL)
+        {
+            FSR_DBZ_RTLMOUT(FSR_DBZ_ERROR,
+                (TEXT("[RAM:ERR]   cannot allocate %d bytes of array\r\n"), nArraySize));
+            nLLDRe = FSR_LLD_MALLOC_FAIL;
+            break;
+        }
+
+        pstCxt->pCpBkBuf = (UINT8 *) FSR_OAM_Malloc(pstCxt->nPgSize);
+        if (pstCxt->pCpBkBuf == NULL)
+        {
+            vfree(pstCxt->pArray);
+            pstCxt->pArray = NULL;
+            nLLDRe = FSR_LLD_MALLOC_FAIL;
+            break;
+        }
+
+        FSR_OAM_MEMSET(pstCxt->pArray, 0xFF, nArraySize);
+
+        if ((nDev == 0) && (gnSimImageSize != 0))
+        {
+            nCopySize = (gnSimImageSize < nArraySize) ? gnSimImageSize : nArraySize;
+
+            pImage = (UINT8 *) ioremap(gnSimImageAddr, nCopySize);
+            if (pImage == NULL)
+            {
+                FSR_DBZ_RTLMOUT(FSR_DBZ_ERROR,
+                    (TEXT("[RAM:ERR]   cannot map image at 0x%08lx\r\n"), gnSimImageAddr));
+                vfree(pstCxt->pArray);
+                pstCxt->pArray = NULL;
+                FSR_OAM_Free(pstCxt->pCpBkBuf);
+                pstCxt->pCpBkBuf = NULL;
+                nLLDRe = FSR_LLD_OPEN_FAILURE;
+                break;
+            }
+
+            memcpy_fromio(pstCxt->pArray, pImage, nCopySize);
+            iounmap(pImage);
+
+            FSR_DBZ_RTLMOUT(FSR_DBZ_INF,
+                (TEXT("[RAM:INF]   %d bytes of image loaded from 0x%08lx\r\n"),
+                nCopySize, gnSimImageAddr));
+        }
+
+        /* injected bad blocks carry the factory bad mark on both mark pages */
+        for (nIdx = 0; (nIdx < gnSimNumOfBadBlks) &&
+                       (nIdx < FSR_RAM_MAX_INJECTED_BADBLKS); nIdx++)
+        {
+            if (gnSimBadBlks[nIdx] >= pstCxt->nNumOfBlks)
+            {
+                continue;
+            }
+
+            for (nPgIdx = 0; nPgIdx < FSR_RAM_NUM_OF_BAD_MARK_PAGES; nPgIdx++)
+            {
+                pSpare = _GetPage(pstCxt, gnSimBadBlks[nIdx], nPgIdx) + pstCxt->nMainSize;
+                *(UINT16 *) pSpare = 0x0000;
+            }
+        }
+
+        pstCxt->pDataRAM    = _GetPage(pstCxt, 0, 0);
+        pstCxt->tReady      = ktime_get();
+        pstCxt->nPrevOpRe   = FSR_LLD_SUCCESS;
+        pstCxt->bOpen       = TRUE32;
+
+        FSR_DBZ_RTLMOUT(FSR_DBZ_INF,
+            (TEXT("[RAM:INF]   dev %d: %d blks x %d pgs x %d scts, %d bad blk(s) injected\r\n"),
+            nDev, pstCxt->nNumOfBlks, pstCxt->nPgsPerBlk, pstCxt->nSctsPerPG,
+            gnSimNumOfBadBlks));
+    } while (0);
+
+    FSR_DBZ_DBGMOUT(FSR_DBZ_LLD_IF | FSR_DBZ_LLD_LOG,
+        (TEXT("[RAM:OUT] --%s() / nLLDRe : 0x%x\r\n"), __FSR_FUNC__, nLLDRe));
+
+    return nLLDRe;
+}
+
+
+
+/**
+ * @brief           This function releases the array of a simulated device
+ *
+ * @param[in]       nDev        : Physical Device Number
+ * @param[in]       nFlag       : FSR_LLD_FLAG_NONE
+ *
+ * @return          FSR_LLD_SUCCESS
+ * @return          FSR_LLD_INVALID_PARAM
+ *
+ * @remark
+ *
+ */
+PUBLIC INT32
+FSR_RAM_Close(UINT32         nDev,
+              UINT32         nFlag)
+{
+    RAMCxt     *pstCxt;
+
+    if (nDev >= FSR_RAM_MAX_DEVS)
+    {
+        return FSR_LLD_INVALID_PARAM;
+    }
+
+    pstCxt = gpstRAMCxt[nDev];
+    if ((pstCxt != NULL) && (pstCxt->bOpen == TRUE32))
+    {
+        vfree(pstCxt->pArray);
+        FSR_OAM_Free(pstCxt->pCpBkBuf);
+        pstCxt->pArray   = NULL;
+        pstCxt->pCpBkBuf = NULL;
+        pstCxt->pDataRAM = NULL;
+        pstCxt->bOpen    = FALSE32;
+    }
+
+    return FSR_LLD_SUCCESS;
+}
+
+
+
+/**
+ * @brief           This function reads 1 page
+ *
+ * @param[in]       nDev        : Physical Device Number
+ * @param[in]       nPbn        : Physical Block  Number
+ * @param[in]       nPgOffset   : Page Offset within a block
+ * @param[out]      pMBuf       : Memory buffer for main  array of NAND flash
+ * @param[out]      pSBuf       : Memory buffer for spare array of NAND flash
+ * @param[in]       nFlag       : Operation options such as ECC_ON, OFF
+ *
+ * @return          FSR_LLD_SUCCESS
+ * @return          FSR_LLD_INVALID_PARAM
+ *
+ * @remark          load and transfer of the same page, back to back
+ *
+ */
+PUBLIC INT32
+FSR_RAM_Read(UINT32         nDev,
+             UINT32         nPbn,
+             UINT32         nPgOffset,
+             UINT8         *pMBuf,
+             FSRSpareBuf   *pSBuf,
+             UINT32         nFlag)
+{
+    INT32       nLLDRe;
+    UINT32      nLLDFlag;
+
+    nLLDFlag = ~FSR_LLD_FLAG_CMDIDX_MASK & nFlag;
+
+    nLLDRe = FSR_RAM_ReadOptimal(nDev, nPbn, nPgOffset, pMBuf, pSBuf,
+                                 FSR_LLD_FLAG_1X_LOAD | nLLDFlag);
+    if (FSR_RETURN_MAJOR(nLLDRe) != FSR_LLD_SUCCESS)
+    {
+        return nLLDRe;
+    }
+
+    return FSR_RAM_ReadOptimal(nDev, nPbn, nPgOffset, pMBuf, pSBuf,
+                               FSR_LLD_FLAG_TRANSFER | nLLDFlag);
+}
+
+
+
+/**
+ * @brief           This function loads a page and/or transfers the page
+ * @n               loaded by the previous call
+ *
+ * @param[in]       nDev        : Physical Device Number
+ * @param[in]       nPbn        : Physical Block  Number
+ * @param[in]       nPgOffset   : Page Offset within a block
+ * @param[out]      pMBuf       : Memory buffer for main  array of NAND flash
+ * @param[out]      pSBuf       : Memory buffer for spare array of NAND flash
+ * @param[in]       nFlag       : Operation options such as ECC_ON, OFF
+ *
+ * @return          FSR_LLD_SUCCESS
+ * @return          FSR_LLD_INVALID_PARAM
+ *
+ * @remark          as in the OneNAND LLDs, the transfer of the previously
+ * @n               loaded page comes first, then the load of nPbn/nPgOffset.
+ * @n               PLOAD is treated as a normal load.
+ *
+ */
+PUBLIC INT32
+FSR_RAM_ReadOptimal(UINT32         nDev,
+                    UINT32         nPbn,
+                    UINT32         nPgOffset,
+                    UINT8         *pMBuf,
+                    FSRSpareBuf   *pSBuf,
+                    UINT32         nFlag)
+{
+    RAMCxt     *pstCxt;
+    UINT32      nCmdIdx;
+    UINT32      nStartOffset;
+    UINT32      nEndOffset;
+    UINT32      nBytes;
+    INT32       nLLDRe = FSR_LLD_SUCCESS;
+
+    FSR_DBZ_DBGMOUT(FSR_DBZ_LLD_IF | FSR_DBZ_LLD_LOG,
+        (TEXT("[RAM:IN ] ++%s(nDev:%d, nPbn:%d, nPgOffset:%d, nFlag:0x%08x)\r\n"),
+        __FSR_FUNC__, nDev, nPbn, nPgOffset, nFlag));
+
+    do
+    {
+#if defined (FSR_LLD_STRICT_CHK)
+        nLLDRe = _StrictChk(nDev, nPbn, nPgOffset);
+        if (nLLDRe != FSR_LLD_SUCCESS)
+        {
+            break;
+        }
+#endif /* #if defined (FSR_LLD_STRICT_CHK) */
+
+        pstCxt  = gpstRAMCxt[nDev];
+        nCmdIdx = (nFlag & FSR_LLD_FLAG_CMDIDX_MASK) >> FSR_LLD_FLAG_CMDIDX_BASEBIT;
+
+        if (nFlag & FSR_LLD_FLAG_TRANSFER)
+        {
+            _WaitReady(pstCxt);
+
+            nBytes = 0;
+
+            if (pMBuf != NULL)
+            {
+                nStartOffset = (nFlag & FSR_LLD_FLAG_1ST_SCTOFFSET_MASK)
+                                >> FSR_LLD_FLAG_1ST_SCTOFFSET_BASEBIT;
+                nEndOffset   = (nFlag & FSR_LLD_FLAG_LAST_SCTOFFSET_MASK)
+                                >> FSR_LLD_FLAG_LAST_SCTOFFSET_BASEBIT;
+
+                nBytes = (pstCxt->nSctsPerPG - nStartOffset - nEndOffset) *
+                         FSR_RAM_SECTOR_SIZE;
+
+                FSR_OAM_MEMCPY(pMBuf + nStartOffset * FSR_RAM_SECTOR_SIZE,
+                               pstCxt->pDataRAM + nStartOffset * FSR_RAM_SECTOR_SIZE,
+                               nBytes);
+            }
+
+            if ((pSBuf != NULL) && (nFlag & FSR_LLD_FLAG_USE_SPAREBUF))
+            {
+                if ((nFlag & FSR_LLD_FLAG_DUMP_MASK) == FSR_LLD_FLAG_DUMP_OFF)
+                {
+                    _ReadSpare(pstCxt, pSBuf, pstCxt->pDataRAM + pstCxt->nMainSize);
+                    nBytes += FSR_SPARE_BUF_BASE_SIZE +
+                              pSBuf->nNumOfMetaExt * FSR_SPARE_BUF_EXT_SIZE;
+                }
+                else
+                {
+                    /* When dumping NAND image, the whole spare is read */
+                    FSR_OAM_MEMCPY((UINT8 *) pSBuf,
+                                   pstCxt->pDataRAM + pstCxt->nMainSize,
+                                   pstCxt->nSpareSize);
+                    nBytes += pstCxt->nSpareSize;
+                }
+            }
+
+            _WaitTransfer(nBytes, gnSimRdTransTime);
+
+            gstRAMStat.nRdTrans++;
+            gstRAMStat.nRdTransInBytes += nBytes;
+        }
+
+        if ((nCmdIdx == FSR_LLD_FLAG_1X_LOAD) ||
+            (nCmdIdx == FSR_LLD_FLAG_1X_PLOAD))
+        {
+            _WaitReady(pstCxt);
+
+            pstCxt->pDataRAM = _GetPage(pstCxt, nPbn, nPgOffset);
+            _SetBusy(pstCxt, gnSimLoadTime);
+
+            gstRAMStat.nSLCLoads++;
+        }
+    } while (0);
+
+    FSR_DBZ_DBGMOUT(FSR_DBZ_LLD_IF | FSR_DBZ_LLD_LOG,
+        (TEXT("[RAM:OUT] --%s() / nLLDRe : 0x%x\r\n"), __FSR_FUNC__, nLLDRe));
+
+    return nLLDRe;
+}
+
+
+
+/**
+ * @brief           This function writes 1 page
+ *
+ * @param[in]       nDev        : Physical Device Number
+ * @param[in]       nPbn        : Physical Block  Number
+ * @param[in]       nPgOffset   : Page Offset within a block
+ * @param[in]       pMBuf       : Memory buffer for main  array of NAND flash
+ * @param[in]       pSBuf       : Memory buffer for spare array of NAND flash
+ * @param[in]       nFlag       : Operation options such as ECC_ON, OFF
+ *
+ * @return          FSR_LLD_SUCCESS
+ * @return          FSR_LLD_INVALID_PARAM
+ *
+ * @remark
+ *
+ */
+PUBLIC INT32
+FSR_RAM_Write(UINT32         nDev,
+              UINT32         nPbn,
+              UINT32         nPgOffset,
+              UINT8         *pMBuf,
+              FSRSpareBuf   *pSBuf,
+              UINT32         nFlag)
+{
+    RAMCxt     *pstCxt;
+    UINT8      *pPage;
+    UINT32      nBytes = 0;
+    INT32       nLLDRe = FSR_LLD_SUCCESS;
+
+    FSR_DBZ_DBGMOUT(FSR_DBZ_LLD_IF | FSR_DBZ_LLD_LOG,
+        (TEXT("[RAM:IN ] ++%s(nDev:%d, nPbn:%d, nPgOffset:%d, nFlag:0x%08x)\r\n"),
+        __FSR_FUNC__, nDev, nPbn, nPgOffset, nFlag));
+
+    do
+    {
+#if defined (FSR_LLD_STRICT_CHK)
+        nLLDRe = _StrictChk(nDev, nPbn, nPgOffset);
+        if (nLLDRe != FSR_LLD_SUCCESS)
+        {
+            break;
+        }
+#endif /* #if defined (FSR_LLD_STRICT_CHK) */
+
+        pstCxt = gpstRAMCxt[nDev];
+        pPage  = _GetPage(pstCxt, nPbn, nPgOffset);
+
+        /* the previous result is reported by this call, as in FlushOp */
+        _WaitReady(pstCxt);
+        nLLDRe = pstCxt->nPrevOpRe;
+        pstCxt->nPrevOpRe = FSR_LLD_SUCCESS;
+
+        if (pMBuf != NULL)
+        {
+            _ProgramBytes(pPage, pMBuf, pstCxt->nMainSize);
+            nBytes += pstCxt->nMainSize;
+        }
+
+        if ((nFlag & FSR_LLD_FLAG_DUMP_MASK) == FSR_LLD_FLAG_DUMP_ON)
+        {
+            if (pSBuf != NULL)
+            {
+                _ProgramBytes(pPage + pstCxt->nMainSize, (UINT8 *) pSBuf,
+                              pstCxt->nSpareSize);
+                nBytes += pstCxt->nSpareSize;
+            }
+        }
+        else
+        {
+            _WriteSpare(pstCxt, pPage + pstCxt->nMainSize, pSBuf, nFlag);
+            if (pSBuf != NULL)
+            {
+                nBytes += FSR_SPARE_BUF_BASE_SIZE +
+                          pSBuf->nNumOfMetaExt * FSR_SPARE_BUF_EXT_SIZE;
+            }
+        }
+
+        _WaitTransfer(nBytes, gnSimWrTransTime);
+
+        pstCxt->pDataRAM = pPage;
+        _SetBusy(pstCxt, gnSimProgTime);
+
+        gstRAMStat.nSLCPgms++;
+        gstRAMStat.nWrTrans++;
+        gstRAMStat.nWrTransInBytes += nBytes;
+    } while (0);
+
+    FSR_DBZ_DBGMOUT(FSR_DBZ_LLD_IF | FSR_DBZ_LLD_LOG,
+        (TEXT("[RAM:OUT] --%s() / nLLDRe : 0x%x\r\n"), __FSR_FUNC__, nLLDRe));
+
+    return nLLDRe;
+}
+
+
+
+/**
+ * @brief           This function erases blocks
+ *
+ * @param[in]       nDev        : Physical Device Number
+ * @param[in]       pnPbn       : array of blocks, only the first is used
+ * @param[in]       nNumOfBlks  : the number of blocks
+ * @param[in]       nFlag       : FSR_LLD_FLAG_1X_ERASE
+ *
+ * @return          FSR_LLD_SUCCESS
+ * @return          FSR_LLD_INVALID_PARAM
+ *
+ * @remark
+ *
+ */
+PUBLIC INT32
+FSR_RAM_Erase(UINT32         nDev,
+              UINT32        *pnPbn,
+              UINT32         nNumOfBlks,
+              UINT32         nFlag)
+{
+    RAMCxt     *pstCxt;
+    INT32       nLLDRe = FSR_LLD_SUCCESS;
+
+    FSR_DBZ_DBGMOUT(FSR_DBZ_LLD_IF | FSR_DBZ_LLD_LOG,
+        (TEXT("[RAM:IN ] ++%s(nDev:%d, nPbn:%d, nFlag:0x%08x)\r\n"),
+        __FSR_FUNC__, nDev, (pnPbn != NULL) ? *pnPbn : 0xFFFFFFFF, nFlag));
+
+    do
+    {
+        if (pnPbn == NULL)
+        {
+            nLLDRe = FSR_LLD_INVALID_PARAM;
+            break;
+        }
+
+#if defined (FSR_LLD_STRICT_CHK)
+        nLLDRe = _StrictChk(nDev, *pnPbn, 0);
+        if (nLLDRe != FSR_LLD_SUCCESS)
+        {
+            break;
+        }
+#endif /* #if defined (FSR_LLD_STRICT_CHK) */
+
+        pstCxt = gpstRAMCxt[nDev];
+
+        _WaitReady(pstCxt);
+        nLLDRe = pstCxt->nPrevOpRe;
+        pstCxt->nPrevOpRe = FSR_LLD_SUCCESS;
+
+        FSR_OAM_MEMSET(_GetPage(pstCxt, *pnPbn, 0), 0xFF,
+                       pstCxt->nPgsPerBlk * pstCxt->nPgSize);
+
+        _SetBusy(pstCxt, gnSimEraseTime);
+
+        gstRAMStat.nErases++;
+    } while (0);
+
+    FSR_DBZ_DBGMOUT(FSR_DBZ_LLD_IF | FSR_DBZ_LLD_LOG,
+        (TEXT("[RAM:OUT] --%s() / nLLDRe : 0x%x\r\n"), __FSR_FUNC__, nLLDRe));
+
+    return nLLDRe;
+}
+
+
+
+/**
+ * @brief           This function copies a page with random-in data
+ *
+ * @param[in]       nDev        : Physical Device Number
+ * @param[in]       pstCpArg    : source, destination and random-in data
+ * @param[in]       nFlag       : FSR_LLD_FLAG_1X_CPBK_LOAD or _PROGRAM
+ *
+ * @return          FSR_LLD_SUCCESS
+ * @return          FSR_LLD_INVALID_PARAM
+ * @return          FSR_LLD_MALLOC_FAIL
+ *
+ * @remark          a load copies the source into a private page buffer,
+ * @n               the program applies random-in and writes it out.
+ *
+ */
+PUBLIC INT32
+FSR_RAM_CopyBack(UINT32         nDev,
+                 LLDCpBkArg    *pstCpArg,
+                 UINT32         nFlag)
+{
+    RAMCxt     *pstCxt;
+    UINT8      *pPgBuf;
+    UINT8      *pDst;
+    LLDRndInArg *pstRndIn;
+    UINT32      nCmdIdx;
+    UINT32      nIdx;
+    UINT32      nOffset;
+    INT32       nLLDRe = FSR_LLD_SUCCESS;
+
+    do
+    {
+        if (pstCpArg == NULL)
+        {
+            nLLDRe = FSR_LLD_INVALID_PARAM;
+            break;
+        }
+
+#if defined (FSR_LLD_STRICT_CHK)
+        nLLDRe = _StrictChk(nDev, pstCpArg->nSrcPbn, pstCpArg->nSrcPgOffset);
+        if (nLLDRe != FSR_LLD_SUCCESS)
+        {
+            break;
+        }
+        nLLDRe = _StrictChk(nDev, pstCpArg->nDstPbn, pstCpArg->nDstPgOffset);
+        if (nLLDRe != FSR_LLD_SUCCESS)
+        {
+            break;
+        }
+#endif /* #if defined (FSR_LLD_STRICT_CHK) */
+
+        pstCxt  = gpstRAMCxt[nDev];
+        nCmdIdx = (nFlag & FSR_LLD_FLAG_CMDIDX_MASK) >> FSR_LLD_FLAG_CMDIDX_BASEBIT;
+
+        _WaitReady(pstCxt);
+        nLLDRe = pstCxt->nPrevOpRe;
+        pstCxt->nPrevOpRe = FSR_LLD_SUCCESS;
+
+        if (nCmdIdx == FSR_LLD_FLAG_1X_CPBK_LOAD)
+        {
+            pstCxt->pDataRAM = _GetPage(pstCxt, pstCpArg->nSrcPbn,
+                                        pstCpArg->nSrcPgOffset);
+            _SetBusy(pstCxt, gnSimLoadTime);
+            gstRAMStat.nSLCLoads++;
+            break;
+        }
+
+        if (nCmdIdx != FSR_LLD_FLAG_1X_CPBK_PROGRAM)
+        {
+            nLLDRe = FSR_LLD_INVALID_PARAM;
+            break;
+        }
+
+        pPgBuf = pstCxt->pCpBkBuf;
+
+        FSR_OAM_MEMCPY(pPgBuf, pstCxt->pDataRAM, pstCxt->nPgSize);
+
+        for (nIdx = 0; nIdx < pstCpArg->nRndInCnt; nIdx++)
+        {
+            pstRndIn = &(pstCpArg->pstRndInArg[nIdx]);
+
+            /* spare offsets are 0x4000 based and count user bytes only */
+            if (pstRndIn->nOffset >= 0x4000)
+            {
+                FSRSpareBufBase stBase;
+                FSRSpareBufExt  stExt[FSR_MAX_SPARE_BUF_EXT];
+                FSRSpareBuf     stSBuf;
+                UINT8          *pUser;
+
+                stSBuf.pstSpareBufBase = &stBase;
+                stSBuf.nNumOfMetaExt   = FSR_MAX_SPARE_BUF_EXT;
+                stSBuf.pstSTLMetaExt   = &stExt[0];
+
+                _ReadSpare(pstCxt, &stSBuf, pPgBuf + pstCxt->nMainSize);
+
+                nOffset = pstRndIn->nOffset - 0x4000;
+                pUser   = (nOffset < FSR_SPARE_BUF_BASE_SIZE) ?
+                          (UINT8 *) &stBase + nOffset :
+                          (UINT8 *) &stExt[0] + nOffset - FSR_SPARE_BUF_BASE_SIZE;
+
+                if (nOffset + pstRndIn->nNumOfBytes > FSR_RAM_MAX_USER_SPARE)
+                {
+                    nLLDRe = FSR_LLD_INVALID_PARAM;
+                    break;
+                }
+
+                FSR_OAM_MEMCPY(pUser, pstRndIn->pBuf, pstRndIn->nNumOfBytes);
+
+                /* rebuild the spare from scratch with the new user bytes */
+                FSR_OAM_MEMSET(pPgBuf + pstCxt->nMainSize, 0xFF, pstCxt->nSpareSize);
+                _WriteSpare(pstCxt, pPgBuf + pstCxt->nMainSize, &stSBuf,
+                            (stBase.nBMLMetaBase0 == FSR_LLD_BBM_META_MARK) ?
+                            FSR_LLD_FLAG_BBM_META_BLOCK : FSR_LLD_FLAG_NONE);
+                *(UINT16 *) (pPgBuf + pstCxt->nMainSize) = stBase.nBadMark;
+            }
+            else
+            {
+                if (pstRndIn->nOffset + pstRndIn->nNumOfBytes > pstCxt->nMainSize)
+                {
+                    nLLDRe = FSR_LLD_INVALID_PARAM;
+                    break;
+                }
+
+                FSR_OAM_MEMCPY(pPgBuf + pstRndIn->nOffset, pstRndIn->pBuf,
+                               pstRndIn->nNumOfBytes);
+            }
+        }
+
+        if (nLLDRe == FSR_LLD_INVALID_PARAM)
+        {
+            break;
+        }
+
+        pDst = _GetPage(pstCxt, pstCpArg->nDstPbn, pstCpArg->nDstPgOffset);
+        _ProgramBytes(pDst, pPgBuf, pstCxt->nPgSize);
+
+        pstCxt->pDataRAM = pDst;
+        _SetBusy(pstCxt, gnSimProgTime);
+        gstRAMStat.nSLCPgms++;
+    } while (0);
+
+    return nLLDRe;
+}
+
+
+
+/**
+ * @brief           This function checks whether block is bad or not
+ *
+ * @param[in]       nDev        : Physical Device Number
+ * @param[in]       nPbn        : Physical block number
+ * @param[in]       nFlag       : FSR_LLD_FLAG_1X_CHK_BADBLOCK
+ *
+ * @return          FSR_LLD_INIT_GOODBLOCK
+ * @return          FSR_LLD_INIT_BADBLOCK | {FSR_LLD_BAD_BLK_1STPLN}
+ * @return          FSR_LLD_INVALID_PARAM
+ *
+ * @remark          a block is bad when every bad mark page says so
+ *
+ */
+PUBLIC INT32
+FSR_RAM_ChkBadBlk(UINT32 nDev,
+                  UINT32 nPbn,
+                  UINT32 nFlag)
+{
+    RAMCxt     *pstCxt;
+    UINT32      nPgIdx;
+    UINT16      nBadMark;
+    BOOL32      bIsBadBlk = FALSE32;
+
+#if defined (FSR_LLD_STRICT_CHK)
+    if (_StrictChk(nDev, nPbn, 0) != FSR_LLD_SUCCESS)
+    {
+        return FSR_LLD_INVALID_PARAM;
+    }
+#endif /* #if defined (FSR_LLD_STRICT_CHK) */
+
+    pstCxt = gpstRAMCxt[nDev];
+
+    for (nPgIdx = 0; nPgIdx < FSR_RAM_NUM_OF_BAD_MARK_PAGES; nPgIdx++)
+    {
+        _WaitReady(pstCxt);
+        _SetBusy(pstCxt, gnSimLoadTime);
+        gstRAMStat.nSLCLoads++;
+
+        nBadMark = *(UINT16 *) (_GetPage(pstCxt, nPbn, nPgIdx) + pstCxt->nMainSize);
+
+        bIsBadBlk = _IsBadMark(nBadMark);
+        if (bIsBadBlk == FALSE32)
+        {
+            break;
+        }
+    }
+
+    _WaitReady(pstCxt);
+
+    if (bIsBadBlk == TRUE32)
+    {
+        FSR_DBZ_RTLMOUT(FSR_DBZ_LLD_INF,
+            (TEXT("[RAM:INF]   nPbn = %d is a bad block\r\n"), nPbn));
+        return FSR_LLD_INIT_BADBLOCK | FSR_LLD_BAD_BLK_1STPLN;
+    }
+
+    return FSR_LLD_INIT_GOODBLOCK;
+}
+
+
+
+/**
+ * @brief           This function completes the previous operation
+ *
+ * @param[in]       nDev        : Physical Device Number
+ * @param[in]       nDieIdx     : die index
+ * @param[in]       nFlag       : FSR_LLD_FLAG_NONE
+ *
+ * @return          FSR_LLD_SUCCESS
+ * @return          FSR_LLD_INVALID_PARAM
+ * @return          result of the previous program or erase
+ *
+ * @remark
+ *
+ */
+PUBLIC INT32
+FSR_RAM_FlushOp(UINT32 nDev,
+                UINT32 nDieIdx,
+                UINT32 nFlag)
+{
+    RAMCxt     *pstCxt;
+    INT32       nLLDRe;
+
+    if ((nDev >= FSR_RAM_MAX_DEVS) || (gpstRAMCxt[nDev] == NULL) ||
+        (gpstRAMCxt[nDev]->bOpen == FALSE32))
+    {
+        return FSR_LLD_INVALID_PARAM;
+    }
+
+    pstCxt = gpstRAMCxt[nDev];
+
+    _WaitReady(pstCxt);
+
+    nLLDRe = pstCxt->nPrevOpRe;
+    if ((nFlag & FSR_LLD_FLAG_REMAIN_PREOP_STAT) == 0)
+    {
+        pstCxt->nPrevOpRe = FSR_LLD_SUCCESS;
+    }
+
+    return nLLDRe;
+}
+
+
+
+/**
+ * @brief           This function returns the type of a block
+ *
+ * @param[in]       nDev        : Physical Device Number
+ * @param[in]       nPbn        : Physical block number
+ * @param[out]      pBlockType  : FSR_LLD_SLC_BLOCK
+ * @param[out]      pPgsPerBlk  : the number of pages per block
+ *
+ * @return          FSR_LLD_SUCCESS
+ * @return          FSR_LLD_INVALID_PARAM
+ *
+ * @remark
+ *
+ */
+PUBLIC INT32
+FSR_RAM_GetBlockInfo(UINT32     nDev,
+                     UINT32     nPbn,
+                     UINT32    *pBlockType,
+                     UINT32    *pPgsPerBlk)
+{
+#if defined (FSR_LLD_STRICT_CHK)
+    if (_StrictChk(nDev, nPbn, 0) != FSR_LLD_SUCCESS)
+    {
+        return FSR_LLD_INVALID_PARAM;
+    }
+#endif /* #if defined (FSR_LLD_STRICT_CHK) */
+
+    if (pBlockType != NULL)
+    {
+        *pBlockType = FSR_LLD_SLC_BLOCK;
+    }
+
+    if (pPgsPerBlk != NULL)
+    {
+        *pPgsPerBlk = gpstRAMCxt[nDev]->nPgsPerBlk;
+    }
+
+    return FSR_LLD_SUCCESS;
+}
+
+
+
+/**
+ * @brief           This function reports device information to upper layer.
+ *
+ * @param[in]       nDev        : Physical Device Number
+ * @param[out]      pstDevSpec  : pointer to the device spec
+ * @param[in]       nFlag       :
+ *
+ * @return          FSR_LLD_SUCCESS
+ * @return          FSR_LLD_OPEN_FAILURE
+ *
+ * @remark          the device looks like a single die SLC OneNAND
+ *
+ */
+PUBLIC INT32
+FSR_RAM_GetDevSpec(UINT32      nDev,
+                   FSRDevSpec *pstDevSpec,
+                   UINT32      nFlag)
+{
+    RAMCxt     *pstCxt;
+
+    if ((pstDevSpec == NULL) || (nDev >= FSR_RAM_MAX_DEVS) ||
+        (gpstRAMCxt[nDev] == NULL) || (gpstRAMCxt[nDev]->bOpen == FALSE32))
+    {
+        return FSR_LLD_OPEN_FAILURE;
+    }
+
+    pstCxt = gpstRAMCxt[nDev];
+
+    FSR_OAM_MEMSET(pstDevSpec, 0xFF, sizeof(FSRDevSpec));
+
+    pstDevSpec->nNumOfBlks          = (UINT16) pstCxt->nNumOfBlks;
+    pstDevSpec->nNumOfPlanes        = 1;
+    pstDevSpec->nBlksForSLCArea[0]  = (UINT16) pstCxt->nNumOfBlks;
+    pstDevSpec->nSparePerSct        = FSR_RAM_SPARE_PER_SCT;
+    pstDevSpec->nSctsPerPG          = (UINT16) pstCxt->nSctsPerPG;
+    pstDevSpec->nNumOfBlksIn1stDie  = (UINT16) pstCxt->nNumOfBlks;
+    pstDevSpec->nDID                = (pstCxt->nSctsPerPG == 8) ?
+                                      FSR_RAM_DID_4K : FSR_RAM_DID_2K;
+    pstDevSpec->nPgsPerBlkForSLC    = pstCxt->nPgsPerBlk;
+    pstDevSpec->nPgsPerBlkForMLC    = 0;
+    pstDevSpec->nNumOfDies          = 1;
+    pstDevSpec->nUserOTPScts        = 0;
+    pstDevSpec->b1stBlkOTP          = FALSE32;
+    /* the same 2% reservoir the OneNAND spec tables use */
+    pstDevSpec->nRsvBlksInDev       = (UINT16) ((pstCxt->nNumOfBlks * 2 + 99) / 100);
+    pstDevSpec->pPairedPgMap        = NULL;
+    pstDevSpec->pLSBPgMap           = NULL;
+
+    pstDevSpec->nNANDType           = FSR_LLD_SLC_ONENAND;
+    pstDevSpec->nPgBufToDataRAMTime = 0;
+    pstDevSpec->bCachePgm           = FALSE32;
+
+    pstDevSpec->nSLCTLoadTime       = gnSimLoadTime;
+    pstDevSpec->nMLCTLoadTime       = 0;
+    pstDevSpec->nSLCTProgTime       = gnSimProgTime;
+    pstDevSpec->nMLCTProgTime[0]    = 0;
+    pstDevSpec->nMLCTProgTime[1]    = 0;
+    pstDevSpec->nTEraseTime         = gnSimEraseTime;
+
+    /* Time for transfering 1 page in usec */
+    pstDevSpec->nWrTranferTime      = (UINT32) (((u64) pstCxt->nPgSize * gnSimWrTransTime) >> 10) / 1000;
+    pstDevSpec->nRdTranferTime      = (UINT32) (((u64) pstCxt->nPgSize * gnSimRdTransTime) >> 10) / 1000;
+    pstDevSpec->nSLCPECycle         = 50000;
+    pstDevSpec->nMLCPECycle         = 0;
+
+    FSR_OAM_MEMSET(&pstDevSpec->nUID[0], 0x00, FSR_LLD_UID_SIZE);
+    pstDevSpec->nUID[0]             = (UINT8) nDev;
+
+    return FSR_LLD_SUCCESS;
+}
+
+
+
+/**
+ * @brief           This function provides access information
+ *
+ * @param[in]       nDev        : Physical Device Number
+ * @param[out]      pLLDPltInfo : Structure for platform information.
+ *
+ * @return          FSR_LLD_SUCCESS
+ * @return          FSR_LLD_INVALID_PARAM
+ *
+ * @remark          there are no registers, every field reads 0
+ *
+ */
+PUBLIC INT32
+FSR_RAM_GetPlatformInfo(UINT32           nDev,
+                        LLDPlatformInfo *pLLDPltInfo)
+{
+    if ((pLLDPltInfo == NULL) || (nDev >= FSR_RAM_MAX_DEVS))
+    {
+        return FSR_LLD_INVALID_PARAM;
+    }
+
+    FSR_OAM_MEMSET(pLLDPltInfo, 0x00, sizeof(LLDPlatformInfo));
+
+    return FSR_LLD_SUCCESS;
+}
+
+
+
+/**
+ * @brief           This function reads data of the previous operation
+ *
+ * @param[in]       nDev        : Physical Device Number
+ * @param[out]      pMBuf       : Memory buffer for main  array of NAND flash
+ * @param[out]      pSBuf       : Memory buffer for spare array of NAND flash
+ * @param[in]       nDieIdx     : die index
+ * @param[in]       nFlag       :
+ *
+ * @return          FSR_LLD_SUCCESS
+ * @return          FSR_LLD_INVALID_PARAM
+ *
+ * @remark          returns the page last loaded or programmed
+ *
+ */
+PUBLIC INT32
+FSR_RAM_GetPrevOpData(UINT32         nDev,
+                      UINT8         *pMBuf,
+                      FSRSpareBuf   *pSBuf,
+                      UINT32         nDieIdx,
+                      UINT32         nFlag)
+{
+    RAMCxt     *pstCxt;
+
+    if ((nDev >= FSR_RAM_MAX_DEVS) || (gpstRAMCxt[nDev] == NULL) ||
+        (gpstRAMCxt[nDev]->bOpen == FALSE32))
+    {
+        return FSR_LLD_INVALID_PARAM;
+    }
+
+    pstCxt = gpstRAMCxt[nDev];
+
+    if (pMBuf != NULL)
+    {
+        FSR_OAM_MEMCPY(pMBuf, pstCxt->pDataRAM, pstCxt->nMainSize);
+    }
+
+    if (pSBuf != NULL)
+    {
+        _ReadSpare(pstCxt, pSBuf, pstCxt->pDataRAM + pstCxt->nMainSize);
+    }
+
+    return FSR_LLD_SUCCESS;
+}
+
+
+
+/**
+ * @brief           This function serves the IO control codes of the BML
+ *
+ * @param[in]       nDev        : Physical Device Number
+ * @param[in]       nCode       : IO control code
+ * @param[in]       pBufI       : input buffer
+ * @param[in]       nLenI       : length of input buffer
+ * @param[out]      pBufO       : output buffer
+ * @param[in]       nLenO       : length of output buffer
+ * @param[out]      pByteRet    : the number of bytes returned
+ *
+ * @return          FSR_LLD_SUCCESS
+ * @return          FSR_LLD_INVALID_PARAM
+ * @return          FSR_LLD_IOCTL_NOT_SUPPORT
+ *
+ * @remark          every block is unlocked and there is no OTP or PI
+ *
+ */
+PUBLIC INT32
+FSR_RAM_IOCtl(UINT32  nDev,
+              UINT32  nCode,
+              UINT8  *pBufI,
+              UINT32  nLenI,
+              UINT8  *pBufO,
+              UINT32  nLenO,
+              UINT32 *pByteRet)
+{
+    INT32       nLLDRe = FSR_LLD_SUCCESS;
+
+    if (nDev >= FSR_RAM_MAX_DEVS)
+    {
+        return FSR_LLD_INVALID_PARAM;
+    }
+
+    if (pByteRet != NULL)
+    {
+        *pByteRet = 0;
+    }
+
+    switch (nCode)
+    {
+    case FSR_LLD_IOCTL_GET_LOCK_STAT:
+        if ((pBufO == NULL) || (nLenO != sizeof(UINT32)))
+        {
+            nLLDRe = FSR_LLD_INVALID_PARAM;
+            break;
+        }
+
+        *(UINT32 *) pBufO = FSR_LLD_BLK_STAT_UNLOCKED;
+
+        if (pByteRet != NULL)
+        {
+            *pByteRet = sizeof(UINT32);
+        }
+        break;
+
+    case FSR_LLD_IOCTL_OTP_GET_INFO:
+        if ((pBufO == NULL) || (nLenO != sizeof(UINT32)))
+        {
+            nLLDRe = FSR_LLD_INVALID_PARAM;
+            break;
+        }
+
+        *(UINT32 *) pBufO = FSR_LLD_OTP_1ST_BLK_UNLKED | FSR_LLD_OTP_OTP_BLK_UNLKED;
+        break;
+
+    case FSR_LLD_IOCTL_LOCK_BLOCK:
+    case FSR_LLD_IOCTL_LOCK_TIGHT:
+    case FSR_LLD_IOCTL_UNLOCK_BLOCK:
+    case FSR_LLD_IOCTL_UNLOCK_ALLBLK:
+    case FSR_LLD_IOCTL_HOT_RESET:
+    case FSR_LLD_IOCTL_CORE_RESET:
+        if ((gpstRAMCxt[nDev] != NULL) && (gpstRAMCxt[nDev]->bOpen == TRUE32))
+        {
+            _WaitReady(gpstRAMCxt[nDev]);
+        }
+        break;
+
+    default:
+        nLLDRe = FSR_LLD_IOCTL_NOT_SUPPORT;
+        break;
+    }
+
+    return nLLDRe;
+}
+
+
+
+/**
+ * @brief           This function clears the LLD statistics
+ *
+ * @return          FSR_LLD_SUCCESS
+ *
+ * @remark
+ *
+ */
+PUBLIC INT32
+FSR_RAM_InitLLDStat(VOID)
+{
+    FSR_OAM_MEMSET(&gstRAMStat, 0x00, sizeof(gstRAMStat));
+
+    return FSR_LLD_SUCCESS;
+}
+
+
+
+/**
+ * @brief           This function returns the LLD statistics
+ *
+ * @param[out]      pstStat : Pointer to the structure, FSRLLDStat
+ *
+ * @return          total busy time of the operations counted, in usec
+ *
+ * @remark
+ *
+ */
+PUBLIC INT32
+FSR_RAM_GetStat(FSRLLDStat *pstStat)
+{
+    if (pstStat == NULL)
+    {
+        return 0;
+    }
+
+    FSR_OAM_MEMCPY(pstStat, &gstRAMStat, sizeof(FSRLLDStat));
+
+    return (INT32) (gstRAMStat.nSLCLoads * gnSimLoadTime +
+                    gstRAMStat.nSLCPgms  * gnSimProgTime +
+                    gstRAMStat.nErases   * gnSimEraseTime);
+}
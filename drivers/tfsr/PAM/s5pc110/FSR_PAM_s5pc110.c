@@ -47,6 +47,7 @@
 /* - FSR_ENABLE_READ_DMA                                                     */
 /* - FSR_ENABLE_FLEXOND_LFT                                                  */
 /* - FSR_ENABLE_ONENAND_LFT                                                  */
+/* - FSR_ENABLE_RAMSIM_LFT                                                   */
 /*                                                                           */
 /*****************************************************************************/
 #if defined (CONFIG_FLEXOND)
@@ -63,6 +64,12 @@
 /**< if FSR_ENABLE_4K_ONENAND_LFT is defined, 
      Low level function table is linked with OneNAND LLD */
 #define     FSR_ENABLE_4K_ONENAND_LFT
+
+#elif defined (CONFIG_TINY_FSR_RAMSIM)
+/**< if FSR_ENABLE_RAMSIM_LFT is defined, 
+     Low level function table is linked with RAM simulator LLD
+     and OneNAND is not probed at all */
+#define     FSR_ENABLE_RAMSIM_LFT
 #endif
 
 #if defined(FSR_WINCE_OAM)
@@ -157,10 +164,14 @@
     #include "FSR_LLD_OneNAND.h"
 #endif
 
-#if defined(FSR_ENABLE_4K_ONENAND_LFT)
+#if defined(FSR_ENABLE_4K_ONENAND_LFT) || defined(FSR_ENABLE_RAMSIM_LFT)
     #include "FSR_LLD_4K_OneNAND.h"
 #endif
 
+#if defined(FSR_ENABLE_RAMSIM_LFT)
+    #include "FSR_LLD_RAM.h"
+#endif
+
 /*****************************************************************************/
 /* Global variables definitions                                              */
 /*****************************************************************************/
@@ -175,6 +186,7 @@
 #define     FSR_FND_4K_PAGE         (0)
 #define     FSR_OND_2K_PAGE         (1)
 #define     FSR_OND_4K_PAGE         (2)
+#define     FSR_RAM_SIM_PAGE        (3)
 
 #define     DBG_PRINT(x)            FSR_DBG_PRINT(x)
 #define     RTL_PRINT(x)            FSR_RTL_PRINT(x)
@@ -195,7 +207,7 @@ PRIVATE BOOL32                  gbUseReadDMA                = FALSE32;
 PRIVATE UINT32                  gbFlexOneNAND[FSR_MAX_VOLS] = {FSR_OND_2K_PAGE, FSR_OND_2K_PAGE};
 #if defined(FSR_ENABLE_ONENAND_LFT)
 PRIVATE volatile OneNANDReg     *gpOneNANDReg               = (volatile OneNANDReg *) 0;
-#elif defined(FSR_ENABLE_4K_ONENAND_LFT)
+#elif defined(FSR_ENABLE_4K_ONENAND_LFT) || defined(FSR_ENABLE_RAMSIM_LFT)
 PRIVATE volatile OneNAND4kReg   *gpOneNANDReg               = (volatile OneNAND4kReg *) 0;
 #elif defined(FSR_ENABLE_FLEXOND_LFT)
 PRIVATE volatile FlexOneNANDReg *gpOneNANDReg               = (volatile FlexOneNANDReg *) 0;
@@ -308,6 +320,14 @@ FSR_PAM_Init(VOID)
         gpOneNANDReg  = (volatile FlexOneNANDReg *) nONDVirBaseAddr;
 #endif
 
+#if defined(FSR_ENABLE_RAMSIM_LFT)
+        /* the simulated device lives in RAM, leave OneNAND alone */
+        gbFlexOneNAND[0] = FSR_RAM_SIM_PAGE;
+        gbFlexOneNAND[1] = FSR_RAM_SIM_PAGE;
+
+        RTL_PRINT((TEXT("[PAM:   ]   RAM simulated OneNAND\r\n")));
+#else
+
         /* check manufacturer ID */
         if (gpOneNANDReg->nMID != 0x00ec)
         {
@@ -341,6 +361,7 @@ FSR_PAM_Init(VOID)
             RTL_PRINT((TEXT("[PAM:   ]   OneNAND nMID=0x%2x : nDID=0x%02x\r\n"), 
                     gpOneNANDReg->nMID, gpOneNANDReg->nDID));
         }
+#endif /* #if defined(FSR_ENABLE_RAMSIM_LFT) */
 
         gstFsrVolParm[0].nBaseAddr[0] = nONDVirBaseAddr;
         gstFsrVolParm[0].nBaseAddr[1] = FSR_PAM_NOT_MAPPED;
@@ -498,6 +519,31 @@ FSR_PAM_RegLFT(FSRLowFuncTbl  *pstLFT[FSR_MAX_VOLS])
 #else
             RTL_PRINT((TEXT("[PAM:ERR] LowFuncTbl(FlexOneNAND) isn't linked : %s / line %d\r\n"), __FSR_FUNC__, __LINE__));
             return FSR_PAM_LFT_NOT_LINKED;
+#endif
+        }
+        else if (gbFlexOneNAND[0] == FSR_RAM_SIM_PAGE)
+        {
+#if defined(FSR_ENABLE_RAMSIM_LFT)
+            pstLFT[nVolIdx]->LLD_Init               = FSR_RAM_Init;
+            pstLFT[nVolIdx]->LLD_Open               = FSR_RAM_Open;
+            pstLFT[nVolIdx]->LLD_Close              = FSR_RAM_Close;
+            pstLFT[nVolIdx]->LLD_Erase              = FSR_RAM_Erase;
+            pstLFT[nVolIdx]->LLD_ChkBadBlk          = FSR_RAM_ChkBadBlk;
+            pstLFT[nVolIdx]->LLD_FlushOp            = FSR_RAM_FlushOp;
+            pstLFT[nVolIdx]->LLD_GetDevSpec         = FSR_RAM_GetDevSpec;
+            pstLFT[nVolIdx]->LLD_Read               = FSR_RAM_Read;
+            pstLFT[nVolIdx]->LLD_ReadOptimal        = FSR_RAM_ReadOptimal;
+            pstLFT[nVolIdx]->LLD_Write              = FSR_RAM_Write;
+            pstLFT[nVolIdx]->LLD_CopyBack           = FSR_RAM_CopyBack;
+            pstLFT[nVolIdx]->LLD_GetPrevOpData      = FSR_RAM_GetPrevOpData;
+            pstLFT[nVolIdx]->LLD_IOCtl              = FSR_RAM_IOCtl;
+            pstLFT[nVolIdx]->LLD_InitLLDStat        = FSR_RAM_InitLLDStat;
+            pstLFT[nVolIdx]->LLD_GetStat            = FSR_RAM_GetStat;
+            pstLFT[nVolIdx]->LLD_GetBlockInfo       = FSR_RAM_GetBlockInfo;
+            pstLFT[nVolIdx]->LLD_GetNANDCtrllerInfo = FSR_RAM_GetPlatformInfo;
+#else
+            RTL_PRINT((TEXT("[PAM:ERR] LowFuncTbl(RAM simulator) isn't linked : %s / line %d\r\n"), __FSR_FUNC__, __LINE__));
+            return FSR_PAM_LFT_NOT_LINKED;
 #endif
         }
     }
@@ -579,6 +625,31 @@ FSR_PAM_RegLFT(FSRLowFuncTbl  *pstLFT[FSR_MAX_VOLS])
 #else
             RTL_PRINT((TEXT("[PAM:ERR] LowFuncTbl(FlexOneNAND) isn't linked : %s / line %d\r\n"), __FSR_FUNC__, __LINE__));
             return FSR_PAM_LFT_NOT_LINKED;
+#endif
+        }
+        else if (gbFlexOneNAND[1] == FSR_RAM_SIM_PAGE)
+        {
+#if defined(FSR_ENABLE_RAMSIM_LFT)
+            pstLFT[nVolIdx]->LLD_Init               = FSR_RAM_Init;
+            pstLFT[nVolIdx]->LLD_Open               = FSR_RAM_Open;
+            pstLFT[nVolIdx]->LLD_Close              = FSR_RAM_Close;
+            pstLFT[nVolIdx]->LLD_Erase              = FSR_RAM_Erase;
+            pstLFT[nVolIdx]->LLD_ChkBadBlk          = FSR_RAM_ChkBadBlk;
+            pstLFT[nVolIdx]->LLD_FlushOp            = FSR_RAM_FlushOp;
+            pstLFT[nVolIdx]->LLD_GetDevSpec         = FSR_RAM_GetDevSpec;
+            pstLFT[nVolIdx]->LLD_Read               = FSR_RAM_Read;
+            pstLFT[nVolIdx]->LLD_ReadOptimal        = FSR_RAM_ReadOptimal;
+            pstLFT[nVolIdx]->LLD_Write              = FSR_RAM_Write;
+            pstLFT[nVolIdx]->LLD_CopyBack           = FSR_RAM_CopyBack;
+            pstLFT[nVolIdx]->LLD_GetPrevOpData      = FSR_RAM_GetPrevOpData;
+            pstLFT[nVolIdx]->LLD_IOCtl              = FSR_RAM_IOCtl;
+            pstLFT[nVolIdx]->LLD_InitLLDStat        = FSR_RAM_InitLLDStat;
+            pstLFT[nVolIdx]->LLD_GetStat            = FSR_RAM_GetStat;
+            pstLFT[nVolIdx]->LLD_GetBlockInfo       = FSR_RAM_GetBlockInfo;
+            pstLFT[nVolIdx]->LLD_GetNANDCtrllerInfo = FSR_RAM_GetPlatformInfo;
+#else
+            RTL_PRINT((TEXT("[PAM:ERR] LowFuncTbl(RAM simulator) isn't linked : %s / line %d\r\n"), __FSR_FUNC__, __LINE__));
+            return FSR_PAM_LFT_NOT_LINKED;
 #endif
         }
     }
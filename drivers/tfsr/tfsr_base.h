@@ -256,14 +256,12 @@ static inline unsigned int fsr_stl_page_size(stl_info_t *ssp)
 
 struct fsr_dev 
 {
-	struct request		*req;        
 	struct list_head	list;
 	int			size;
 	spinlock_t		lock;
 	struct request_queue	*queue;
 	struct gendisk		*gd;
 	int			dev_id;
-	struct scatterlist	*sg;
 };
 #else
 /* Kernel 2.4 */
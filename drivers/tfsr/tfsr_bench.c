@@ -0,0 +1,197 @@
+/*
+ *---------------------------------------------------------------------------*
+ *                                                                           *
+ * Copyright (C) 2003-2010 Samsung Electronics                               *
+ * This program is free software; you can redistribute it and/or modify      *
+ * it under the terms of the GNU General Public License version 2 as         *
+ * published by the Free Software Foundation.                                *
+ *                                                                           *
+ *---------------------------------------------------------------------------*
+*/
+
+/**
+ * @version	LinuStoreIII_1.2.0_b032-FSR_1.2.1p1_b129_RTM
+ * @file        drivers/tfsr/tfsr_bench.c
+ * @brief       BML read benchmark. Writing "<volume> <pages> <count> [rand]"
+ *              to /sys/kernel/debug/tfsr_bench issues <count> FSR_BML_Read()
+ *              calls of <pages> pages each, sequentially or at random page
+ *              offsets, and reading it back gives MB/s and IOPS of the last
+ *              run. With the RAM LLD (CONFIG_TINY_FSR_RAMSIM) this measures
+ *              the BML and LLD paths against a known device timing.
+ *
+ */
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/init.h>
+#include <linux/mutex.h>
+#include <linux/vmalloc.h>
+#include <linux/random.h>
+#include <linux/ktime.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+
+#include <asm/uaccess.h>
+
+#include <FSR.h>
+#include "tfsr_base.h"
+
+#define BENCH_MAX_PAGES		128
+
+static DEFINE_MUTEX(bench_mutex);
+
+/* result of the last run */
+static struct {
+	u32 volume;
+	u32 pages;
+	u32 count;
+	int random;
+	u32 done;
+	u32 page_size;
+	s64 us;
+	int error;
+} bench_last;
+
+/**
+ * run one benchmark pass
+ * @param volume        : volume number
+ * @param pages         : pages per FSR_BML_Read() call
+ * @param count         : number of calls
+ * @param random        : 0 for sequential, otherwise random page offsets
+ * @return              0 on success, otherwise on error
+ */
+static int bench_run(u32 volume, u32 pages, u32 count, int random)
+{
+	FSRVolSpec *vs;
+	u32 nr_pages, page_size, vpn = 0, i;
+	ktime_t start;
+	u8 *buf;
+	int ret = 0;
+
+	if (volume >= FSR_MAX_VOLUMES || !pages || pages > BENCH_MAX_PAGES ||
+	    !count)
+		return -EINVAL;
+
+	vs = fsr_get_vol_spec(volume);
+	/* the volume spec is only filled in for volumes that opened */
+	if (!vs->nSctsPerPg)
+		return -ENODEV;
+
+	page_size = vs->nSctsPerPg << SECTOR_BITS;
+	nr_pages = fsr_vol_unit_nr(vs) * vs->nPgsPerSLCUnit;
+	if (nr_pages < pages)
+		return -EINVAL;
+
+	buf = vmalloc(pages * page_size);
+	if (!buf)
+		return -ENOMEM;
+
+	start = ktime_get();
+	for (i = 0; i < count; i++) {
+		if (random)
+			vpn = random32() % (nr_pages - pages + 1);
+		else if (vpn + pages > nr_pages)
+			vpn = 0;
+
+		if (FSR_BML_Read(volume, vpn, pages, buf, NULL,
+				 FSR_BML_FLAG_ECC_ON) != FSR_BML_SUCCESS) {
+			ret = -EIO;
+			break;
+		}
+
+		if (!random)
+			vpn += pages;
+	}
+
+	bench_last.volume = volume;
+	bench_last.pages = pages;
+	bench_last.count = count;
+	bench_last.random = random;
+	bench_last.done = i;
+	bench_last.page_size = page_size;
+	bench_last.us = ktime_us_delta(ktime_get(), start);
+	bench_last.error = ret;
+
+	vfree(buf);
+	return ret;
+}
+
+static int bench_show(struct seq_file *m, void *unused)
+{
+	u64 kbps = 0, iops = 0;
+
+	mutex_lock(&bench_mutex);
+	if (!bench_last.count) {
+		seq_printf(m, "usage: echo \"<volume> <pages> <count> [rand]\""
+			   " > tfsr_bench\n");
+		goto out;
+	}
+
+	if (bench_last.us > 0) {
+		kbps = (u64)bench_last.done * bench_last.pages *
+		       bench_last.page_size * 1000;
+		do_div(kbps, (u32)bench_last.us);
+		kbps = kbps * 1000 >> 10;
+		iops = (u64)bench_last.done * 1000000;
+		do_div(iops, (u32)bench_last.us);
+	}
+
+	seq_printf(m, "volume %u, %u x %u pages of %u bytes, %s\n",
+		   bench_last.volume, bench_last.count, bench_last.pages,
+		   bench_last.page_size,
+		   bench_last.random ? "random" : "sequential");
+	seq_printf(m, "done %u in %lld us, %llu.%03llu MB/s, %llu IOPS%s\n",
+		   bench_last.done, bench_last.us,
+		   (unsigned long long)(kbps >> 10),
+		   (unsigned long long)((kbps & 1023) * 1000 >> 10),
+		   (unsigned long long)iops,
+		   bench_last.error ? ", read error" : "");
+out:
+	mutex_unlock(&bench_mutex);
+	return 0;
+}
+
+static int bench_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, bench_show, NULL);
+}
+
+static ssize_t bench_write(struct file *file, const char __user *ubuf,
+			   size_t len, loff_t *ppos)
+{
+	char buf[64];
+	char mode[8] = "";
+	u32 volume, pages, count;
+	int ret;
+
+	if (len >= sizeof(buf))
+		return -EINVAL;
+	if (copy_from_user(buf, ubuf, len))
+		return -EFAULT;
+	buf[len] = 0;
+
+	if (sscanf(buf, "%u %u %u %7s", &volume, &pages, &count, mode) < 3)
+		return -EINVAL;
+
+	mutex_lock(&bench_mutex);
+	ret = bench_run(volume, pages, count, !strcmp(mode, "rand"));
+	mutex_unlock(&bench_mutex);
+
+	return ret ? ret : len;
+}
+
+static const struct file_operations bench_fops = {
+	.open		= bench_open,
+	.read		= seq_read,
+	.write		= bench_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init bench_init(void)
+{
+	debugfs_create_file("tfsr_bench", S_IRUGO | S_IWUSR, NULL, NULL,
+			    &bench_fops);
+	return 0;
+}
+late_initcall(bench_init);
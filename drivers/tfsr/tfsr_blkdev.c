@@ -20,6 +20,8 @@
 #include <linux/fs.h>
 #include <linux/version.h>
 #include <linux/proc_fs.h>
+#include <linux/highmem.h>
+#include <linux/kthread.h>
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(2, 6, 15)
 #include <linux/platform_device.h>
 #else
@@ -53,34 +55,50 @@ EXPORT_SYMBOL(bml_module_resume);
 #endif /* end of CONFIG_PM */
 
 /**
- * transger data from BML to buffer cache
+ * largest transfer handed to the BML in one call, in sectors
+ */
+#define BML_MAX_SECTORS		128
+
+/**
+ * per-volume I/O thread
+ *
+ * Every disk of a volume hands its work to the volume's thread and goes
+ * back to its caller; bios and requests are completed from the thread.
+ * Bios queue in submission order, and runs of them that follow on from
+ * each other on flash are read with one multi-page BML call, which the
+ * make_request path would otherwise lose by skipping the elevator.
+ */
+struct bml_io
+{
+	spinlock_t		lock;
+	struct bio		*bio_head;	/* sectors are whole-volume */
+	struct bio		*bio_tail;
+	struct list_head	reqs;
+	wait_queue_head_t	wait;
+	struct task_struct	*thread;
+	char			*bounce;	/* one multi-page BML transfer */
+	u32			volume;
+};
+
+static struct bml_io bml_io[FSR_MAX_VOLUMES];
+
+/**
+ * read sectors of a partition from BML
  * @param volume        : device number
  * @param partno        : 0~15: partition, other: whole device
- * @param req           : request description
- * @return              1 on success, 0 on failure
- *
- * It will erase a block before it do write the data
+ * @param sector        : first sector, relative to the partition
+ * @param nsect         : number of sectors
+ * @param buf           : destination
+ * @return              0 on success, otherwise on error
  */
-static int bml_transfer(u32 volume, u32 partno, const struct request *req)
+static int bml_read_sectors(u32 volume, u32 partno, unsigned long sector,
+		unsigned long nsect, char *buf)
 {
-	unsigned long sector, nsect;
-	char *buf;
 	FSRVolSpec *vs;
 	FSRPartI *ps;
 	u32 nPgsPerUnit = 0, n1stVpn = 0, spp_shift, spp_mask;
 	int ret;
-	
-	DEBUG(DL3,"TINY[I]: volume(%d), partno(%d)\n", volume, partno);
 
-	if (!blk_fs_request(req))
-	{
-		return 0;
-	}
-	
-	sector = req->sector;
-	nsect = req->current_nr_sectors;
-	buf = req->buffer;
-	
 	vs = fsr_get_vol_spec(volume);
 	ps = fsr_get_part_spec(volume);
 	spp_shift = ffs(vs->nSctsPerPg) - 1;
@@ -97,28 +115,20 @@ static int bml_transfer(u32 volume, u32 partno, const struct request *req)
 		}
 	}
 
-	switch (rq_data_dir(req)) 
+	/*
+	 * If sector and nsect are aligned with vs->nSctsPerPg,
+	 * you have to use a FSR_BML_Read() function using page unit,
+	 * If not, use a FSR_BML_ReadScts() function using sector unit.
+	 */
+	if ((!(sector & spp_mask) && !(nsect & spp_mask))) 
 	{
-		case READ:
-			/*
-			 * If sector and nsect are aligned with vs->nSctsPerPg,
-			 * you have to use a FSR_BML_Read() function using page unit,
-			 * If not, use a FSR_BML_ReadScts() function using sector unit.
-			 */
-			if ((!(sector & spp_mask) && !(nsect & spp_mask))) 
-			{
-				ret = FSR_BML_Read(volume, n1stVpn + (sector >> spp_shift),
-						nsect >> spp_shift, buf, NULL, FSR_BML_FLAG_ECC_ON);
-			} 
-			else 
-			{
-				ret = FSR_BML_ReadScts(volume, n1stVpn + (sector >> spp_shift),
-						sector & spp_mask, nsect, buf, NULL, FSR_BML_FLAG_ECC_ON);
-			}
-			break;
-		default:
-			ERRPRINTK("Unknown request 0x%x\n", (u32) rq_data_dir(req));
-			return -EINVAL;
+		ret = FSR_BML_Read(volume, n1stVpn + (sector >> spp_shift),
+				nsect >> spp_shift, buf, NULL, FSR_BML_FLAG_ECC_ON);
+	} 
+	else 
+	{
+		ret = FSR_BML_ReadScts(volume, n1stVpn + (sector >> spp_shift),
+				sector & spp_mask, nsect, buf, NULL, FSR_BML_FLAG_ECC_ON);
 	}
 
 	/* I/O error */
@@ -127,85 +137,358 @@ static int bml_transfer(u32 volume, u32 partno, const struct request *req)
 		ERRPRINTK("TINY: transfer error = %X\n", ret);
 		return -EIO;
 	}
-	
+
+	return 0;
+}
+
+/**
+ * read one bio segment by segment, straight into its pages
+ * @param volume        : device number
+ * @param partno        : 0~15: partition, other: whole device
+ * @param bio           : bio to fill
+ * @param sector        : sector the bio starts at
+ * @return              0 on success, otherwise on error
+ */
+static int bml_read_bio_segments(u32 volume, u32 partno, struct bio *bio,
+		unsigned long sector)
+{
+	struct bio_vec *bvec;
+	char *buf;
+	int i, ret = 0;
+
+	bio_for_each_segment(bvec, bio, i)
+	{
+		buf = kmap(bvec->bv_page);
+		ret = bml_read_sectors(volume, partno, sector,
+				bvec->bv_len >> SECTOR_BITS, buf + bvec->bv_offset);
+		flush_dcache_page(bvec->bv_page);
+		kunmap(bvec->bv_page);
+		if (ret)
+		{
+			break;
+		}
+		sector += bvec->bv_len >> SECTOR_BITS;
+	}
+
+	return ret;
+}
+
+/**
+ * copy data from the bounce buffer into the pages of a bio
+ * @param bio           : bio to fill
+ * @param src           : data for the first segment of the bio
+ * @return              number of bytes copied
+ */
+static unsigned int bml_copy_to_bio(struct bio *bio, const char *src)
+{
+	struct bio_vec *bvec;
+	unsigned int done = 0;
+	char *dst;
+	int i;
+
+	bio_for_each_segment(bvec, bio, i)
+	{
+		dst = kmap_atomic(bvec->bv_page, KM_USER0);
+		memcpy(dst + bvec->bv_offset, src + done, bvec->bv_len);
+		kunmap_atomic(dst, KM_USER0);
+		flush_dcache_page(bvec->bv_page);
+		done += bvec->bv_len;
+	}
+
+	return done;
+}
+
+/**
+ * transfer data from BML to buffer cache
+ * @param volume        : device number
+ * @param partno        : 0~15: partition, other: whole device
+ * @param bio           : first bio, further ones hang off bi_next if chain
+ * @param chain         : 1 to follow bi_next (a request), 0 for one bio
+ * @param sector        : first sector of the transfer
+ * @param nsect         : total number of sectors of the transfer
+ * @param dir           : READ or WRITE
+ * @param bounce        : BML_MAX_SECTORS worth of buffer, or NULL
+ * @return              0 on success, otherwise on error
+ *
+ * Transfers up to BML_MAX_SECTORS are read with a single multi-page BML
+ * call into the bounce buffer, whatever their segments look like, so
+ * the LLD can stream them. Only this read-only BML is built (TINY_FSR),
+ * so writes are refused.
+ */
+static int bml_transfer(u32 volume, u32 partno, struct bio *bio, int chain,
+		unsigned long sector, unsigned long nsect, int dir, char *bounce)
+{
+	unsigned int off = 0;
+	int ret = 0;
+
+	DEBUG(DL3,"TINY[I]: volume(%d), partno(%d)\n", volume, partno);
+
+	if (dir != READ)
+	{
+		ERRPRINTK("TINY: read-only BML, write refused\n");
+		return -EROFS;
+	}
+
+	if (bounce && nsect <= BML_MAX_SECTORS)
+	{
+		ret = bml_read_sectors(volume, partno, sector, nsect, bounce);
+		for (; !ret && bio; bio = chain ? bio->bi_next : NULL)
+		{
+			off += bml_copy_to_bio(bio, bounce + off);
+		}
+	}
+	else
+	{
+		for (; !ret && bio; bio = chain ? bio->bi_next : NULL)
+		{
+			ret = bml_read_bio_segments(volume, partno, bio, sector);
+			sector += bio_sectors(bio);
+		}
+	}
+
 	DEBUG(DL3,"TINY[O]: volume(%d), partno(%d)\n", volume, partno);
 
-	return 1;
+	return ret;
 }
 
 /**
- * request function which is do read/write sector
- * @param rq    : request queue which is created by blk_init_queue()
- * @return              none
+ * take the next run of bios that follow on from each other on flash
+ * @param io            : volume I/O state, lock held
+ * @param nsect         : total sectors of the run
+ * @return              first bio of the run linked through bi_next, or NULL
  */
-static void bml_request(struct request_queue *rq)
+static struct bio *bml_io_next_run(struct bml_io *io, unsigned long *nsect)
 {
-	u32 minor, volume, partno, spp_mask;
-	struct request *req;
-	struct fsr_dev *dev;
-#if LINUX_VERSION_CODE < KERNEL_VERSION(2, 6, 25)
-	int ret;
-#endif
-	int trans_ret;
+	struct bio *head, *tail, *next;
 
-	FSRVolSpec *vs;
+	head = tail = io->bio_head;
+	if (!head)
+	{
+		return NULL;
+	}
 
-	DEBUG(DL3,"TINY[I]\n");
+	*nsect = bio_sectors(head);
+	while ((next = tail->bi_next) != NULL &&
+		bio_data_dir(next) == bio_data_dir(head) &&
+		next->bi_sector == head->bi_sector + *nsect &&
+		*nsect + bio_sectors(next) <= BML_MAX_SECTORS)
+	{
+		*nsect += bio_sectors(next);
+		tail = next;
+	}
 
-	dev = rq->queuedata;
-	if (dev->req)
-		return;
+	io->bio_head = tail->bi_next;
+	if (!io->bio_head)
+	{
+		io->bio_tail = NULL;
+	}
+	tail->bi_next = NULL;
+
+	return head;
+}
+
+/**
+ * body of the volume I/O thread
+ * @param arg           : struct bml_io of the volume
+ * @return              0
+ */
+static int bml_io_thread(void *arg)
+{
+	struct bml_io *io = arg;
+	struct request *req;
+	struct bio *bio, *next;
+	unsigned long nsect = 0;
+	int ret;
 
-	while ((dev->req = req = elv_next_request(rq)) != NULL) 
+	while (!kthread_should_stop())
 	{
-		spin_unlock_irq(rq->queue_lock);
-		
-		minor = dev->gd->first_minor;
-		volume = fsr_vol(minor);
-		partno = fsr_part(minor);
-		vs = fsr_get_vol_spec(volume);
-		spp_mask = vs->nSctsPerPg - 1;
-		
-		DEBUG(DL3,"TINY[I]: volume(%d), partno(%d)\n", volume, partno);
+		wait_event_interruptible(io->wait, kthread_should_stop() ||
+				io->bio_head || !list_empty(&io->reqs));
 
-		if (!(req->sector & spp_mask) && (req->current_nr_sectors != req->nr_sectors))
+		spin_lock_irq(&io->lock);
+		req = NULL;
+		if (!list_empty(&io->reqs))
+		{
+			req = list_entry(io->reqs.next, struct request, queuelist);
+			list_del_init(&req->queuelist);
+			bio = NULL;
+		}
+		else
 		{
-			blk_rq_map_sg(rq, req, dev->sg);
-			if (!((dev->sg->length >> SECTOR_BITS) & 0x7))
+			bio = bml_io_next_run(io, &nsect);
+		}
+		spin_unlock_irq(&io->lock);
+
+		if (req)
+		{
+			if (!blk_fs_request(req))
 			{
-				req->current_nr_sectors = dev->sg->length >> SECTOR_BITS;
+				ret = -EIO;
 			}
-			if (req->current_nr_sectors > req->nr_sectors)
+			else
+			{
+				ret = bml_transfer(io->volume,
+						fsr_part(req->rq_disk->first_minor),
+						req->bio, 1, req->sector,
+						req->nr_sectors, rq_data_dir(req),
+						io->bounce);
+			}
+			blk_end_request(req, ret, blk_rq_bytes(req));
+		}
+		else if (bio)
+		{
+			/* sectors were made whole-volume when queued */
+			ret = bml_transfer(io->volume, (u32) -1, bio, 1,
+					bio->bi_sector, nsect, bio_data_dir(bio),
+					io->bounce);
+			for (; bio; bio = next)
 			{
-				req->current_nr_sectors = req->nr_sectors;
+				next = bio->bi_next;
+				bio->bi_next = NULL;
+				bio_endio(bio, ret);
 			}
 		}
+	}
 
-		trans_ret = bml_transfer(volume, partno, req);
-		
-		spin_lock_irq(rq->queue_lock);
-#if LINUX_VERSION_CODE >= KERNEL_VERSION(2, 6, 25)
-		req->hard_cur_sectors = req->current_nr_sectors;
-		end_request(req, trans_ret);
-#else	
-		ret = end_that_request_chunk(req, trans_ret, req->current_nr_sectors << SECTOR_BITS);
-		if (!ret)
+	return 0;
+}
+
+/**
+ * start the I/O thread of a volume
+ * @param volume        : device number
+ * @return              0 on success, otherwise on error
+ */
+static int bml_io_start(u32 volume)
+{
+	struct bml_io *io = &bml_io[volume];
+
+	spin_lock_init(&io->lock);
+	INIT_LIST_HEAD(&io->reqs);
+	init_waitqueue_head(&io->wait);
+	io->bio_head = io->bio_tail = NULL;
+	io->volume = volume;
+
+	/* without it requests are still read, one segment at a time */
+	io->bounce = kmalloc(BML_MAX_SECTORS << SECTOR_BITS, GFP_KERNEL);
+	if (!io->bounce)
+	{
+		ERRPRINTK("TINY: no bounce buffer, multi-page reads disabled\n");
+	}
+
+	io->thread = kthread_run(bml_io_thread, io, "tfsr_io%d", volume);
+	if (IS_ERR(io->thread))
+	{
+		ERRPRINTK("TINY: can't start I/O thread for volume %d\n", volume);
+		io->thread = NULL;
+		kfree(io->bounce);
+		io->bounce = NULL;
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+/**
+ * stop the I/O thread of a volume, once its disks are gone
+ * @param volume        : device number
+ */
+static void bml_io_stop(u32 volume)
+{
+	struct bml_io *io = &bml_io[volume];
+
+	if (io->thread)
+	{
+		kthread_stop(io->thread);
+		io->thread = NULL;
+	}
+	kfree(io->bounce);
+	io->bounce = NULL;
+}
+
+#ifdef CONFIG_TINY_FSR_MAKE_REQUEST
+/**
+ * make_request function, bios go to the volume thread without the elevator
+ * @param q     : request queue which is created by blk_alloc_queue()
+ * @param bio   : bio to serve
+ * @return      0, the bio is always completed by the thread
+ */
+static int bml_make_request(struct request_queue *q, struct bio *bio)
+{
+	struct fsr_dev *dev = q->queuedata;
+	FSRVolSpec *vs;
+	FSRPartI *ps;
+	struct bml_io *io;
+	u32 volume, partno, nPgsPerUnit = 0, n1stVpn = 0;
+	unsigned long flags;
+
+	volume = fsr_vol(dev->gd->first_minor);
+	partno = fsr_part(dev->gd->first_minor);
+	io = &bml_io[volume];
+
+	if (!fsr_is_whole_dev(partno))
+	{
+		ps = fsr_get_part_spec(volume);
+		if (FSR_BML_GetVirUnitInfo(volume, fsr_part_start(ps, partno),
+				&n1stVpn, &nPgsPerUnit) != FSR_BML_SUCCESS)
 		{
-			add_disk_randomness(req->rq_disk);
-			blkdev_dequeue_request(req);
-#if LINUX_VERSION_CODE >= KERNEL_VERSION(2, 6, 16)
-			end_that_request_last(req, trans_ret);
-#else
-			end_that_request_last(req);
-#endif /* LINUX_VERSION_CODE >= KERNEL_VERSION(2, 6, 16) */
+			ERRPRINTK("FSR_BML_GetVirUnitInfo FAIL\n");
+			bio_endio(bio, -EIO);
+			return 0;
 		}
-#endif /* LINUX_VERSION_CODE >= KERNEL_VERSION(2, 6, 25) */
+	}
+
+	/* remap to the whole volume so that runs can cross partitions */
+	vs = fsr_get_vol_spec(volume);
+	bio->bi_sector += (sector_t) n1stVpn * vs->nSctsPerPg;
 
-		DEBUG(DL3,"TINY[O]: volume(%d), partno(%d)\n", volume, partno);
+	spin_lock_irqsave(&io->lock, flags);
+	bio->bi_next = NULL;
+	if (io->bio_tail)
+	{
+		io->bio_tail->bi_next = bio;
+	}
+	else
+	{
+		io->bio_head = bio;
 	}
+	io->bio_tail = bio;
+	spin_unlock_irqrestore(&io->lock, flags);
+
+	wake_up(&io->wait);
+
+	return 0;
+}
+#else
+/**
+ * request function, hands each request to the volume thread
+ * @param rq    : request queue which is created by blk_init_queue()
+ * @return              none
+ */
+static void bml_request(struct request_queue *rq)
+{
+	struct request *req;
+	struct fsr_dev *dev;
+	struct bml_io *io;
+
+	DEBUG(DL3,"TINY[I]\n");
+
+	dev = rq->queuedata;
+	io = &bml_io[fsr_vol(dev->gd->first_minor)];
+
+	while ((req = elv_next_request(rq)) != NULL) 
+	{
+		blkdev_dequeue_request(req);
+
+		spin_lock(&io->lock);
+		list_add_tail(&req->queuelist, &io->reqs);
+		spin_unlock(&io->lock);
+	}
+
+	wake_up(&io->wait);
 
 	DEBUG(DL3,"TINY[O]\n");
 }
+#endif /* CONFIG_TINY_FSR_MAKE_REQUEST */
 
 /**
  * add each partitions as disk
@@ -237,27 +520,38 @@ static int bml_add_disk(u32 volume, u32 partno)
 	up(&bml_list_mutex);
 	
 	/* init queue */
+#ifdef CONFIG_TINY_FSR_MAKE_REQUEST
+	dev->queue = blk_alloc_queue(GFP_KERNEL);
+	if (dev->queue)
+	{
+		blk_queue_make_request(dev->queue, bml_make_request);
+	}
+#else
 	dev->queue = blk_init_queue(bml_request, &dev->lock);
-	dev->queue->queuedata = dev;
-	dev->req = NULL;
-
-	/* alloc scatterlist */
-	dev->sg = kmalloc(sizeof(struct scatterlist) * dev->queue->max_phys_segments, GFP_KERNEL);
-	if (!dev->sg)
+#endif
+	if (!dev->queue)
 	{
+		down(&bml_list_mutex);
+		list_del(&dev->list);
+		up(&bml_list_mutex);
 		kfree(dev);
 		return -ENOMEM;
 	}
+	dev->queue->queuedata = dev;
 
-	memset(dev->sg, 0, sizeof(struct scatterlist) * dev->queue->max_phys_segments);
+	/* OneNAND: no seek penalty, and bigger transfers stream better */
+	queue_flag_set_unlocked(QUEUE_FLAG_NONROT, dev->queue);
+	blk_queue_max_sectors(dev->queue, BML_MAX_SECTORS);
 
 	/* Each partition is a physical disk which has one partition */
 	dev->gd = alloc_disk(1);
 	/* memory error */
 	if (!dev->gd) 
 	{
-		kfree(dev->sg);
+		blk_cleanup_queue(dev->queue);
+		down(&bml_list_mutex);
 		list_del(&dev->list);
+		up(&bml_list_mutex);
 		kfree(dev);
 		ERRPRINTK("No gendisk in DEV\r\n");
 		return -ENOMEM;
@@ -290,6 +584,8 @@ static int bml_add_disk(u32 volume, u32 partno)
 	
 	/* setup block device parameter array */
 	set_capacity(dev->gd, sectors);
+	/* only the read-only BML is built in */
+	set_disk_ro(dev->gd, 1);
 	
 	add_disk(dev->gd);
 	
@@ -314,8 +610,6 @@ static void bml_del_disk(struct fsr_dev *dev)
 		put_disk(dev->gd);
 	}
 
-	kfree(dev->sg);
-
 	if (dev->queue)
 	{
 		blk_cleanup_queue(dev->queue);
@@ -355,6 +649,11 @@ static int bml_blkdev_create(void)
 			FSR_BML_Close(volume, FSR_BML_FLAG_NONE);
 			continue;
 		}
+		if (bml_io_start(volume))
+		{
+			FSR_BML_Close(volume, FSR_BML_FLAG_NONE);
+			continue;
+		}
 		pi = fsr_get_part_spec(volume);
 		nparts = fsr_parts_nr(pi);
 		/*
@@ -393,6 +692,7 @@ static void bml_blkdev_free(void)
 {
 	struct fsr_dev *dev;
 	struct list_head *this, *next;
+	u32 volume;
 	
 	down(&bml_list_mutex);
 	list_for_each_safe(this, next, &bml_list) 
@@ -401,6 +701,11 @@ static void bml_blkdev_free(void)
 		bml_del_disk(dev);
 	}
 	up(&bml_list_mutex);
+
+	for (volume = 0; volume < FSR_MAX_VOLUMES; volume++)
+	{
+		bml_io_stop(volume);
+	}
 }
 
 /**
@@ -52,6 +52,7 @@
 #include <linux/tracehook.h>
 #include <linux/kmod.h>
 #include <linux/fsnotify.h>
+#include <linux/oom.h>
 
 #include <asm/uaccess.h>
 #include <asm/mmu_context.h>
@@ -847,6 +848,9 @@ static int de_thread(struct task_struct *tsk)
 		transfer_pid(leader, tsk, PIDTYPE_PGID);
 		transfer_pid(leader, tsk, PIDTYPE_SID);
 		list_replace_rcu(&leader->tasks, &tsk->tasks);
+		list_del_init(&leader->oom_adj_list);
+		list_add_tail(&tsk->oom_adj_list,
+			      oom_adj_bucket(tsk->oomkilladj));
 
 		tsk->group_leader = tsk;
 		leader->group_leader = tsk;
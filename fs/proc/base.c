@@ -1045,7 +1045,7 @@ static ssize_t oom_adjust_write(struct file *file, const char __user *buf,
 		put_task_struct(task);
 		return -EACCES;
 	}
-	task->oomkilladj = oom_adjust;
+	oom_adj_set(task, oom_adjust);
 	put_task_struct(task);
 	if (end - buffer == 0)
 		return -EIO;
@@ -51,6 +51,8 @@ extern const char *yaffs_guts_c_version;
 #include <linux/interrupt.h>
 #include <linux/string.h>
 #include <linux/ctype.h>
+#include <linux/kthread.h>
+#include <linux/freezer.h>
 
 #include "asm/div64.h"
 
@@ -122,15 +124,42 @@ unsigned int yaffs_traceMask = YAFFS_TRACE_BAD_BLOCKS;
 unsigned int yaffs_wr_attempts = YAFFS_WR_ATTEMPTS;
 unsigned int yaffs_auto_checkpoint = 1;
 
+/* Background garbage collection: started at mount when yaffs_bg_gc is set.
+ * The thread polls every yaffs_bg_gc_interval_ms and collects once the
+ * device has been idle for yaffs_bg_gc_idle_ms, or straight away when the
+ * erased block count is within yaffs_bg_gc_watermark of the reserve.
+ */
+unsigned int yaffs_bg_gc = 1;
+unsigned int yaffs_bg_gc_interval_ms = 250;
+unsigned int yaffs_bg_gc_idle_ms = 1000;
+unsigned int yaffs_bg_gc_watermark = 8;
+
+/* Rewrite the checkpoint from the background thread once a device has had
+ * no activity for yaffs_bg_checkpoint_ms (0 = only at sync/unmount), so an
+ * unclean shutdown is more likely to find a valid checkpoint and skip the
+ * full scan.
+ */
+unsigned int yaffs_bg_checkpoint_ms = 10000;
+
 /* Module Parameters */
 #if (LINUX_VERSION_CODE > KERNEL_VERSION(2, 5, 0))
 module_param(yaffs_traceMask, uint, 0644);
 module_param(yaffs_wr_attempts, uint, 0644);
 module_param(yaffs_auto_checkpoint, uint, 0644);
+module_param(yaffs_bg_gc, uint, 0444);
+module_param(yaffs_bg_gc_interval_ms, uint, 0644);
+module_param(yaffs_bg_gc_idle_ms, uint, 0644);
+module_param(yaffs_bg_gc_watermark, uint, 0644);
+module_param(yaffs_bg_checkpoint_ms, uint, 0644);
 #else
 MODULE_PARM(yaffs_traceMask, "i");
 MODULE_PARM(yaffs_wr_attempts, "i");
 MODULE_PARM(yaffs_auto_checkpoint, "i");
+MODULE_PARM(yaffs_bg_gc, "i");
+MODULE_PARM(yaffs_bg_gc_interval_ms, "i");
+MODULE_PARM(yaffs_bg_gc_idle_ms, "i");
+MODULE_PARM(yaffs_bg_gc_watermark, "i");
+MODULE_PARM(yaffs_bg_checkpoint_ms, "i");
 #endif
 
 #if (LINUX_VERSION_CODE < KERNEL_VERSION(2, 6, 25))
@@ -238,6 +267,10 @@ static void yaffs_clear_inode(struct inode *);
 
 static int yaffs_readpage(struct file *file, struct page *page);
 #if (LINUX_VERSION_CODE > KERNEL_VERSION(2, 5, 0))
+static int yaffs_readpages(struct file *file, struct address_space *mapping,
+			   struct list_head *pages, unsigned nr_pages);
+#endif
+#if (LINUX_VERSION_CODE > KERNEL_VERSION(2, 5, 0))
 static int yaffs_writepage(struct page *page, struct writeback_control *wbc);
 #else
 static int yaffs_writepage(struct page *page);
@@ -269,6 +302,9 @@ static int yaffs_follow_link(struct dentry *dentry, struct nameidata *nd);
 
 static struct address_space_operations yaffs_file_address_operations = {
 	.readpage = yaffs_readpage,
+#if (LINUX_VERSION_CODE > KERNEL_VERSION(2, 5, 0))
+	.readpages = yaffs_readpages,
+#endif
 	.writepage = yaffs_writepage,
 #if (YAFFS_USE_WRITE_BEGIN_END > 0)
 	.write_begin = yaffs_write_begin,
@@ -368,14 +404,121 @@ static const struct super_operations yaffs_super_ops = {
 static void yaffs_GrossLock(yaffs_Device *dev)
 {
 	T(YAFFS_TRACE_OS, ("yaffs locking %p\n", current));
-	down(&dev->grossLock);
+	down_write(&dev->grossLock);
+	dev->lastActivity = jiffies;
 	T(YAFFS_TRACE_OS, ("yaffs locked %p\n", current));
 }
 
 static void yaffs_GrossUnlock(yaffs_Device *dev)
 {
 	T(YAFFS_TRACE_OS, ("yaffs unlocking %p\n", current));
-	up(&dev->grossLock);
+	up_write(&dev->grossLock);
+}
+
+/*
+ * The shared flavour is only for reads yaffs_CanReadShared() approves of;
+ * anything that may change the device's state needs yaffs_GrossLock().
+ */
+static void yaffs_GrossLockShared(yaffs_Device *dev)
+{
+	T(YAFFS_TRACE_OS, ("yaffs locking shared %p\n", current));
+	down_read(&dev->grossLock);
+	dev->lastActivity = jiffies;
+	T(YAFFS_TRACE_OS, ("yaffs locked shared %p\n", current));
+}
+
+static void yaffs_GrossUnlockShared(yaffs_Device *dev)
+{
+	T(YAFFS_TRACE_OS, ("yaffs unlocking shared %p\n", current));
+	up_read(&dev->grossLock);
+}
+
+/*
+ * Background garbage collector and checkpointer.
+ * Only trylocks the gross lock and doesn't touch lastActivity, so it never
+ * holds up a foreground operation for longer than one collection step and
+ * doesn't keep itself from seeing the device as idle.
+ */
+static int yaffs_BackgroundThread(void *data)
+{
+	yaffs_Device *dev = (yaffs_Device *)data;
+	struct super_block *sb = (struct super_block *)dev->superBlock;
+	unsigned long idle;
+	int urgent;
+	int didGC;
+
+	T(YAFFS_TRACE_OS, ("yaffs background gc started for %s\n", dev->name));
+
+	set_freezable();
+
+	while (!kthread_should_stop()) {
+		try_to_freeze();
+
+		didGC = 0;
+		urgent = dev->nErasedBlocks <
+			 dev->nReservedBlocks + (int)yaffs_bg_gc_watermark;
+		idle = msecs_to_jiffies(yaffs_bg_gc_idle_ms);
+
+		if (!(sb->s_flags & MS_RDONLY) &&
+		    (urgent || time_after_eq(jiffies, dev->lastActivity + idle)) &&
+		    down_write_trylock(&dev->grossLock)) {
+			didGC = yaffs_BackgroundGarbageCollect(dev);
+			up_write(&dev->grossLock);
+		}
+
+		/* Checkpoint only once there is nothing left to collect, or
+		 * the next collection would just throw the checkpoint away.
+		 */
+		if (!didGC && !(sb->s_flags & MS_RDONLY) &&
+		    yaffs_auto_checkpoint >= 1 && yaffs_bg_checkpoint_ms &&
+		    !dev->isCheckpointed &&
+		    time_after_eq(jiffies, dev->lastActivity +
+				  msecs_to_jiffies(yaffs_bg_checkpoint_ms)) &&
+		    down_write_trylock(&dev->grossLock)) {
+			yaffs_FlushEntireDeviceCache(dev);
+			yaffs_CheckpointSave(dev);
+			up_write(&dev->grossLock);
+		}
+
+		if (didGC)
+			cond_resched();
+		else
+			schedule_timeout_interruptible(
+				msecs_to_jiffies(yaffs_bg_gc_interval_ms));
+	}
+
+	T(YAFFS_TRACE_OS, ("yaffs background gc stopped for %s\n", dev->name));
+	return 0;
+}
+
+static void yaffs_BackgroundStart(yaffs_Device *dev)
+{
+	struct task_struct *tsk;
+
+	if (!yaffs_bg_gc)
+		return;
+
+	tsk = kthread_run(yaffs_BackgroundThread, dev, "yaffs-bg-%s",
+			  dev->name ? dev->name : "?");
+	if (IS_ERR(tsk)) {
+		T(YAFFS_TRACE_ALWAYS,
+		  ("yaffs: could not start background gc (%ld)\n",
+		   PTR_ERR(tsk)));
+		return;
+	}
+
+	dev->bgThread = tsk;
+	dev->backgroundGC = 1;
+}
+
+static void yaffs_BackgroundStop(yaffs_Device *dev)
+{
+	if (!dev->bgThread)
+		return;
+
+	kthread_stop(dev->bgThread);
+	dev->bgThread = NULL;
+	dev->backgroundGC = 0;
 }
 
 static int yaffs_readlink(struct dentry *dentry, char __user *buffer,
@@ -603,6 +746,7 @@ static int yaffs_readpage_nolock(struct file *f, struct page *pg)
 	yaffs_Object *obj;
 	unsigned char *pg_buf;
 	int ret;
+	int shared;
 
 	yaffs_Device *dev;
 
@@ -624,13 +768,22 @@ static int yaffs_readpage_nolock(struct file *f, struct page *pg)
 	pg_buf = kmap(pg);
 	/* FIXME: Can kmap fail? */
 
-	yaffs_GrossLock(dev);
+	shared = yaffs_CanReadShared(dev,
+				(loff_t)pg->index << PAGE_CACHE_SHIFT,
+				PAGE_CACHE_SIZE);
+	if (shared)
+		yaffs_GrossLockShared(dev);
+	else
+		yaffs_GrossLock(dev);
 
 	ret = yaffs_ReadDataFromFile(obj, pg_buf,
 				pg->index << PAGE_CACHE_SHIFT,
 				PAGE_CACHE_SIZE);
 
-	yaffs_GrossUnlock(dev);
+	if (shared)
+		yaffs_GrossUnlockShared(dev);
+	else
+		yaffs_GrossUnlock(dev);
 
 	if (ret >= 0)
 		ret = 0;
@@ -662,6 +815,106 @@ static int yaffs_readpage(struct file *f, struct page *pg)
 	return yaffs_readpage_unlock(f, pg);
 }
 
+#if (LINUX_VERSION_CODE > KERNEL_VERSION(2, 5, 0))
+
+/* Most pages read together in one yaffs_ReadDataFromFile() from readahead */
+#define YAFFS_READPAGES_BATCH	8
+
+/*
+ * Read a run of consecutive, locked pages through one bounce buffer so that
+ * yaffs_ReadDataFromFile() can fetch chunks that are contiguous on NAND in a
+ * single request. Falls back to readpage if the buffer can't be had.
+ */
+static void yaffs_readpages_batch(struct file *f, struct page **pgs, int n)
+{
+	yaffs_Object *obj = yaffs_DentryToObject(f->f_dentry);
+	yaffs_Device *dev = obj->myDev;
+	loff_t pos = (loff_t)pgs[0]->index << PAGE_CACHE_SHIFT;
+	int len = n << PAGE_CACHE_SHIFT;
+	unsigned char *buf;
+	unsigned char *pg_buf;
+	int shared;
+	int ret;
+	int i;
+
+	buf = kmalloc(len, GFP_KERNEL | __GFP_NOWARN);
+	if (!buf) {
+		for (i = 0; i < n; i++) {
+			yaffs_readpage_unlock(f, pgs[i]);
+			page_cache_release(pgs[i]);
+		}
+		return;
+	}
+
+	T(YAFFS_TRACE_OS, ("yaffs_readpages at %08x, size %08x\n",
+			(unsigned)pos, (unsigned)len));
+
+	shared = yaffs_CanReadShared(dev, pos, len);
+	if (shared)
+		yaffs_GrossLockShared(dev);
+	else
+		yaffs_GrossLock(dev);
+
+	ret = yaffs_ReadDataFromFile(obj, buf, pos, len);
+
+	if (shared)
+		yaffs_GrossUnlockShared(dev);
+	else
+		yaffs_GrossUnlock(dev);
+
+	for (i = 0; i < n; i++) {
+		if (ret >= 0) {
+			pg_buf = kmap(pgs[i]);
+			memcpy(pg_buf, buf + (i << PAGE_CACHE_SHIFT),
+			       PAGE_CACHE_SIZE);
+			flush_dcache_page(pgs[i]);
+			kunmap(pgs[i]);
+			SetPageUptodate(pgs[i]);
+			ClearPageError(pgs[i]);
+		} else {
+			ClearPageUptodate(pgs[i]);
+			SetPageError(pgs[i]);
+		}
+		UnlockPage(pgs[i]);
+		page_cache_release(pgs[i]);
+	}
+
+	kfree(buf);
+}
+
+static int yaffs_readpages(struct file *f, struct address_space *mapping,
+			   struct list_head *pages, unsigned nr_pages)
+{
+	struct page *batch[YAFFS_READPAGES_BATCH];
+	struct page *pg;
+	int nBatch = 0;
+	unsigned i;
+
+	for (i = 0; i < nr_pages; i++) {
+		pg = list_entry(pages->prev, struct page, lru);
+		list_del(&pg->lru);
+
+		if (add_to_page_cache_lru(pg, mapping, pg->index, GFP_KERNEL)) {
+			page_cache_release(pg);
+			continue;
+		}
+
+		if (nBatch > 0 &&
+		    (batch[nBatch - 1]->index + 1 != pg->index ||
+		     nBatch == YAFFS_READPAGES_BATCH)) {
+			yaffs_readpages_batch(f, batch, nBatch);
+			nBatch = 0;
+		}
+		batch[nBatch++] = pg;
+	}
+
+	if (nBatch > 0)
+		yaffs_readpages_batch(f, batch, nBatch);
+
+	return 0;
+}
+#endif
+
 /* writepage inspired by/stolen from smbfs */
 
 #if (LINUX_VERSION_CODE > KERNEL_VERSION(2, 5, 0))
@@ -1746,6 +1999,8 @@ static void yaffs_put_super(struct super_block *sb)
 
 	T(YAFFS_TRACE_OS, ("yaffs_put_super\n"));
 
+	yaffs_BackgroundStop(dev);
+
 	yaffs_GrossLock(dev);
 
 	yaffs_FlushEntireDeviceCache(dev);
@@ -1796,6 +2051,8 @@ typedef struct {
 	int skip_checkpoint_read;
 	int skip_checkpoint_write;
 	int no_cache;
+	int cache_size;
+	int lean_tnodes;
 	int empty_lost_and_found_overridden;
 	int empty_lost_and_found;
 } yaffs_options;
@@ -1828,6 +2085,11 @@ static int yaffs_parse_options(yaffs_options *options, const char *options_str)
 			options->inband_tags = 1;
 		else if (!strcmp(cur_opt, "no-cache"))
 			options->no_cache = 1;
+		else if (!strncmp(cur_opt, "cache-size=", 11))
+			options->cache_size =
+				simple_strtoul(cur_opt + 11, NULL, 0);
+		else if (!strcmp(cur_opt, "lean-tnodes"))
+			options->lean_tnodes = 1;
 		else if (!strcmp(cur_opt, "no-checkpoint-read"))
 			options->skip_checkpoint_read = 1;
 		else if (!strcmp(cur_opt, "no-checkpoint-write"))
@@ -2052,7 +2314,8 @@ static struct super_block *yaffs_internal_read_super(int yaffsVersion,
 	dev->nChunksPerBlock = YAFFS_CHUNKS_PER_BLOCK;
 	dev->totalBytesPerChunk = YAFFS_BYTES_PER_CHUNK;
 	dev->nReservedBlocks = 5;
-	dev->nShortOpCaches = (options.no_cache) ? 0 : 10;
+	dev->nShortOpCaches = (options.no_cache) ? 0 :
+			(options.cache_size > 0) ? options.cache_size : 10;
 	dev->inbandTags = options.inband_tags;
 
 	/* ... and the functions. */
@@ -2061,6 +2324,8 @@ static struct super_block *yaffs_internal_read_super(int yaffsVersion,
 		    nandmtd2_WriteChunkWithTagsToNAND;
 		dev->readChunkWithTagsFromNAND =
 		    nandmtd2_ReadChunkWithTagsFromNAND;
+		dev->readChunksFromNAND = nandmtd2_ReadChunksFromNAND;
+		dev->readBlockTagsFromNAND = nandmtd2_ReadBlockTagsFromNAND;
 		dev->markNANDBlockBad = nandmtd2_MarkNANDBlockBad;
 		dev->queryNANDBlock = nandmtd2_QueryNANDBlock;
 		dev->spareBuffer = YMALLOC(mtd->oobsize);
@@ -2109,13 +2374,20 @@ static struct super_block *yaffs_internal_read_super(int yaffsVersion,
 	dev->wideTnodesDisabled = 1;
 #endif
 
+#ifdef CONFIG_YAFFS_LEAN_TNODES
+	dev->leanTnodes = 1;
+#else
+	dev->leanTnodes = options.lean_tnodes;
+#endif
+
 	dev->skipCheckpointRead = options.skip_checkpoint_read;
 	dev->skipCheckpointWrite = options.skip_checkpoint_write;
 
 	/* we assume this is protected by lock_kernel() in mount/umount */
 	ylist_add_tail(&dev->devList, &yaffs_dev_list);
 
-	init_MUTEX(&dev->grossLock);
+	init_rwsem(&dev->grossLock);
+	mutex_init(&dev->nandLock);
 
 	yaffs_GrossLock(dev);
 
@@ -2151,6 +2423,8 @@ static struct super_block *yaffs_internal_read_super(int yaffsVersion,
 	}
 	sb->s_root = root;
 	sb->s_dirt = !dev->isCheckpointed;
+
+	yaffs_BackgroundStart(dev);
 	T(YAFFS_TRACE_ALWAYS,
 	  ("yaffs_read_super: isCheckpointed %d\n", dev->isCheckpointed));
 
@@ -2255,6 +2529,42 @@ static DECLARE_FSTYPE(yaffs2_fs_type, "yaffs2", yaffs2_read_super,
 
 static struct proc_dir_entry *my_proc_entry;
 
+/* RAM held by the in-memory structures of one mount, as far as we can tell */
+static char *yaffs_dump_metadata(char *buf, yaffs_Device *dev)
+{
+	int nBlocks = dev->internalEndBlock - dev->internalStartBlock + 1;
+	int tnodeSize = (dev->tnodeWidth * YAFFS_NTNODES_LEVEL0) / 8;
+	unsigned tnodeBytes;
+	unsigned objectBytes;
+	unsigned blockBytes;
+	unsigned cacheBytes;
+	unsigned hashBytes;
+
+	if (tnodeSize < sizeof(yaffs_Tnode))
+		tnodeSize = sizeof(yaffs_Tnode);
+
+	tnodeBytes = dev->nTnodesCreated * tnodeSize;
+	objectBytes = dev->nObjectsCreated * sizeof(yaffs_Object);
+	blockBytes = nBlocks * (sizeof(yaffs_BlockInfo) +
+				dev->chunkBitmapStride);
+	cacheBytes = dev->nShortOpCaches *
+			(sizeof(yaffs_ChunkCache) + dev->nDataBytesPerChunk);
+	hashBytes = (dev->objectHash != dev->objectBucket) ?
+			dev->nObjectBuckets * sizeof(yaffs_ObjectBucket) : 0;
+
+	buf += sprintf(buf, "tnodeBytes......... %u\n", tnodeBytes);
+	buf += sprintf(buf, "tnodeRunSavings.... %u\n",
+		       dev->nTnodeRuns * tnodeSize);
+	buf += sprintf(buf, "objectBytes........ %u\n", objectBytes);
+	buf += sprintf(buf, "blockInfoBytes..... %u\n", blockBytes);
+	buf += sprintf(buf, "cacheBytes......... %u\n", cacheBytes);
+	buf += sprintf(buf, "metadataBytes...... %u\n",
+		       tnodeBytes + objectBytes + blockBytes + cacheBytes +
+		       hashBytes);
+
+	return buf;
+}
+
 static char *yaffs_dump_dev(char *buf, yaffs_Device * dev)
 {
 	buf += sprintf(buf, "startBlock......... %d\n", dev->startBlock);
@@ -2268,6 +2578,7 @@ static char *yaffs_dump_dev(char *buf, yaffs_Device * dev)
 	buf += sprintf(buf, "blocksInCheckpoint. %d\n", dev->blocksInCheckpoint);
 	buf += sprintf(buf, "nTnodesCreated..... %d\n", dev->nTnodesCreated);
 	buf += sprintf(buf, "nFreeTnodes........ %d\n", dev->nFreeTnodes);
+	buf += sprintf(buf, "nTnodeRuns......... %d\n", dev->nTnodeRuns);
 	buf += sprintf(buf, "nObjectsCreated.... %d\n", dev->nObjectsCreated);
 	buf += sprintf(buf, "nFreeObjects....... %d\n", dev->nFreeObjects);
 	buf += sprintf(buf, "nFreeChunks........ %d\n", dev->nFreeChunks);
@@ -2278,6 +2589,12 @@ static char *yaffs_dump_dev(char *buf, yaffs_Device * dev)
 	buf += sprintf(buf, "garbageCollections. %d\n", dev->garbageCollections);
 	buf += sprintf(buf, "passiveGCs......... %d\n",
 		    dev->passiveGarbageCollections);
+	buf += sprintf(buf, "foregroundGCs...... %d\n",
+		    dev->foregroundGarbageCollections);
+	buf += sprintf(buf, "backgroundGCs...... %d\n",
+		    dev->backgroundGarbageCollections);
+	buf += sprintf(buf, "backgroundGC....... %d\n", dev->backgroundGC);
+	buf += sprintf(buf, "nCheckpointSaves... %d\n", dev->nCheckpointSaves);
 	buf += sprintf(buf, "nRetriedWrites..... %d\n", dev->nRetriedWrites);
 	buf += sprintf(buf, "nShortOpCaches..... %d\n", dev->nShortOpCaches);
 	buf += sprintf(buf, "nRetireBlocks...... %d\n", dev->nRetiredBlocks);
@@ -2288,11 +2605,15 @@ static char *yaffs_dump_dev(char *buf, yaffs_Device * dev)
 	buf += sprintf(buf, "cacheHits.......... %d\n", dev->cacheHits);
 	buf += sprintf(buf, "nDeletedFiles...... %d\n", dev->nDeletedFiles);
 	buf += sprintf(buf, "nUnlinkedFiles..... %d\n", dev->nUnlinkedFiles);
+	buf += sprintf(buf, "nObjectBuckets..... %d\n", dev->nObjectBuckets);
+	buf += sprintf(buf, "nHashedObjects..... %d\n", dev->nHashedObjects);
 	buf +=
 	    sprintf(buf, "nBackgroudDeletions %d\n", dev->nBackgroundDeletions);
 	buf += sprintf(buf, "useNANDECC......... %d\n", dev->useNANDECC);
 	buf += sprintf(buf, "isYaffs2........... %d\n", dev->isYaffs2);
 	buf += sprintf(buf, "inbandTags......... %d\n", dev->inbandTags);
+	buf += sprintf(buf, "leanTnodes......... %d\n", dev->leanTnodes);
+	buf = yaffs_dump_metadata(buf, dev);
 
 	return buf;
 }
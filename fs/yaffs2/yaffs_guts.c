@@ -91,6 +91,11 @@ static int yaffs_AllocateChunk(yaffs_Device *dev, int useReserve,
 static void yaffs_VerifyFreeChunks(yaffs_Device *dev);
 
 static void yaffs_CheckObjectDetailsLoaded(yaffs_Object *in);
+static void yaffs_DirIndexAdd(yaffs_Object *dir, yaffs_Object *obj);
+static void yaffs_DirIndexRemove(yaffs_Object *dir, yaffs_Object *obj);
+static void yaffs_FreeDirIndex(yaffs_Object *dir);
+static void yaffs_UnlinkFromDirectory(yaffs_Object *obj);
+static void yaffs_LinkToDirectory(yaffs_Object *directory, yaffs_Object *obj);
 
 static void yaffs_VerifyDirectory(yaffs_Object *directory);
 #ifdef YAFFS_PARANOID
@@ -101,6 +106,8 @@ static int yaffs_CheckFileSanity(yaffs_Object *in);
 
 static void yaffs_InvalidateWholeChunkCache(yaffs_Object *in);
 static void yaffs_InvalidateChunkCache(yaffs_Object *object, int chunkId);
+static yaffs_ChunkCache *yaffs_LookupChunkCache(const yaffs_Object *obj,
+						int chunkId);
 
 static void yaffs_InvalidateCheckpoint(yaffs_Device *dev);
 
@@ -841,8 +848,8 @@ static void yaffs_VerifyObjects(yaffs_Device *dev)
 
 	/* Iterate through the objects in each hash entry */
 
-	for (i = 0; i <  YAFFS_NOBJECT_BUCKETS; i++) {
-		ylist_for_each(lh, &dev->objectBucket[i].list) {
+	for (i = 0; i < dev->nObjectBuckets; i++) {
+		ylist_for_each(lh, &dev->objectHash[i].list) {
 			if (lh) {
 				obj = ylist_entry(lh, yaffs_Object, hashLink);
 				yaffs_VerifyObject(obj);
@@ -856,10 +863,10 @@ static void yaffs_VerifyObjects(yaffs_Device *dev)
  *  Simple hash function. Needs to have a reasonable spread
  */
 
-static Y_INLINE int yaffs_HashFunction(int n)
+static Y_INLINE int yaffs_HashFunction(yaffs_Device *dev, int n)
 {
 	n = abs(n);
-	return n % YAFFS_NOBJECT_BUCKETS;
+	return n % dev->nObjectBuckets;
 }
 
 /*
@@ -1126,8 +1133,31 @@ static __u16 yaffs_CalcNameSum(const YCHAR *name)
 	return sum;
 }
 
+/* 32-bit FNV-1a over the whole name, for the directory name index */
+static __u32 yaffs_CalcNameHash(const YCHAR *name)
+{
+	__u32 hash = 2166136261U;
+	const YUCHAR *bname = (const YUCHAR *) name;
+
+	if (bname) {
+		while (*bname) {
+#ifdef CONFIG_YAFFS_CASE_INSENSITIVE
+			hash ^= yaffs_toupper(*bname);
+#else
+			hash ^= *bname;
+#endif
+			hash *= 16777619U;
+			bname++;
+		}
+	}
+	return hash;
+}
+
 static void yaffs_SetObjectName(yaffs_Object *obj, const YCHAR *name)
 {
+	yaffs_Object *parent = obj->parent;
+	int indexed;
+
 #ifdef CONFIG_YAFFS_SHORT_NAMES_IN_RAM
 	memset(obj->shortName, 0, sizeof(YCHAR) * (YAFFS_SHORT_NAME_LENGTH+1));
 	if (name && yaffs_strlen(name) <= YAFFS_SHORT_NAME_LENGTH)
@@ -1135,7 +1165,20 @@ static void yaffs_SetObjectName(yaffs_Object *obj, const YCHAR *name)
 	else
 		obj->shortName[0] = _Y('\0');
 #endif
+
+	/* The directory's name index is keyed on the hash, so re-key it */
+	indexed = parent &&
+		  parent->variantType == YAFFS_OBJECT_TYPE_DIRECTORY &&
+		  parent->variant.directoryVariant.index &&
+		  !ylist_empty(&obj->siblings);
+	if (indexed)
+		yaffs_DirIndexRemove(parent, obj);
+
 	obj->sum = yaffs_CalcNameSum(name);
+	obj->nameHash = yaffs_CalcNameHash(name);
+
+	if (indexed)
+		yaffs_DirIndexAdd(parent, obj);
 }
 
 /*-------------------- TNODES -------------------
@@ -1145,6 +1188,21 @@ static void yaffs_SetObjectName(yaffs_Object *obj, const YCHAR *name)
  * in the tnode.
  */
 
+/*
+ * Tnode runs (memory-lean mode).
+ * A level 0 tnode whose entries are all consecutive chunks, which is what
+ * sequential writes leave behind, can be swapped for a run: a tagged
+ * pointer in the level 1 tnode holding the first chunk. Runs own no memory
+ * and read back through yaffs_GetChunkGroupBase() like any other level 0
+ * tnode. Anything that writes to one expands it back into a real tnode
+ * first. Runs are only used without chunk groups and never sit at the top
+ * of the tree.
+ */
+#define yaffs_TnodeIsRun(tn)	(((unsigned long)(tn)) & 1)
+#define yaffs_TnodeRunBase(tn)	((__u32)(((unsigned long)(tn)) >> 1))
+#define yaffs_MakeTnodeRun(base) \
+	((yaffs_Tnode *)((((unsigned long)(base)) << 1) | 1))
+
 /* yaffs_CreateTnodes creates a bunch more tnodes and
  * adds them to the tnode free list.
  * Don't use this function directly
@@ -1280,7 +1338,10 @@ static yaffs_Tnode *yaffs_GetTnode(yaffs_Device *dev)
 /* FreeTnode frees up a tnode and puts it back on the free list */
 static void yaffs_FreeTnode(yaffs_Device *dev, yaffs_Tnode *tn)
 {
-	if (tn) {
+	if (tn && yaffs_TnodeIsRun(tn)) {
+		/* Nothing to give back */
+		dev->nTnodeRuns--;
+	} else if (tn) {
 #ifdef CONFIG_YAFFS_TNODE_LIST_DEBUG
 		if (tn->internal[YAFFS_NTNODES_INTERNAL] != 0) {
 			/* Hoosterman, this thing looks like it is already in the list */
@@ -1320,6 +1381,7 @@ static void yaffs_InitialiseTnodes(yaffs_Device *dev)
 	dev->freeTnodes = NULL;
 	dev->nFreeTnodes = 0;
 	dev->nTnodesCreated = 0;
+	dev->nTnodeRuns = 0;
 }
 
 
@@ -1332,6 +1394,13 @@ void yaffs_PutLevel0Tnode(yaffs_Device *dev, yaffs_Tnode *tn, unsigned pos,
 	__u32 wordInMap;
 	__u32 mask;
 
+	if (yaffs_TnodeIsRun(tn)) {
+		T(YAFFS_TRACE_ERROR,
+		  (TSTR("yaffs: attempt to write to a tnode run" TENDSTR)));
+		YBUG();
+		return;
+	}
+
 	pos &= YAFFS_TNODES_LEVEL0_MASK;
 	val >>= dev->chunkGroupBits;
 
@@ -1364,6 +1433,9 @@ static __u32 yaffs_GetChunkGroupBase(yaffs_Device *dev, yaffs_Tnode *tn,
 
 	pos &= YAFFS_TNODES_LEVEL0_MASK;
 
+	if (yaffs_TnodeIsRun(tn))
+		return yaffs_TnodeRunBase(tn) + pos;
+
 	bitInMap = pos * dev->tnodeWidth;
 	wordInMap = bitInMap / 32;
 	bitInWord = bitInMap & (32 - 1);
@@ -1382,6 +1454,22 @@ static __u32 yaffs_GetChunkGroupBase(yaffs_Device *dev, yaffs_Tnode *tn,
 	return val;
 }
 
+/* Turn a run back into a real level 0 tnode so that it can be written to */
+static yaffs_Tnode *yaffs_ExpandTnodeRun(yaffs_Device *dev, yaffs_Tnode *run)
+{
+	yaffs_Tnode *tn = yaffs_GetTnode(dev);
+	__u32 base = yaffs_TnodeRunBase(run);
+	int i;
+
+	if (tn) {
+		for (i = 0; i < YAFFS_NTNODES_LEVEL0; i++)
+			yaffs_PutLevel0Tnode(dev, tn, i, base + i);
+		dev->nTnodeRuns--;
+	}
+
+	return tn;
+}
+
 /* ------------------- End of individual tnode manipulation -----------------*/
 
 /* ---------Functions to manipulate the look-up tree (made up of tnodes) ------
@@ -1518,6 +1606,15 @@ static yaffs_Tnode *yaffs_AddOrFindLevel0Tnode(yaffs_Device *dev,
 				} else if (!tn->internal[x]) {
 					/* Don't have one, none passed in */
 					tn->internal[x] = yaffs_GetTnode(dev);
+				} else if (yaffs_TnodeIsRun(tn->internal[x])) {
+					/* About to be written, so expand it */
+					yaffs_Tnode *full;
+
+					full = yaffs_ExpandTnodeRun(dev,
+							tn->internal[x]);
+					if (!full)
+						return NULL;
+					tn->internal[x] = full;
 				}
 			}
 
@@ -1535,6 +1632,47 @@ static yaffs_Tnode *yaffs_AddOrFindLevel0Tnode(yaffs_Device *dev,
 	return tn;
 }
 
+/* Replace the level 0 tnode holding chunkId with a run if we can */
+static void yaffs_CompactLevel0Tnode(yaffs_Device *dev,
+				yaffs_FileStructure *fStruct,
+				__u32 chunkId)
+{
+	yaffs_Tnode *tn = fStruct->top;
+	yaffs_Tnode **slot = NULL;
+	int level = fStruct->topLevel;
+	__u32 base;
+	int i;
+
+	if (!dev->leanTnodes || dev->chunkGroupBits || level < 1)
+		return;
+
+	while (level > 0 && tn) {
+		slot = &tn->internal[(chunkId >>
+			(YAFFS_TNODES_LEVEL0_BITS +
+				(level - 1) *
+				YAFFS_TNODES_INTERNAL_BITS)) &
+			YAFFS_TNODES_INTERNAL_MASK];
+		tn = *slot;
+		level--;
+	}
+
+	if (!tn || yaffs_TnodeIsRun(tn))
+		return;
+
+	base = yaffs_GetChunkGroupBase(dev, tn, 0);
+	if (!base)
+		return;
+
+	for (i = 1; i < YAFFS_NTNODES_LEVEL0; i++) {
+		if (yaffs_GetChunkGroupBase(dev, tn, i) != base + i)
+			return;
+	}
+
+	yaffs_FreeTnode(dev, tn);
+	*slot = yaffs_MakeTnodeRun(base);
+	dev->nTnodeRuns++;
+}
+
 static int yaffs_FindChunkInGroup(yaffs_Device *dev, int theChunk,
 				yaffs_ExtendedTags *tags, int objectId,
 				int chunkInInode)
@@ -1610,6 +1748,25 @@ static int yaffs_DeleteWorker(yaffs_Object *in, yaffs_Tnode *tn, __u32 level,
 				}
 			}
 			return (allDone) ? 1 : 0;
+		} else if (level == 0 && yaffs_TnodeIsRun(tn)) {
+			/* A run goes in one go, even if that overshoots the limit */
+			for (i = 0; i < YAFFS_NTNODES_LEVEL0; i++) {
+				chunkInInode = (chunkOffset <<
+					YAFFS_TNODES_LEVEL0_BITS) + i;
+				foundChunk =
+					yaffs_FindChunkInGroup(dev,
+						yaffs_GetChunkGroupBase(dev, tn, i),
+						&tags, in->objectId,
+						chunkInInode);
+				if (foundChunk > 0) {
+					yaffs_DeleteChunk(dev, foundChunk, 1,
+							  __LINE__);
+					in->nDataChunks--;
+				}
+			}
+			if (limit)
+				*limit = *limit - YAFFS_NTNODES_LEVEL0;
+			return 1;
 		} else if (level == 0) {
 			int hitLimit = 0;
 
@@ -1708,6 +1865,11 @@ static int yaffs_SoftDeleteWorker(yaffs_Object *in, yaffs_Tnode *tn,
 				}
 			}
 			return (allDone) ? 1 : 0;
+		} else if (level == 0 && yaffs_TnodeIsRun(tn)) {
+			for (i = 0; i < YAFFS_NTNODES_LEVEL0; i++)
+				yaffs_SoftDeleteChunk(dev,
+					yaffs_GetChunkGroupBase(dev, tn, i));
+			return 1;
 		} else if (level == 0) {
 
 			for (i = YAFFS_NTNODES_LEVEL0 - 1; i >= 0; i--) {
@@ -1772,7 +1934,8 @@ static yaffs_Tnode *yaffs_PruneWorker(yaffs_Device *dev, yaffs_Tnode *tn,
 	int i;
 	int hasData;
 
-	if (tn) {
+	/* Runs always point at data */
+	if (tn && !yaffs_TnodeIsRun(tn)) {
 		hasData = 0;
 
 		for (i = 0; i < YAFFS_NTNODES_INTERNAL; i++) {
@@ -1828,7 +1991,8 @@ static int yaffs_PruneFileStructure(yaffs_Device *dev,
 					hasData++;
 			}
 
-			if (!hasData) {
+			/* A run can't become the top of the tree */
+			if (!hasData && !yaffs_TnodeIsRun(tn->internal[0])) {
 				fStruct->top = tn->internal[0];
 				fStruct->topLevel--;
 				yaffs_FreeTnode(dev, tn);
@@ -1924,10 +2088,8 @@ static yaffs_Object *yaffs_AllocateEmptyObject(yaffs_Device *dev)
 
 
 		/* Now make the directory sane */
-		if (dev->rootDir) {
-			tn->parent = dev->rootDir;
-			ylist_add(&(tn->siblings), &dev->rootDir->variant.directoryVariant.children);
-		}
+		if (dev->rootDir)
+			yaffs_LinkToDirectory(dev->rootDir, tn);
 
 		/* Add it to the lost and found directory.
 		 * NB Can't put root or lostNFound in lostNFound so
@@ -1973,8 +2135,9 @@ static void yaffs_UnhashObject(yaffs_Object *tn)
 	/* If it is still linked into the bucket list, free from the list */
 	if (!ylist_empty(&tn->hashLink)) {
 		ylist_del_init(&tn->hashLink);
-		bucket = yaffs_HashFunction(tn->objectId);
-		dev->objectBucket[bucket].count--;
+		bucket = yaffs_HashFunction(dev, tn->objectId);
+		dev->objectHash[bucket].count--;
+		dev->nHashedObjects--;
 	}
 }
 
@@ -1992,6 +2155,9 @@ static void yaffs_FreeObject(yaffs_Object *tn)
 	if (!ylist_empty(&tn->siblings))
 		YBUG();
 
+	if (tn->variantType == YAFFS_OBJECT_TYPE_DIRECTORY)
+		yaffs_FreeDirIndex(tn);
+
 
 #ifdef __KERNEL__
 	if (tn->myInode) {
@@ -2031,6 +2197,18 @@ static void yaffs_DeinitialiseObjects(yaffs_Device *dev)
 	/* Free the list of allocated Objects */
 
 	yaffs_ObjectList *tmp;
+	struct ylist_head *lh;
+	yaffs_Object *obj;
+	int i;
+
+	/* ...and any directory name indexes hanging off them */
+	for (i = 0; dev->objectHash && i < dev->nObjectBuckets; i++) {
+		ylist_for_each(lh, &dev->objectHash[i].list) {
+			obj = ylist_entry(lh, yaffs_Object, hashLink);
+			if (obj->variantType == YAFFS_OBJECT_TYPE_DIRECTORY)
+				yaffs_FreeDirIndex(obj);
+		}
+	}
 
 	while (dev->allocatedObjectList) {
 		tmp = dev->allocatedObjectList->next;
@@ -2042,6 +2220,10 @@ static void yaffs_DeinitialiseObjects(yaffs_Device *dev)
 
 	dev->freeObjects = NULL;
 	dev->nFreeObjects = 0;
+
+	if (dev->objectHash && dev->objectHash != dev->objectBucket)
+		YFREE_ALT(dev->objectHash);
+	dev->objectHash = NULL;
 }
 
 static void yaffs_InitialiseObjects(yaffs_Device *dev)
@@ -2052,12 +2234,62 @@ static void yaffs_InitialiseObjects(yaffs_Device *dev)
 	dev->freeObjects = NULL;
 	dev->nFreeObjects = 0;
 
+	dev->objectHash = dev->objectBucket;
+	dev->nObjectBuckets = YAFFS_NOBJECT_BUCKETS;
+	dev->nHashedObjects = 0;
+
 	for (i = 0; i < YAFFS_NOBJECT_BUCKETS; i++) {
 		YINIT_LIST_HEAD(&dev->objectBucket[i].list);
 		dev->objectBucket[i].count = 0;
 	}
 }
 
+/*
+ * Double the object hash when the buckets get long. Object ids are
+ * handed out per bucket so the ids in use stay spread over the bigger
+ * table. If the memory isn't there we just carry on with the old one.
+ */
+static void yaffs_GrowObjectHash(yaffs_Device *dev)
+{
+	yaffs_ObjectBucket *oldHash = dev->objectHash;
+	int oldBuckets = dev->nObjectBuckets;
+	yaffs_ObjectBucket *newHash;
+	struct ylist_head *lh;
+	struct ylist_head *n;
+	yaffs_Object *obj;
+	int bucket;
+	int i;
+
+	newHash = YMALLOC_ALT(2 * oldBuckets * sizeof(yaffs_ObjectBucket));
+	if (!newHash)
+		return;
+
+	for (i = 0; i < 2 * oldBuckets; i++) {
+		YINIT_LIST_HEAD(&newHash[i].list);
+		newHash[i].count = 0;
+	}
+
+	dev->objectHash = newHash;
+	dev->nObjectBuckets = 2 * oldBuckets;
+
+	for (i = 0; i < oldBuckets; i++) {
+		ylist_for_each_safe(lh, n, &oldHash[i].list) {
+			obj = ylist_entry(lh, yaffs_Object, hashLink);
+			bucket = yaffs_HashFunction(dev, obj->objectId);
+			ylist_del(lh);
+			ylist_add(lh, &newHash[bucket].list);
+			newHash[bucket].count++;
+		}
+	}
+
+	if (oldHash != dev->objectBucket)
+		YFREE_ALT(oldHash);
+
+	T(YAFFS_TRACE_OS,
+	  (TSTR("yaffs: object hash grown to %d buckets" TENDSTR),
+	   dev->nObjectBuckets));
+}
+
 static int yaffs_FindNiceObjectBucket(yaffs_Device *dev)
 {
 	static int x;
@@ -2069,9 +2301,9 @@ static int yaffs_FindNiceObjectBucket(yaffs_Device *dev)
 
 	for (i = 0; i < 10 && lowest > 0; i++) {
 		x++;
-		x %= YAFFS_NOBJECT_BUCKETS;
-		if (dev->objectBucket[x].count < lowest) {
-			lowest = dev->objectBucket[x].count;
+		x %= dev->nObjectBuckets;
+		if (dev->objectHash[x].count < lowest) {
+			lowest = dev->objectHash[x].count;
 			l = x;
 		}
 
@@ -2083,9 +2315,9 @@ static int yaffs_FindNiceObjectBucket(yaffs_Device *dev)
 
 	for (i = 0; i < 10 && lowest > 3; i++) {
 		x++;
-		x %= YAFFS_NOBJECT_BUCKETS;
-		if (dev->objectBucket[x].count < lowest) {
-			lowest = dev->objectBucket[x].count;
+		x %= dev->nObjectBuckets;
+		if (dev->objectHash[x].count < lowest) {
+			lowest = dev->objectHash[x].count;
 			l = x;
 		}
 
@@ -2111,9 +2343,9 @@ static int yaffs_CreateNewObjectNumber(yaffs_Device *dev)
 
 	while (!found) {
 		found = 1;
-		n += YAFFS_NOBJECT_BUCKETS;
-		if (1 || dev->objectBucket[bucket].count > 0) {
-			ylist_for_each(i, &dev->objectBucket[bucket].list) {
+		n += dev->nObjectBuckets;
+		if (1 || dev->objectHash[bucket].count > 0) {
+			ylist_for_each(i, &dev->objectHash[bucket].list) {
 				/* If there is already one in the list */
 				if (i && ylist_entry(i, yaffs_Object,
 						hashLink)->objectId == n) {
@@ -2128,20 +2360,26 @@ static int yaffs_CreateNewObjectNumber(yaffs_Device *dev)
 
 static void yaffs_HashObject(yaffs_Object *in)
 {
-	int bucket = yaffs_HashFunction(in->objectId);
 	yaffs_Device *dev = in->myDev;
+	int bucket;
 
-	ylist_add(&in->hashLink, &dev->objectBucket[bucket].list);
-	dev->objectBucket[bucket].count++;
+	if (dev->nHashedObjects >= YAFFS_OBJECT_BUCKET_LOAD * dev->nObjectBuckets &&
+	    dev->nObjectBuckets < YAFFS_MAX_OBJECT_BUCKETS)
+		yaffs_GrowObjectHash(dev);
+
+	bucket = yaffs_HashFunction(dev, in->objectId);
+	ylist_add(&in->hashLink, &dev->objectHash[bucket].list);
+	dev->objectHash[bucket].count++;
+	dev->nHashedObjects++;
 }
 
 yaffs_Object *yaffs_FindObjectByNumber(yaffs_Device *dev, __u32 number)
 {
-	int bucket = yaffs_HashFunction(number);
+	int bucket = yaffs_HashFunction(dev, number);
 	struct ylist_head *i;
 	yaffs_Object *in;
 
-	ylist_for_each(i, &dev->objectBucket[bucket].list) {
+	ylist_for_each(i, &dev->objectHash[bucket].list) {
 		/* Look if it is in the list */
 		if (i) {
 			in = ylist_entry(i, yaffs_Object, hashLink);
@@ -2844,7 +3082,7 @@ static int yaffs_CalcCheckpointBlocksRequired(yaffs_Device *dev)
 		nBytes += devBlocks * sizeof(yaffs_BlockInfo);
 		nBytes += devBlocks * dev->chunkBitmapStride;
 		nBytes += (sizeof(yaffs_CheckpointObject) + sizeof(__u32)) * (dev->nObjectsCreated - dev->nFreeObjects);
-		nBytes += (tnodeSize + sizeof(__u32)) * (dev->nTnodesCreated - dev->nFreeTnodes);
+		nBytes += (tnodeSize + sizeof(__u32)) * (dev->nTnodesCreated - dev->nFreeTnodes + dev->nTnodeRuns);
 		nBytes += sizeof(yaffs_CheckpointValidity);
 		nBytes += sizeof(__u32); /* checksum*/
 
@@ -3204,8 +3442,12 @@ static int yaffs_GarbageCollectBlock(yaffs_Device *dev, int block,
  *
  * The idea is to help clear out space in a more spread-out manner.
  * Dunno if it really does anything useful.
+ *
+ * When the OS layer runs a background collector (dev->backgroundGC) the
+ * foreground callers only do aggressive gc; the leisurely work is left to
+ * the background thread so that it doesn't land on the write path.
  */
-static int yaffs_CheckGarbageCollection(yaffs_Device *dev)
+static int yaffs_CheckGarbageCollection(yaffs_Device *dev, int background)
 {
 	int block;
 	int aggressive;
@@ -3238,6 +3480,9 @@ static int yaffs_CheckGarbageCollection(yaffs_Device *dev)
 			aggressive = 0;
 		}
 
+		if (!aggressive && !background && dev->backgroundGC)
+			return YAFFS_OK;
+
 		if (dev->gcBlock <= 0) {
 			dev->gcBlock = yaffs_FindBlockForGarbageCollection(dev, aggressive);
 			dev->gcChunk = 0;
@@ -3249,11 +3494,15 @@ static int yaffs_CheckGarbageCollection(yaffs_Device *dev)
 			dev->garbageCollections++;
 			if (!aggressive)
 				dev->passiveGarbageCollections++;
+			if (background)
+				dev->backgroundGarbageCollections++;
+			else
+				dev->foregroundGarbageCollections++;
 
 			T(YAFFS_TRACE_GC,
 			  (TSTR
-			   ("yaffs: GC erasedBlocks %d aggressive %d" TENDSTR),
-			   dev->nErasedBlocks, aggressive));
+			   ("yaffs: GC erasedBlocks %d aggressive %d background %d"
+			    TENDSTR), dev->nErasedBlocks, aggressive, background));
 
 			gcOk = yaffs_GarbageCollectBlock(dev, block, aggressive);
 		}
@@ -3271,6 +3520,20 @@ static int yaffs_CheckGarbageCollection(yaffs_Device *dev)
 	return aggressive ? gcOk : YAFFS_OK;
 }
 
+/*
+ * Called by the OS layer's background thread with the gross lock held.
+ * Returns 1 if some collection work was done, 0 if there was nothing
+ * worth collecting.
+ */
+int yaffs_BackgroundGarbageCollect(yaffs_Device *dev)
+{
+	int before = dev->backgroundGarbageCollections;
+
+	yaffs_CheckGarbageCollection(dev, 1);
+
+	return dev->backgroundGarbageCollections != before;
+}
+
 /*-------------------------  TAGS --------------------------------*/
 
 static int yaffs_TagsMatch(const yaffs_ExtendedTags *tags, int objectId,
@@ -3339,7 +3602,17 @@ static int yaffs_FindAndDeleteChunkInFile(yaffs_Object *in, int chunkInInode,
 					   chunkInInode);
 
 		/* Delete the entry in the filestructure (if found) */
-		if (retVal != -1)
+		if (retVal != -1 && yaffs_TnodeIsRun(tn))
+			tn = yaffs_AddOrFindLevel0Tnode(dev,
+						&in->variant.fileVariant,
+						chunkInInode, NULL);
+
+		if (retVal != -1 && !tn) {
+			T(YAFFS_TRACE_ERROR,
+			  (TSTR("yaffs: no tnode to expand run for chunk %d"
+				TENDSTR), chunkInInode));
+			retVal = -1;
+		} else if (retVal != -1)
 			yaffs_PutLevel0Tnode(dev, tn, chunkInInode, 0);
 	}
 
@@ -3524,6 +3797,8 @@ static int yaffs_PutChunkIntoFile(yaffs_Object *in, int chunkInInode,
 
 	yaffs_PutLevel0Tnode(dev, tn, chunkInInode, chunkInNAND);
 
+	yaffs_CompactLevel0Tnode(dev, &in->variant.fileVariant, chunkInInode);
+
 	return YAFFS_OK;
 }
 
@@ -3546,6 +3821,37 @@ static int yaffs_ReadChunkDataFromObject(yaffs_Object *in, int chunkInInode,
 
 }
 
+/*
+ * Read whole chunks starting at chunkInInode into buffer, taking as many
+ * (up to maxChunks) as sit in consecutive pages of the same block and are
+ * not in the short op cache, so that they can be read in one NAND request.
+ * Files written sequentially are mostly laid out like that.
+ * Returns the number of chunks read.
+ */
+static int yaffs_ReadChunkRunFromObject(yaffs_Object *in, int chunkInInode,
+					int maxChunks, __u8 *buffer)
+{
+	yaffs_Device *dev = in->myDev;
+	int chunkInNAND = yaffs_FindChunkInFile(in, chunkInInode, NULL);
+	int n = 1;
+
+	if (chunkInNAND < 0) {
+		yaffs_ReadChunkDataFromObject(in, chunkInInode, buffer);
+		return 1;
+	}
+
+	while (n < maxChunks &&
+	       (chunkInNAND + n) % dev->nChunksPerBlock != 0 &&
+	       !yaffs_LookupChunkCache(in, chunkInInode + n) &&
+	       yaffs_FindChunkInFile(in, chunkInInode + n, NULL) ==
+			chunkInNAND + n)
+		n++;
+
+	yaffs_ReadChunksFromNAND(dev, chunkInNAND, n, buffer);
+
+	return n;
+}
+
 void yaffs_DeleteChunk(yaffs_Device *dev, int chunkId, int markNAND, int lyn)
 {
 	int block;
@@ -3625,7 +3931,7 @@ static int yaffs_WriteChunkDataToObject(yaffs_Object *in, int chunkInInode,
 
 	yaffs_Device *dev = in->myDev;
 
-	yaffs_CheckGarbageCollection(dev);
+	yaffs_CheckGarbageCollection(dev, 0);
 
 	/* Get the previous chunk at this location in the file if it exists */
 	prevChunkId = yaffs_FindChunkInFile(in, chunkInInode, &prevTags);
@@ -3692,7 +3998,7 @@ int yaffs_UpdateObjectHeader(yaffs_Object *in, const YCHAR *name, int force,
 		in == dev->rootDir || /* The rootDir should also be saved */
 		force) {
 
-		yaffs_CheckGarbageCollection(dev);
+		yaffs_CheckGarbageCollection(dev, 0);
 		yaffs_CheckObjectDetailsLoaded(in);
 
 		buffer = yaffs_GetTempBuffer(in->myDev, __LINE__);
@@ -3838,10 +4144,31 @@ int yaffs_UpdateObjectHeader(yaffs_Object *in, const YCHAR *name, int force,
  *   In Linux, the page cache provides read buffering aand the short op cache provides write
  *   buffering.
  *
- *   There are a limited number (~10) of cache chunks per device so that we don't
- *   need a very intelligent search.
+ *   The number of cache chunks is set per device (~10 by default, more for
+ *   workloads with lots of small records). Entries are found through a hash on
+ *   object and chunk id and replaced from an LRU list. Lookups and hits only
+ *   stamp lastUse, so they are safe under a shared device lock; the list is
+ *   put in order lazily when an entry has to be replaced.
  */
 
+static struct ylist_head *yaffs_ChunkCacheBucket(yaffs_Device *dev,
+						 const yaffs_Object *obj,
+						 int chunkId)
+{
+	return &dev->srCacheHash[(obj->objectId * 31 + chunkId) &
+				 dev->srCacheHashMask];
+}
+
+/* Unhash an entry and put it at the free end of the LRU list */
+static void yaffs_FreeChunkCache(yaffs_Device *dev, yaffs_ChunkCache *cache)
+{
+	cache->object = NULL;
+	cache->dirty = 0;
+	ylist_del_init(&cache->hashLink);
+	ylist_del(&cache->lruLink);
+	ylist_add(&cache->lruLink, &dev->srCacheLru);
+}
+
 static int yaffs_ObjectHasCachedWriteData(yaffs_Object *obj)
 {
 	yaffs_Device *dev = obj->myDev;
@@ -3895,8 +4222,7 @@ static void yaffs_FlushFilesChunkCache(yaffs_Object *obj)
 								 cache->data,
 								 cache->nBytes,
 								 1);
-				cache->dirty = 0;
-				cache->object = NULL;
+				yaffs_FreeChunkCache(dev, cache);
 			}
 
 		} while (cache && chunkWritten > 0);
@@ -3942,94 +4268,110 @@ void yaffs_FlushEntireDeviceCache(yaffs_Device *dev)
 
 
 /* Grab us a cache chunk for use.
- * First look for an empty one.
- * Then look for the least recently used non-dirty one.
- * Then look for the least recently used dirty one...., flush and look again.
+ * First look for an empty one (they are kept at the head of the LRU list).
+ * Then take the least recently used one, giving anything that has been used
+ * since it was queued another go at the tail. If that one is dirty, flush
+ * its object, which writes all of the object's dirty chunks out in order, and
+ * look again.
  */
 static yaffs_ChunkCache *yaffs_GrabChunkCacheWorker(yaffs_Device *dev)
 {
-	int i;
+	yaffs_ChunkCache *cache;
 
 	if (dev->nShortOpCaches > 0) {
-		for (i = 0; i < dev->nShortOpCaches; i++) {
-			if (!dev->srCache[i].object)
-				return &dev->srCache[i];
-		}
+		cache = ylist_entry(dev->srCacheLru.next, yaffs_ChunkCache,
+				    lruLink);
+		if (!cache->object)
+			return cache;
 	}
 
 	return NULL;
 }
 
-static yaffs_ChunkCache *yaffs_GrabChunkCache(yaffs_Device *dev)
+static yaffs_ChunkCache *yaffs_GrabChunkCache(yaffs_Device *dev,
+					      yaffs_Object *obj, int chunkId)
 {
 	yaffs_ChunkCache *cache;
-	yaffs_Object *theObj;
-	int usage;
 	int i;
-	int pushout;
-
-	if (dev->nShortOpCaches > 0) {
-		/* Try find a non-dirty one... */
 
-		cache = yaffs_GrabChunkCacheWorker(dev);
+	if (dev->nShortOpCaches <= 0)
+		return NULL;
 
-		if (!cache) {
-			/* They were all dirty, find the last recently used object and flush
-			 * its cache, then  find again.
-			 * NB what's here is not very accurate, we actually flush the object
-			 * the last recently used page.
-			 */
+	cache = yaffs_GrabChunkCacheWorker(dev);
 
-			/* With locking we can't assume we can use entry zero */
+	if (!cache) {
+		for (i = 0; i < 2 * dev->nShortOpCaches; i++) {
+			cache = ylist_entry(dev->srCacheLru.next,
+					    yaffs_ChunkCache, lruLink);
+			if (!cache->locked && cache->lastUse == cache->lruUse)
+				break;
 
-			theObj = NULL;
-			usage = -1;
+			cache->lruUse = cache->lastUse;
+			ylist_del(&cache->lruLink);
+			ylist_add_tail(&cache->lruLink, &dev->srCacheLru);
 			cache = NULL;
-			pushout = -1;
+		}
 
-			for (i = 0; i < dev->nShortOpCaches; i++) {
-				if (dev->srCache[i].object &&
-				    !dev->srCache[i].locked &&
-				    (dev->srCache[i].lastUse < usage || !cache)) {
-					usage = dev->srCache[i].lastUse;
-					theObj = dev->srCache[i].object;
-					cache = &dev->srCache[i];
-					pushout = i;
-				}
-			}
+		if (!cache)
+			return NULL;
 
-			if (!cache || cache->dirty) {
-				/* Flush and try again */
-				yaffs_FlushFilesChunkCache(theObj);
-				cache = yaffs_GrabChunkCacheWorker(dev);
-			}
+		if (cache->dirty)
+			yaffs_FlushFilesChunkCache(cache->object);
+		else
+			yaffs_FreeChunkCache(dev, cache);
 
-		}
-		return cache;
-	} else
-		return NULL;
+		cache = yaffs_GrabChunkCacheWorker(dev);
+		if (!cache)
+			return NULL;
+	}
+
+	cache->object = obj;
+	cache->chunkId = chunkId;
+	cache->dirty = 0;
+	cache->locked = 0;
+	cache->nBytes = 0;
+
+	/* yaffs_UseChunkCache() stamps it next; only later uses count */
+	cache->lastUse = cache->lruUse = dev->srLastUse + 1;
 
+	ylist_del(&cache->lruLink);
+	ylist_add_tail(&cache->lruLink, &dev->srCacheLru);
+	ylist_add(&cache->hashLink, yaffs_ChunkCacheBucket(dev, obj, chunkId));
+
+	return cache;
 }
 
-/* Find a cached chunk */
-static yaffs_ChunkCache *yaffs_FindChunkCache(const yaffs_Object *obj,
-					      int chunkId)
+static yaffs_ChunkCache *yaffs_LookupChunkCache(const yaffs_Object *obj,
+						int chunkId)
 {
 	yaffs_Device *dev = obj->myDev;
-	int i;
-	if (dev->nShortOpCaches > 0) {
-		for (i = 0; i < dev->nShortOpCaches; i++) {
-			if (dev->srCache[i].object == obj &&
-			    dev->srCache[i].chunkId == chunkId) {
-				dev->cacheHits++;
+	struct ylist_head *bucket;
+	struct ylist_head *i;
+	yaffs_ChunkCache *cache;
 
-				return &dev->srCache[i];
-			}
+	if (dev->nShortOpCaches > 0) {
+		bucket = yaffs_ChunkCacheBucket(dev, obj, chunkId);
+		ylist_for_each(i, bucket) {
+			cache = ylist_entry(i, yaffs_ChunkCache, hashLink);
+			if (cache->object == obj && cache->chunkId == chunkId)
+				return cache;
 		}
 	}
 	return NULL;
 }
 
+/* Find a cached chunk */
+static yaffs_ChunkCache *yaffs_FindChunkCache(const yaffs_Object *obj,
+					      int chunkId)
+{
+	yaffs_ChunkCache *cache = yaffs_LookupChunkCache(obj, chunkId);
+
+	if (cache)
+		obj->myDev->cacheHits++;
+
+	return cache;
+}
+
 /* Mark the chunk for the least recently used algorithym */
 static void yaffs_UseChunkCache(yaffs_Device *dev, yaffs_ChunkCache *cache,
 				int isAWrite)
@@ -4039,8 +4381,10 @@ static void yaffs_UseChunkCache(yaffs_Device *dev, yaffs_ChunkCache *cache,
 		if (dev->srLastUse < 0 || dev->srLastUse > 100000000) {
 			/* Reset the cache usages */
 			int i;
-			for (i = 1; i < dev->nShortOpCaches; i++)
+			for (i = 0; i < dev->nShortOpCaches; i++) {
 				dev->srCache[i].lastUse = 0;
+				dev->srCache[i].lruUse = 0;
+			}
 
 			dev->srLastUse = 0;
 		}
@@ -4064,7 +4408,7 @@ static void yaffs_InvalidateChunkCache(yaffs_Object *object, int chunkId)
 		yaffs_ChunkCache *cache = yaffs_FindChunkCache(object, chunkId);
 
 		if (cache)
-			cache->object = NULL;
+			yaffs_FreeChunkCache(object->myDev, cache);
 	}
 }
 
@@ -4080,7 +4424,7 @@ static void yaffs_InvalidateWholeChunkCache(yaffs_Object *in)
 		/* Invalidate it. */
 		for (i = 0; i < dev->nShortOpCaches; i++) {
 			if (dev->srCache[i].object == in)
-				dev->srCache[i].object = NULL;
+				yaffs_FreeChunkCache(dev, &dev->srCache[i]);
 		}
 	}
 }
@@ -4316,6 +4660,18 @@ static int yaffs_CheckpointTnodeWorker(yaffs_Object *in, yaffs_Tnode *tn,
 			}
 		} else if (level == 0) {
 			__u32 baseOffset = chunkOffset <<  YAFFS_TNODES_LEVEL0_BITS;
+			__u32 runMap[YAFFS_NTNODES_LEVEL0]; /* room for 32 bit width */
+
+			if (yaffs_TnodeIsRun(tn)) {
+				/* Checkpoint the full form so the format doesn't change */
+				memset(runMap, 0, sizeof(runMap));
+				for (i = 0; i < YAFFS_NTNODES_LEVEL0; i++)
+					yaffs_PutLevel0Tnode(dev,
+						(yaffs_Tnode *)runMap, i,
+						yaffs_GetChunkGroupBase(dev, tn, i));
+				tn = (yaffs_Tnode *)runMap;
+			}
+
 			ok = (yaffs_CheckpointWrite(dev, &baseOffset, sizeof(baseOffset)) == sizeof(baseOffset));
 			if (ok)
 				ok = (yaffs_CheckpointWrite(dev, tn, tnodeSize) == tnodeSize);
@@ -4376,6 +4732,9 @@ static int yaffs_ReadCheckpointTnodes(yaffs_Object *obj)
 							baseChunk,
 							tn) ? 1 : 0;
 
+		if (ok)
+			yaffs_CompactLevel0Tnode(dev, fileStructPtr, baseChunk);
+
 		if (ok)
 			ok = (yaffs_CheckpointRead(dev, &baseChunk, sizeof(baseChunk)) == sizeof(baseChunk));
 
@@ -4402,8 +4761,8 @@ static int yaffs_WriteCheckpointObjects(yaffs_Device *dev)
 	 * dumping them to the checkpointing stream.
 	 */
 
-	for (i = 0; ok &&  i <  YAFFS_NOBJECT_BUCKETS; i++) {
-		ylist_for_each(lh, &dev->objectBucket[i].list) {
+	for (i = 0; ok &&  i < dev->nObjectBuckets; i++) {
+		ylist_for_each(lh, &dev->objectHash[i].list) {
 			if (lh) {
 				obj = ylist_entry(lh, yaffs_Object, hashLink);
 				if (!obj->deferedFree) {
@@ -4548,6 +4907,9 @@ static int yaffs_WriteCheckpointData(yaffs_Device *dev)
 	if (!yaffs_CheckpointClose(dev))
 		ok = 0;
 
+	if (ok)
+		dev->nCheckpointSaves++;
+
 	if (ok)
 		dev->isCheckpointed = 1;
 	else
@@ -4661,6 +5023,24 @@ int yaffs_CheckpointRestore(yaffs_Device *dev)
  * Curve-balls: the first chunk might also be the last chunk.
  */
 
+/*
+ * yaffs_CanReadShared - can yaffs_ReadDataFromFile() serve this read with
+ * the device lock held shared? Whole-chunk reads without inband tags either
+ * hit the cache or go straight to NAND; they never fill or flush a cache
+ * entry, so concurrent readers cannot disturb each other.
+ */
+int yaffs_CanReadShared(yaffs_Device *dev, loff_t offset, int nBytes)
+{
+	int chunk;
+	__u32 start;
+
+	if (dev->inbandTags)
+		return 0;
+
+	yaffs_AddrToChunk(dev, offset, &chunk, &start);
+	return start == 0 && (nBytes % dev->nDataBytesPerChunk) == 0;
+}
+
 int yaffs_ReadDataFromFile(yaffs_Object *in, __u8 *buffer, loff_t offset,
 			int nBytes)
 {
@@ -4697,22 +5077,20 @@ int yaffs_ReadDataFromFile(yaffs_Object *in, __u8 *buffer, loff_t offset,
 		 * else bypass the cache.
 		 */
 		if (cache || nToCopy != dev->nDataBytesPerChunk || dev->inbandTags) {
-			if (dev->nShortOpCaches > 0) {
-
-				/* If we can't find the data in the cache, then load it up. */
-
-				if (!cache) {
-					cache = yaffs_GrabChunkCache(in->myDev);
-					cache->object = in;
-					cache->chunkId = chunk;
-					cache->dirty = 0;
-					cache->locked = 0;
+			/* If we can't find the data in the cache, then load it up.
+			 * The grab can fail when every cache entry is in use, in
+			 * which case we go through a temp buffer instead.
+			 */
+			if (!cache && dev->nShortOpCaches > 0) {
+				cache = yaffs_GrabChunkCache(in->myDev,
+							     in, chunk);
+				if (cache)
 					yaffs_ReadChunkDataFromObject(in, chunk,
 								      cache->
 								      data);
-					cache->nBytes = 0;
-				}
+			}
 
+			if (cache) {
 				yaffs_UseChunkCache(dev, cache, 0);
 
 				cache->locked = 1;
@@ -4738,8 +5116,10 @@ int yaffs_ReadDataFromFile(yaffs_Object *in, __u8 *buffer, loff_t offset,
 
 		} else {
 
-			/* A full chunk. Read directly into the supplied buffer. */
-			yaffs_ReadChunkDataFromObject(in, chunk, buffer);
+			/* Full chunks. Read directly into the supplied buffer. */
+			nToCopy = yaffs_ReadChunkRunFromObject(in, chunk,
+					n / dev->nDataBytesPerChunk, buffer) *
+				  dev->nDataBytesPerChunk;
 
 		}
 
@@ -4832,14 +5212,11 @@ int yaffs_WriteDataToFile(yaffs_Object *in, const __u8 *buffer, loff_t offset,
 				if (!cache
 				    && yaffs_CheckSpaceForAllocation(in->
 								     myDev)) {
-					cache = yaffs_GrabChunkCache(in->myDev);
-					cache->object = in;
-					cache->chunkId = chunk;
-					cache->dirty = 0;
-					cache->locked = 0;
-					yaffs_ReadChunkDataFromObject(in, chunk,
-								      cache->
-								      data);
+					cache = yaffs_GrabChunkCache(in->myDev,
+								     in, chunk);
+					if (cache)
+						yaffs_ReadChunkDataFromObject(in,
+							chunk, cache->data);
 				} else if (cache &&
 					!cache->dirty &&
 					!yaffs_CheckSpaceForAllocation(in->myDev)) {
@@ -4991,7 +5368,7 @@ int yaffs_ResizeFile(yaffs_Object *in, loff_t newSize)
 	yaffs_FlushFilesChunkCache(in);
 	yaffs_InvalidateWholeChunkCache(in);
 
-	yaffs_CheckGarbageCollection(dev);
+	yaffs_CheckGarbageCollection(dev, 0);
 
 	if (in->variantType != YAFFS_OBJECT_TYPE_FILE)
 		return YAFFS_FAIL;
@@ -5274,7 +5651,7 @@ static int yaffs_UnlinkWorker(yaffs_Object *obj)
 		hl = ylist_entry(obj->hardLinks.next, yaffs_Object, hardLinks);
 
 		ylist_del_init(&hl->hardLinks);
-		ylist_del_init(&hl->siblings);
+		yaffs_UnlinkFromDirectory(hl);
 
 		yaffs_GetObjectName(hl, name, YAFFS_MAX_NAME_LENGTH + 1);
 
@@ -5489,8 +5866,8 @@ static void yaffs_FixHangingObjects(yaffs_Device *dev)
 	 * Make sure it is rooted.
 	 */
 
-	for (i = 0; i <  YAFFS_NOBJECT_BUCKETS; i++) {
-		ylist_for_each_safe(lh, n, &dev->objectBucket[i].list) {
+	for (i = 0; i < dev->nObjectBuckets; i++) {
+		ylist_for_each_safe(lh, n, &dev->objectHash[i].list) {
 			if (lh) {
 				obj = ylist_entry(lh, yaffs_Object, hashLink);
 				parent= obj->parent;
@@ -6097,6 +6474,8 @@ static int yaffs_ScanBackwards(yaffs_Device *dev)
 
 	yaffs_BlockIndex *blockIndex = NULL;
 	int altBlockIndex = 0;
+	yaffs_ExtendedTags *blockTags = NULL;
+	int blockTagsValid;
 
 	if (!dev->isYaffs2) {
 		T(YAFFS_TRACE_SCAN,
@@ -6129,6 +6508,11 @@ static int yaffs_ScanBackwards(yaffs_Device *dev)
 
 	chunkData = yaffs_GetTempBuffer(dev, __LINE__);
 
+	/* Tags for a whole block, so each block costs one read rather than
+	 * one per chunk. Without it we just read chunk by chunk.
+	 */
+	blockTags = YMALLOC(dev->nChunksPerBlock * sizeof(yaffs_ExtendedTags));
+
 	/* Scan all the blocks to determine their state */
 	for (blk = dev->internalStartBlock; blk <= dev->internalEndBlock; blk++) {
 		bi = yaffs_GetBlockInfo(dev, blk);
@@ -6244,6 +6628,13 @@ static int yaffs_ScanBackwards(yaffs_Device *dev)
 
 		deleted = 0;
 
+		blockTagsValid = 0;
+		if (blockTags &&
+		    (state == YAFFS_BLOCK_STATE_NEEDS_SCANNING ||
+		     state == YAFFS_BLOCK_STATE_ALLOCATING))
+			blockTagsValid = (yaffs_ReadBlockTagsFromNAND(dev, blk,
+						blockTags) == YAFFS_OK);
+
 		/* For each chunk in each block that needs scanning.... */
 		foundChunksInBlock = 0;
 		for (c = dev->nChunksPerBlock - 1;
@@ -6256,8 +6647,11 @@ static int yaffs_ScanBackwards(yaffs_Device *dev)
 
 			chunk = blk * dev->nChunksPerBlock + c;
 
-			result = yaffs_ReadChunkWithTagsFromNAND(dev, chunk, NULL,
-							&tags);
+			if (blockTagsValid)
+				tags = blockTags[c];
+			else
+				result = yaffs_ReadChunkWithTagsFromNAND(dev,
+							chunk, NULL, &tags);
 
 			/* Let's have a good look at this chunk... */
 
@@ -6711,6 +7105,9 @@ static int yaffs_ScanBackwards(yaffs_Device *dev)
 	else
 		YFREE(blockIndex);
 
+	if (blockTags)
+		YFREE(blockTags);
+
 	/* Ok, we've done all the scanning.
 	 * Fix up the hard link chains.
 	 * We should now have scanned all the objects, now it's time to add these
@@ -6828,6 +7225,160 @@ static void yaffs_UpdateParent(yaffs_Object *obj)
 	yaffs_UpdateObjectHeader(obj,NULL,0,0,0);
 }
 
+/*
+ * Directory name index.
+ * Big directories get a hash table of their children keyed on a hash of
+ * the full name, built the first time they are searched and then kept up
+ * to date as children come and go or get renamed. Each bucket chains its
+ * objects through indexNext, so removal is just an unlink. The table is
+ * rebuilt twice the size when the directory outgrows it.
+ */
+static void yaffs_FreeDirIndex(yaffs_Object *dir)
+{
+	yaffs_DirIndex *idx = dir->variant.directoryVariant.index;
+
+	if (idx) {
+		if (idx->alt)
+			YFREE_ALT(idx);
+		else
+			YFREE(idx);
+		dir->variant.directoryVariant.index = NULL;
+	}
+}
+
+static void yaffs_DirIndexInsert(yaffs_DirIndex *idx, yaffs_Object *obj)
+{
+	int h = obj->nameHash & (idx->size - 1);
+
+	obj->indexNext = idx->bucket[h];
+	idx->bucket[h] = obj;
+}
+
+static void yaffs_BuildDirIndex(yaffs_Object *dir)
+{
+	yaffs_DirectoryStructure *d = &dir->variant.directoryVariant;
+	yaffs_DirIndex *idx;
+	struct ylist_head *i;
+	int size = YAFFS_DIR_INDEX_MIN;
+	int bytes;
+	int alt = 0;
+
+	yaffs_FreeDirIndex(dir);
+
+	if (d->nChildren < YAFFS_DIR_INDEX_MIN)
+		return;
+
+	while (size < d->nChildren)
+		size <<= 1;
+
+	bytes = sizeof(yaffs_DirIndex) + (size - 1) * sizeof(yaffs_Object *);
+	idx = YMALLOC(bytes);
+	if (!idx) {
+		idx = YMALLOC_ALT(bytes);
+		alt = 1;
+	}
+	if (!idx)
+		return;
+
+	memset(idx, 0, bytes);
+	idx->size = size;
+	idx->alt = alt;
+
+	/* Lazily loaded objects only get their name hash when loaded */
+	ylist_for_each(i, &d->children) {
+		yaffs_Object *l = ylist_entry(i, yaffs_Object, siblings);
+
+		yaffs_CheckObjectDetailsLoaded(l);
+		yaffs_DirIndexInsert(idx, l);
+	}
+
+	d->index = idx;
+}
+
+static void yaffs_DirIndexAdd(yaffs_Object *dir, yaffs_Object *obj)
+{
+	yaffs_DirIndex *idx = dir->variant.directoryVariant.index;
+
+	if (!idx)
+		return;
+
+	if (dir->variant.directoryVariant.nChildren > 2 * idx->size)
+		yaffs_BuildDirIndex(dir);	/* obj is already a child */
+	else
+		yaffs_DirIndexInsert(idx, obj);
+}
+
+static void yaffs_DirIndexRemove(yaffs_Object *dir, yaffs_Object *obj)
+{
+	yaffs_DirIndex *idx = dir->variant.directoryVariant.index;
+	yaffs_Object **p;
+
+	if (!idx)
+		return;
+
+	p = &idx->bucket[obj->nameHash & (idx->size - 1)];
+	while (*p) {
+		if (*p == obj) {
+			*p = obj->indexNext;
+			obj->indexNext = NULL;
+			return;
+		}
+		p = &(*p)->indexNext;
+	}
+
+	/* Not filed under its hash, so the index can't be trusted */
+	T(YAFFS_TRACE_ERROR,
+	  (TSTR("yaffs: object %d missing from directory index" TENDSTR),
+	   obj->objectId));
+	yaffs_FreeDirIndex(dir);
+}
+
+static yaffs_Object *yaffs_DirIndexFind(yaffs_Object *dir, const YCHAR *name,
+					__u32 hash)
+{
+	yaffs_DirIndex *idx = dir->variant.directoryVariant.index;
+	YCHAR buffer[YAFFS_MAX_NAME_LENGTH + 1];
+	yaffs_Object *l;
+
+	for (l = idx->bucket[hash & (idx->size - 1)]; l; l = l->indexNext) {
+		if (l->nameHash == hash) {
+			yaffs_GetObjectName(l, buffer,
+					    YAFFS_MAX_NAME_LENGTH + 1);
+			if (yaffs_strncmp(name, buffer, YAFFS_MAX_NAME_LENGTH) == 0)
+				return l;
+		}
+	}
+
+	return NULL;
+}
+
+/* Take obj off its parent's child list, leaving obj->parent alone */
+static void yaffs_UnlinkFromDirectory(yaffs_Object *obj)
+{
+	yaffs_Object *parent = obj->parent;
+
+	if (ylist_empty(&obj->siblings))
+		return;
+
+	ylist_del_init(&obj->siblings);
+
+	if (parent && parent->variantType == YAFFS_OBJECT_TYPE_DIRECTORY) {
+		parent->variant.directoryVariant.nChildren--;
+		yaffs_DirIndexRemove(parent, obj);
+		if (parent->variant.directoryVariant.nChildren <
+		    YAFFS_DIR_INDEX_MIN / 2)
+			yaffs_FreeDirIndex(parent);
+	}
+}
+
+static void yaffs_LinkToDirectory(yaffs_Object *directory, yaffs_Object *obj)
+{
+	ylist_add(&obj->siblings, &directory->variant.directoryVariant.children);
+	directory->variant.directoryVariant.nChildren++;
+	obj->parent = directory;
+	yaffs_DirIndexAdd(directory, obj);
+}
+
 static void yaffs_RemoveObjectFromDirectory(yaffs_Object *obj)
 {
 	yaffs_Device *dev = obj->myDev;
@@ -6842,7 +7393,7 @@ static void yaffs_RemoveObjectFromDirectory(yaffs_Object *obj)
 		dev->removeObjectCallback(obj);
 
 
-	ylist_del_init(&obj->siblings);
+	yaffs_UnlinkFromDirectory(obj);
 	obj->parent = NULL;
 	
 	yaffs_VerifyDirectory(parent);
@@ -6877,10 +7428,12 @@ static void yaffs_AddObjectToDirectory(yaffs_Object *directory,
 
 	yaffs_RemoveObjectFromDirectory(obj);
 
+	/* An indexed directory needs the name hash up front */
+	if (directory->variant.directoryVariant.index)
+		yaffs_CheckObjectDetailsLoaded(obj);
 
 	/* Now add it */
-	ylist_add(&obj->siblings, &directory->variant.directoryVariant.children);
-	obj->parent = directory;
+	yaffs_LinkToDirectory(directory, obj);
 
 	if (directory == obj->myDev->unlinkedDir
 			|| directory == obj->myDev->deletedDir) {
@@ -6923,6 +7476,22 @@ yaffs_Object *yaffs_FindObjectByName(yaffs_Object *directory,
 
 	sum = yaffs_CalcNameSum(name);
 
+	/* Made-up names (lost+found, objNNN) don't match the stored name,
+	 * so those are always searched for the slow way.
+	 */
+	if (yaffs_strcmp(name, YAFFS_LOSTNFOUND_NAME) != 0 &&
+	    yaffs_strncmp(name, YAFFS_LOSTNFOUND_PREFIX,
+			  yaffs_strlen(YAFFS_LOSTNFOUND_PREFIX)) != 0) {
+		if (!directory->variant.directoryVariant.index &&
+		    directory->variant.directoryVariant.nChildren >=
+				YAFFS_DIR_INDEX_MIN)
+			yaffs_BuildDirIndex(directory);
+
+		if (directory->variant.directoryVariant.index)
+			return yaffs_DirIndexFind(directory, name,
+						  yaffs_CalcNameHash(name));
+	}
+
 	ylist_for_each(i, &directory->variant.directoryVariant.children) {
 		if (i) {
 			l = ylist_entry(i, yaffs_Object, siblings);
@@ -7437,29 +8006,48 @@ int yaffs_GutsInitialise(yaffs_Device *dev)
 		init_failed = 1;
 
 	dev->srCache = NULL;
+	dev->srCacheHash = NULL;
 	dev->gcCleanupList = NULL;
 
 
 	if (!init_failed &&
 	    dev->nShortOpCaches > 0) {
 		int i;
+		int nBuckets;
 		void *buf;
-		int srCacheBytes = dev->nShortOpCaches * sizeof(yaffs_ChunkCache);
+		int srCacheBytes;
 
 		if (dev->nShortOpCaches > YAFFS_MAX_SHORT_OP_CACHES)
 			dev->nShortOpCaches = YAFFS_MAX_SHORT_OP_CACHES;
 
+		srCacheBytes = dev->nShortOpCaches * sizeof(yaffs_ChunkCache);
+
+		for (nBuckets = 1; nBuckets < dev->nShortOpCaches; nBuckets <<= 1)
+			;
+		dev->srCacheHashMask = nBuckets - 1;
+		dev->srCacheHash = YMALLOC(nBuckets * sizeof(struct ylist_head));
+		YINIT_LIST_HEAD(&dev->srCacheLru);
+
 		dev->srCache =  YMALLOC(srCacheBytes);
 
 		buf = (__u8 *) dev->srCache;
+		if (!dev->srCacheHash)
+			buf = NULL;
 
 		if (dev->srCache)
 			memset(dev->srCache, 0, srCacheBytes);
 
+		for (i = 0; i < nBuckets && buf; i++)
+			YINIT_LIST_HEAD(&dev->srCacheHash[i]);
+
 		for (i = 0; i < dev->nShortOpCaches && buf; i++) {
 			dev->srCache[i].object = NULL;
 			dev->srCache[i].lastUse = 0;
+			dev->srCache[i].lruUse = 0;
 			dev->srCache[i].dirty = 0;
+			YINIT_LIST_HEAD(&dev->srCache[i].hashLink);
+			ylist_add_tail(&dev->srCache[i].lruLink,
+				       &dev->srCacheLru);
 			dev->srCache[i].data = buf = YMALLOC_DMA(dev->totalBytesPerChunk);
 		}
 		if (!buf)
@@ -7588,6 +8176,11 @@ void yaffs_Deinitialise(yaffs_Device *dev)
 			dev->srCache = NULL;
 		}
 
+		if (dev->srCacheHash) {
+			YFREE(dev->srCacheHash);
+			dev->srCacheHash = NULL;
+		}
+
 		YFREE(dev->gcCleanupList);
 
 		for (i = 0; i < YAFFS_N_TEMP_BUFFERS; i++)
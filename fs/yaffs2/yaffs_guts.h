@@ -58,7 +58,12 @@
 #define YAFFS_ALLOCATION_NTNODES	100
 #define YAFFS_ALLOCATION_NLINKS		100
 
-#define YAFFS_NOBJECT_BUCKETS		256
+#define YAFFS_NOBJECT_BUCKETS		256	/* initial object hash size */
+#define YAFFS_MAX_OBJECT_BUCKETS	16384
+#define YAFFS_OBJECT_BUCKET_LOAD	4	/* grow above this many per bucket */
+
+/* Directories with at least this many entries get a name index */
+#define YAFFS_DIR_INDEX_MIN		32
 
 
 #define YAFFS_OBJECT_SPACE		0x40000
@@ -88,7 +93,7 @@
 
 /* */
 
-#define YAFFS_MAX_SHORT_OP_CACHES	20
+#define YAFFS_MAX_SHORT_OP_CACHES	256
 
 #define YAFFS_N_TEMP_BUFFERS		6
 
@@ -116,6 +121,9 @@ typedef struct {
 	struct yaffs_ObjectStruct *object;
 	int chunkId;
 	int lastUse;
+	int lruUse;		/* lastUse when queued at the tail of the LRU */
+	struct ylist_head hashLink;	/* srCacheHash bucket, if in use */
+	struct ylist_head lruLink;	/* srCacheLru, free entries first */
 	int dirty;
 	int nBytes;		/* Only valid if the cache is dirty */
 	int locked;		/* Can't push out or flush while locked. */
@@ -385,8 +393,17 @@ typedef struct {
 	yaffs_Tnode *top;
 } yaffs_FileStructure;
 
+/* Hash table of a directory's children, keyed on name hash */
+typedef struct {
+	int size;		/* power of 2 */
+	int alt;		/* allocated with YMALLOC_ALT */
+	struct yaffs_ObjectStruct *bucket[1];	/* chained on indexNext */
+} yaffs_DirIndex;
+
 typedef struct {
 	struct ylist_head children;     /* list of child links */
+	int nChildren;
+	yaffs_DirIndex *index;		/* built on lookup, may be NULL */
 } yaffs_DirectoryStructure;
 
 typedef struct {
@@ -427,6 +444,8 @@ struct yaffs_ObjectStruct {
 
 	__u8 serial;		/* serial number of chunk in NAND. Cached here */
 	__u16 sum;		/* sum of the name to speed searching */
+	__u32 nameHash;		/* hash of the name, keys the parent's index */
+	struct yaffs_ObjectStruct *indexNext;	/* parent's index chain */
 
 	struct yaffs_DeviceStruct *myDev;       /* The device I'm on */
 
@@ -586,6 +605,13 @@ struct yaffs_DeviceStruct {
 	int (*readChunkWithTagsFromNAND) (struct yaffs_DeviceStruct *dev,
 					  int chunkInNAND, __u8 *data,
 					  yaffs_ExtendedTags *tags);
+	/* Optional: data of consecutive chunks (no tags) in one request */
+	int (*readChunksFromNAND) (struct yaffs_DeviceStruct *dev,
+				   int chunkInNAND, int nChunks, __u8 *data);
+	/* Optional: tags of all chunks in a block in one go, for scanning */
+	int (*readBlockTagsFromNAND) (struct yaffs_DeviceStruct *dev,
+				      int blockInNAND,
+				      yaffs_ExtendedTags *tags);
 	int (*markNANDBlockBad) (struct yaffs_DeviceStruct *dev, int blockNo);
 	int (*queryNANDBlock) (struct yaffs_DeviceStruct *dev, int blockNo,
 			       yaffs_BlockState *state, __u32 *sequenceNumber);
@@ -603,6 +629,7 @@ struct yaffs_DeviceStruct {
 	void (*markSuperBlockDirty)(void *superblock);
 
 	int wideTnodesDisabled; /* Set to disable wide tnodes */
+	int leanTnodes;		/* Fold sequential level 0 tnodes into runs */
 
 	YCHAR *pathDividers;	/* String of legal path dividers */
 
@@ -634,11 +661,19 @@ struct yaffs_DeviceStruct {
 #ifdef __KERNEL__
 
 	struct semaphore sem;	/* Semaphore for waiting on erasure.*/
-	struct semaphore grossLock;	/* Gross locking semaphore */
+	struct rw_semaphore grossLock;	/* Held shared by reads that only look
+					 * at the tree and the cache, else
+					 * exclusive.
+					 */
+	struct mutex nandLock;		/* Serialises shared readers' NAND
+					 * access and spareBuffer use.
+					 */
 	__u8 *spareBuffer;	/* For mtdif2 use. Don't know the size of the buffer
 				 * at compile time so we have to allocate it.
 				 */
 	void (*putSuperFunc) (struct super_block *sb);
+	struct task_struct *bgThread;	/* Background garbage collector */
+	unsigned long lastActivity;	/* jiffies at last gross lock */
 #endif
 
 	int isMounted;
@@ -688,6 +723,7 @@ struct yaffs_DeviceStruct {
 	int nTnodesCreated;
 	yaffs_Tnode *freeTnodes;
 	int nFreeTnodes;
+	int nTnodeRuns;		/* Level 0 tnodes currently held as runs */
 	yaffs_TnodeList *allocatedTnodeList;
 
 	int isDoingGC;
@@ -703,6 +739,9 @@ struct yaffs_DeviceStruct {
 	yaffs_ObjectList *allocatedObjectList;
 
 	yaffs_ObjectBucket objectBucket[YAFFS_NOBJECT_BUCKETS];
+	yaffs_ObjectBucket *objectHash;	/* objectBucket, or a bigger table */
+	int nObjectBuckets;
+	int nHashedObjects;
 
 	int nFreeChunks;
 
@@ -710,6 +749,7 @@ struct yaffs_DeviceStruct {
 
 	__u32 *gcCleanupList;	/* objects to delete at the end of a GC. */
 	int nonAggressiveSkip;	/* GC state/mode */
+	int backgroundGC;	/* Passive gc is done by a background thread */
 
 	/* Statistcs */
 	int nPageWrites;
@@ -719,6 +759,9 @@ struct yaffs_DeviceStruct {
 	int nGCCopies;
 	int garbageCollections;
 	int passiveGarbageCollections;
+	int nCheckpointSaves;
+	int foregroundGarbageCollections;
+	int backgroundGarbageCollections;
 	int nRetriedWrites;
 	int nRetiredBlocks;
 	int eccFixed;
@@ -743,6 +786,9 @@ struct yaffs_DeviceStruct {
 	int doingBufferedBlockRewrite;
 
 	yaffs_ChunkCache *srCache;
+	struct ylist_head *srCacheHash;	/* by object and chunkId */
+	int srCacheHashMask;
+	struct ylist_head srCacheLru;	/* least recently used first */
 	int srLastUse;
 
 	int cacheHits;
@@ -834,6 +880,7 @@ int yaffs_SetAttributes(yaffs_Object *obj, struct iattr *attr);
 int yaffs_GetAttributes(yaffs_Object *obj, struct iattr *attr);
 
 /* File operations */
+int yaffs_CanReadShared(yaffs_Device *dev, loff_t offset, int nBytes);
 int yaffs_ReadDataFromFile(yaffs_Object *obj, __u8 *buffer, loff_t offset,
 				int nBytes);
 int yaffs_WriteDataToFile(yaffs_Object *obj, const __u8 *buffer, loff_t offset,
@@ -850,6 +897,9 @@ void yaffs_FlushEntireDeviceCache(yaffs_Device *dev);
 int yaffs_CheckpointSave(yaffs_Device *dev);
 int yaffs_CheckpointRestore(yaffs_Device *dev);
 
+/* Garbage collection */
+int yaffs_BackgroundGarbageCollect(yaffs_Device *dev);
+
 /* Directory operations */
 yaffs_Object *yaffs_MknodDirectory(yaffs_Object *parent, const YCHAR *name,
 				__u32 mode, __u32 uid, __u32 gid);
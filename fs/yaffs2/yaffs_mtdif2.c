@@ -187,6 +187,90 @@ int nandmtd2_ReadChunkWithTagsFromNAND(yaffs_Device *dev, int chunkInNAND,
 		return YAFFS_FAIL;
 }
 
+/*
+ * Read the data of consecutive chunks, without tags, in one request.
+ * Any ECC event fails the whole read so the caller can redo it per chunk.
+ */
+int nandmtd2_ReadChunksFromNAND(yaffs_Device *dev, int chunkInNAND,
+				int nChunks, __u8 *data)
+{
+	struct mtd_info *mtd = (struct mtd_info *)(dev->genericDevice);
+	size_t len = nChunks * dev->nDataBytesPerChunk;
+	size_t retlen = 0;
+	int retval;
+
+	if (dev->inbandTags)
+		return YAFFS_FAIL;
+
+	T(YAFFS_TRACE_MTD,
+	  (TSTR("nandmtd2_ReadChunksFromNAND chunk %d n %d" TENDSTR),
+	   chunkInNAND, nChunks));
+
+	retval = mtd->read(mtd, ((loff_t) chunkInNAND) *
+			   dev->totalBytesPerChunk, len, &retlen, data);
+
+	return (retval == 0 && retlen == len) ? YAFFS_OK : YAFFS_FAIL;
+}
+
+/*
+ * Read the tags of every chunk in a block with a single oob-only request.
+ * Returns YAFFS_FAIL, leaving the caller to read chunk by chunk, when the
+ * driver can't do it or reports any ECC event: the per-block status doesn't
+ * say which chunk it belongs to.
+ */
+int nandmtd2_ReadBlockTagsFromNAND(yaffs_Device *dev, int blockInNAND,
+				   yaffs_ExtendedTags *tags)
+{
+#if (MTD_VERSION_CODE > MTD_VERSION(2, 6, 17))
+	struct mtd_info *mtd = (struct mtd_info *)(dev->genericDevice);
+	struct mtd_oob_ops ops;
+	yaffs_PackedTags2 pt;
+	__u8 *buf;
+	int oobavail;
+	int retval;
+	int i;
+
+	if (dev->inbandTags || !mtd->ecclayout)
+		return YAFFS_FAIL;
+
+	oobavail = mtd->ecclayout->oobavail;
+	if (oobavail < sizeof(pt))
+		return YAFFS_FAIL;
+
+	buf = kmalloc(oobavail * dev->nChunksPerBlock, GFP_KERNEL);
+	if (!buf)
+		return YAFFS_FAIL;
+
+	T(YAFFS_TRACE_MTD,
+	  (TSTR("nandmtd2_ReadBlockTagsFromNAND block %d" TENDSTR),
+	   blockInNAND));
+
+	ops.mode = MTD_OOB_AUTO;
+	ops.len = 0;
+	ops.ooblen = oobavail * dev->nChunksPerBlock;
+	ops.ooboffs = 0;
+	ops.datbuf = NULL;
+	ops.oobbuf = buf;
+	retval = mtd->read_oob(mtd, ((loff_t) blockInNAND) *
+			       dev->nChunksPerBlock * dev->totalBytesPerChunk,
+			       &ops);
+
+	if (retval == 0 && ops.oobretlen == ops.ooblen) {
+		for (i = 0; i < dev->nChunksPerBlock; i++) {
+			memcpy(&pt, buf + i * oobavail, sizeof(pt));
+			yaffs_UnpackTags2(&tags[i], &pt);
+		}
+	}
+
+	kfree(buf);
+
+	return (retval == 0 && ops.oobretlen == ops.ooblen) ?
+		YAFFS_OK : YAFFS_FAIL;
+#else
+	return YAFFS_FAIL;
+#endif
+}
+
 int nandmtd2_MarkNANDBlockBad(struct yaffs_DeviceStruct *dev, int blockNo)
 {
 	struct mtd_info *mtd = (struct mtd_info *)(dev->genericDevice);
@@ -20,6 +20,18 @@ const char *yaffs_nand_c_version =
 
 #include "yaffs_getblockinfo.h"
 
+/*
+ * Writers hold the device's grossLock exclusively, but readers may share it,
+ * so reads serialise on nandLock for the driver and dev->spareBuffer.
+ */
+#ifdef __KERNEL__
+#define yaffs_LockNAND(dev)	mutex_lock(&(dev)->nandLock)
+#define yaffs_UnlockNAND(dev)	mutex_unlock(&(dev)->nandLock)
+#else
+#define yaffs_LockNAND(dev)	do { } while (0)
+#define yaffs_UnlockNAND(dev)	do { } while (0)
+#endif
+
 int yaffs_ReadChunkWithTagsFromNAND(yaffs_Device *dev, int chunkInNAND,
 					   __u8 *buffer,
 					   yaffs_ExtendedTags *tags)
@@ -29,12 +41,14 @@ int yaffs_ReadChunkWithTagsFromNAND(yaffs_Device *dev, int chunkInNAND,
 
 	int realignedChunkInNAND = chunkInNAND - dev->chunkOffset;
 
-	dev->nPageReads++;
-
 	/* If there are no tags provided, use local tags to get prioritised gc working */
 	if (!tags)
 		tags = &localTags;
 
+	yaffs_LockNAND(dev);
+
+	dev->nPageReads++;
+
 	if (dev->readChunkWithTagsFromNAND)
 		result = dev->readChunkWithTagsFromNAND(dev, realignedChunkInNAND, buffer,
 						      tags);
@@ -50,6 +64,88 @@ int yaffs_ReadChunkWithTagsFromNAND(yaffs_Device *dev, int chunkInNAND,
 		yaffs_HandleChunkError(dev, bi);
 	}
 
+	yaffs_UnlockNAND(dev);
+
+	return result;
+}
+
+/*
+ * Read the data of nChunks consecutive chunks into buffer. Uses the driver's
+ * multi-page read when it has one and falls back to reading chunk by chunk,
+ * which also takes care of any ECC event the driver reported.
+ */
+int yaffs_ReadChunksFromNAND(yaffs_Device *dev, int chunkInNAND,
+			     int nChunks, __u8 *buffer)
+{
+	int result = YAFFS_FAIL;
+	int i;
+
+	if (nChunks > 1 && dev->readChunksFromNAND) {
+		yaffs_LockNAND(dev);
+
+		result = dev->readChunksFromNAND(dev,
+					chunkInNAND - dev->chunkOffset,
+					nChunks, buffer);
+		if (result == YAFFS_OK)
+			dev->nPageReads += nChunks;
+
+		yaffs_UnlockNAND(dev);
+	}
+
+	if (result == YAFFS_OK)
+		return YAFFS_OK;
+
+	result = YAFFS_OK;
+	for (i = 0; i < nChunks; i++)
+		if (yaffs_ReadChunkWithTagsFromNAND(dev, chunkInNAND + i,
+				buffer + i * dev->nDataBytesPerChunk,
+				NULL) != YAFFS_OK)
+			result = YAFFS_FAIL;
+
+	return result;
+}
+
+/*
+ * Fill tags[0..nChunksPerBlock-1] for a block. Uses the driver's batched
+ * read when it has one and falls back to reading chunk by chunk.
+ */
+int yaffs_ReadBlockTagsFromNAND(yaffs_Device *dev, int blockInNAND,
+				yaffs_ExtendedTags *tags)
+{
+	int result = YAFFS_FAIL;
+	int chunkInNAND = blockInNAND * dev->nChunksPerBlock;
+	int i;
+
+	if (dev->readBlockTagsFromNAND) {
+		yaffs_LockNAND(dev);
+
+		result = dev->readBlockTagsFromNAND(dev,
+					blockInNAND - dev->blockOffset, tags);
+		if (result == YAFFS_OK) {
+			dev->nPageReads += dev->nChunksPerBlock;
+
+			for (i = 0; i < dev->nChunksPerBlock; i++)
+				if (tags[i].eccResult >
+				    YAFFS_ECC_RESULT_NO_ERROR) {
+					yaffs_HandleChunkError(dev,
+						yaffs_GetBlockInfo(dev,
+								   blockInNAND));
+					break;
+				}
+		}
+
+		yaffs_UnlockNAND(dev);
+	}
+
+	if (result == YAFFS_OK)
+		return YAFFS_OK;
+
+	result = YAFFS_OK;
+	for (i = 0; i < dev->nChunksPerBlock; i++)
+		if (yaffs_ReadChunkWithTagsFromNAND(dev, chunkInNAND + i, NULL,
+						    &tags[i]) != YAFFS_OK)
+			result = YAFFS_FAIL;
+
 	return result;
 }
 
@@ -45,4 +45,15 @@ struct ashmem_pin {
 #define ASHMEM_GET_PIN_STATUS	_IO(__ASHMEMIOC, 9)
 #define ASHMEM_PURGE_ALL_CACHES	_IO(__ASHMEMIOC, 10)
 
+#ifdef __KERNEL__
+#ifdef CONFIG_ASHMEM
+extern unsigned long ashmem_unpinned_pages(void);
+#else
+static inline unsigned long ashmem_unpinned_pages(void)
+{
+	return 0;
+}
+#endif
+#endif
+
 #endif	/* _LINUX_ASHMEM_H */
@@ -10,9 +10,11 @@
 #ifdef __KERNEL__
 
 #include <linux/types.h>
+#include <linux/list.h>
 
 struct zonelist;
 struct notifier_block;
+struct task_struct;
 
 /*
  * Types of limitations to the nodes from which allocations may occur
@@ -30,5 +32,22 @@ extern void out_of_memory(struct zonelist *zonelist, gfp_t gfp_mask, int order);
 extern int register_oom_notifier(struct notifier_block *nb);
 extern int unregister_oom_notifier(struct notifier_block *nb);
 
+/*
+ * Thread group leaders are kept on one list per oomkilladj value, so that
+ * a killer can find the tasks at or above some level without walking the
+ * whole task list. The lists are protected by tasklist_lock.
+ */
+#define OOM_ADJ_BUCKETS (OOM_ADJUST_MAX - OOM_DISABLE + 1)
+
+extern struct list_head oom_adj_buckets[OOM_ADJ_BUCKETS];
+
+static inline struct list_head *oom_adj_bucket(int adj)
+{
+	return &oom_adj_buckets[adj - OOM_DISABLE];
+}
+
+extern void oom_adj_init(void);
+extern void oom_adj_set(struct task_struct *p, int adj);
+
 #endif /* __KERNEL__*/
 #endif /* _INCLUDE_LINUX_OOM_H */
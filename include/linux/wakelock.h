@@ -17,6 +17,7 @@
 #define _LINUX_WAKELOCK_H
 
 #include <linux/list.h>
+#include <linux/rbtree.h>
 #include <linux/ktime.h>
 
 /* A wake_lock prevents the system from entering suspend or other low power
@@ -32,9 +33,13 @@ enum {
 	WAKE_LOCK_TYPE_COUNT
 };
 
+/* hold time histogram: <1ms, then one bucket per power of two ms */
+#define WAKE_LOCK_HOLD_BUCKETS	16
+
 struct wake_lock {
 #ifdef CONFIG_HAS_WAKELOCK
 	struct list_head    link;
+	struct rb_node      node;	/* expiry order, while timed */
 	int                 flags;
 	const char         *name;
 	unsigned long       expires;
@@ -43,10 +48,12 @@ struct wake_lock {
 		int             count;
 		int             expire_count;
 		int             wakeup_count;
+		int             abort_count;
 		ktime_t         total_time;
 		ktime_t         prevent_suspend_time;
 		ktime_t         max_time;
 		ktime_t         last_time;
+		unsigned int    hold_hist[WAKE_LOCK_HOLD_BUCKETS];
 	} stat;
 #endif
 #endif
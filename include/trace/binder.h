@@ -0,0 +1,20 @@
+#ifndef _TRACE_BINDER_H
+#define _TRACE_BINDER_H
+
+#include <linux/tracepoint.h>
+
+DECLARE_TRACE(binder_transaction_enqueue,
+	TPPROTO(int debug_id, int reply, int from_proc, int to_proc,
+		int to_node, size_t data_size),
+		TPARGS(debug_id, reply, from_proc, to_proc, to_node,
+		       data_size));
+
+DECLARE_TRACE(binder_transaction_dequeue,
+	TPPROTO(int debug_id, int proc, int thread, s64 wait_us),
+		TPARGS(debug_id, proc, thread, wait_us));
+
+DECLARE_TRACE(binder_transaction_reply,
+	TPPROTO(int debug_id, int in_reply_to, s64 handle_us),
+		TPARGS(debug_id, in_reply_to, handle_us));
+
+#endif
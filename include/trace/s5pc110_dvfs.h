@@ -0,0 +1,19 @@
+#ifndef _TRACE_S5PC110_DVFS_H
+#define _TRACE_S5PC110_DVFS_H
+
+#include <linux/tracepoint.h>
+
+/*
+ * One event per completed s5pc110_target() transition: the frequency the
+ * governor asked for, the levels before and after, the DVFS floor level
+ * (-1 if none) and the early-suspend level limit in force, and the total
+ * time taken.
+ */
+DECLARE_TRACE(s5pc110_dvfs_transition,
+	TPPROTO(unsigned int req_freq, unsigned int old_index,
+		unsigned int new_index, int floor_index,
+		unsigned int level_limit, s64 total_us),
+		TPARGS(req_freq, old_index, new_index, floor_index,
+		       level_limit, total_us));
+
+#endif
@@ -75,6 +75,7 @@ static void __unhash_process(struct task_struct *p)
 		detach_pid(p, PIDTYPE_SID);
 
 		list_del_rcu(&p->tasks);
+		list_del_init(&p->oom_adj_list);
 		__get_cpu_var(process_counts)--;
 	}
 	list_del_rcu(&p->thread_group);
@@ -32,9 +32,11 @@
 
 #include <asm/gpio.h>
 
-static void do_dvfsunlock_timer(struct work_struct *work);
 static DEFINE_MUTEX (dvfslock_ctrl_mutex);
-static DECLARE_DELAYED_WORK(dvfslock_crtl_unlock_work, do_dvfsunlock_timer);
+#ifdef CONFIG_CPU_FREQ
+static DEFINE_DVFS_FLOOR(dvfsctrl_floor, "dvfslock_ctrl");
+static DEFINE_DVFS_FLOOR(suspend_floor, "suspend");
+#endif
 
 
 DEFINE_MUTEX(pm_mutex);
@@ -215,7 +217,6 @@ static void suspend_test_finish(const char *label)
  * store_dvfslock_ctrl - make dvfs lock through application
  */
 extern int g_dbs_timer_started;
-int dvfsctrl_locked;
 int gdDvfsctrl = 0;
 static ssize_t dvfslock_ctrl(const char *buf, size_t count)
 {
@@ -230,16 +231,11 @@ static ssize_t dvfslock_ctrl(const char *buf, size_t count)
 	
 	if (!g_dbs_timer_started)	 return -EINVAL;
 	if (gdDvfsctrl == 0) {
-		if (dvfsctrl_locked) {
-			s5pc110_unlock_dvfs_high_level(DVFS_LOCK_TOKEN_6);
-			dvfsctrl_locked = 0;
-			return -EINVAL;		
-		} else {
-			return -EINVAL;		
-		}
+		s5pc110_dvfs_floor_release(&dvfsctrl_floor);
+		return -EINVAL;
 	}
 	
-	if (dvfsctrl_locked) return 0;
+	if (s5pc110_dvfs_floor_active(&dvfsctrl_floor)) return 0;
 		
 	dlevel = gdDvfsctrl & 0xffff0000;
 	dtime_msec = gdDvfsctrl & 0x0000ffff;
@@ -249,22 +245,14 @@ static ssize_t dvfslock_ctrl(const char *buf, size_t count)
 	if(dlevel) dlevel = 1;
 	
 	//printk("+++++DBG dvfs lock level=%d, time=%d, scanVal=%08x\n",dlevel,dtime_msec, gdDvfsctrl);
-	s5pc110_lock_dvfs_high_level(DVFS_LOCK_TOKEN_6, dlevel);
-	dvfsctrl_locked=1;
-
-
-	schedule_delayed_work(&dvfslock_crtl_unlock_work, dtime_msec);
+	/* level 0 may use 1.2GHz, anything else is held at 1GHz */
+	s5pc110_dvfs_floor_request_timeout(&dvfsctrl_floor,
+					   dlevel ? 1000000 : 1200000, dtime_msec);
 
 	//mutex_unlock(&dvfslock_ctrl_mutex);
 	return -EINVAL;
 }
 
-static void do_dvfsunlock_timer(struct work_struct *work) {
-	//printk("----DBG dvfs unlock\n");
-	dvfsctrl_locked = 0;	
-	s5pc110_unlock_dvfs_high_level(DVFS_LOCK_TOKEN_6);
-}
-
 
 ssize_t dvfslock_ctrl_show(
 	struct kobject *kobj, struct kobj_attribute *attr, char *buf)
@@ -548,14 +536,14 @@ static int enter_state(suspend_state_t state)
 		printk("userspace cpu speed %d \n",g_cpuspeed);
 		userSpaceGovernor=true;
     	}
-	else if(is_conservative_gov())
+	else if(is_conservative_gov() || is_interactive_gov())
 	{
-		s5pc110_lock_dvfs_high_level(DVFS_LOCK_TOKEN_5, 0);
+		s5pc110_dvfs_floor_request(&suspend_floor, 1000000);
 		gbGovernorTransition=true;
 	}
 #else//SLEEP_CPUFREQ_MANUAL_SET
-	if(is_conservative_gov()) {
-		s5pc110_lock_dvfs_high_level(DVFS_LOCK_TOKEN_5, 0);
+	if(is_conservative_gov() || is_interactive_gov()) {
+		s5pc110_dvfs_floor_request(&suspend_floor, 1000000);
 		gbGovernorTransition = true;
 		gpio_set_value(set2_gpio, 0);
   		gpio_set_value(set1_gpio, 1);
@@ -599,13 +587,13 @@ static int enter_state(suspend_state_t state)
 	}
 	if(gbGovernorTransition)
 	{
-		s5pc110_unlock_dvfs_high_level(DVFS_LOCK_TOKEN_5);
+		s5pc110_dvfs_floor_release(&suspend_floor);
 		gbGovernorTransition=false;
 	}	
 #else//SLEEP_CPUFREQ_MANUAL_SET
 	// change cpufreq to original one
 	if(gbGovernorTransition) {
-		s5pc110_unlock_dvfs_high_level(DVFS_LOCK_TOKEN_5);
+		s5pc110_dvfs_floor_release(&suspend_floor);
 		gbGovernorTransition = false;
 	}
 #endif//SLEEP_CPUFREQ_MANUAL_SET	
@@ -21,6 +21,7 @@
 #include <linux/wakelock.h>
 #ifdef CONFIG_WAKELOCK_STAT
 #include <linux/proc_fs.h>
+#include <linux/seq_file.h>
 #endif
 #include "power.h"
 
@@ -40,11 +41,16 @@ module_param_named(debug_mask, debug_mask, int, S_IRUGO | S_IWUSR | S_IWGRP);
 #define WAKE_LOCK_AUTO_EXPIRE            (1U << 10)
 #define WAKE_LOCK_PREVENTING_SUSPEND     (1U << 11)
 
-#define TOO_MAY_LOCKS_WARNING		"\n\ntoo many wakelocks!!!\n"
-
 static DEFINE_SPINLOCK(list_lock);
 static LIST_HEAD(inactive_locks);
 static struct list_head active_wake_locks[WAKE_LOCK_TYPE_COUNT];
+/*
+ * Active timed locks are also kept in an rbtree sorted by expiry, and
+ * untimed ones are only counted, so that has_wake_lock() does not have
+ * to walk every active lock each time a lock is taken or dropped.
+ */
+static struct rb_root timed_wake_locks[WAKE_LOCK_TYPE_COUNT];
+static int untimed_wake_locks[WAKE_LOCK_TYPE_COUNT];
 static int current_event_num;
 struct workqueue_struct *suspend_work_queue;
 struct wake_lock main_wake_lock;
@@ -83,14 +89,13 @@ int get_expired_time(struct wake_lock *lock, ktime_t *expire_time)
 }
 
 
-static int print_lock_stat(char *buf, int len, struct wake_lock *lock)
+static int print_lock_stat(struct seq_file *m, struct wake_lock *lock)
 {
 	int lock_count = lock->stat.count;
 	int expire_count = lock->stat.expire_count;
 	ktime_t active_time = ktime_set(0, 0);
 	ktime_t total_time = lock->stat.total_time;
 	ktime_t max_time = lock->stat.max_time;
-	int n;
 
 	ktime_t prevent_suspend_time = lock->stat.prevent_suspend_time;
 	if (lock->flags & WAKE_LOCK_ACTIVE) {
@@ -112,48 +117,123 @@ static int print_lock_stat(char *buf, int len, struct wake_lock *lock)
 			max_time = add_time;
 	}
 
-	n = snprintf(buf, len,
+	return seq_printf(m,
 		     "\"%s\"\t%d\t%d\t%d\t%lld\t%lld\t%lld\t%lld\t%lld\n",
 		     lock->name, lock_count, expire_count,
 		     lock->stat.wakeup_count, ktime_to_ns(active_time),
 		     ktime_to_ns(total_time),
 		     ktime_to_ns(prevent_suspend_time), ktime_to_ns(max_time),
 		     ktime_to_ns(lock->stat.last_time));
+}
+
+/*
+ * seq_read() retries with a bigger buffer when a show overflows, so the
+ * whole table is always printed instead of being cut at one page.
+ */
+static int wakelocks_show(struct seq_file *m, void *unused)
+{
+	unsigned long irqflags;
+	struct wake_lock *lock;
+	int type;
+
+	spin_lock_irqsave(&list_lock, irqflags);
+
+	seq_puts(m, "name\tcount\texpire_count\twake_count\tactive_since"
+		 "\ttotal_time\tsleep_time\tmax_time\tlast_change\n");
+	list_for_each_entry(lock, &inactive_locks, link)
+		print_lock_stat(m, lock);
+	for (type = 0; type < WAKE_LOCK_TYPE_COUNT; type++) {
+		list_for_each_entry(lock, &active_wake_locks[type], link)
+			print_lock_stat(m, lock);
+	}
+	spin_unlock_irqrestore(&list_lock, irqflags);
+	return 0;
+}
 
-	return n > len ? len : n;
+static int wakelocks_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, wakelocks_show, NULL);
 }
 
+static const struct file_operations wakelocks_fops = {
+	.owner = THIS_MODULE,
+	.open = wakelocks_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
 
-static int wakelocks_read_proc(char *page, char **start, off_t off,
-			       int count, int *eof, void *data)
+static void print_lock_hist(struct seq_file *m, struct wake_lock *lock)
+{
+	int i;
+
+	seq_printf(m, "\"%s\"\t%d\t%d", lock->name,
+		   lock->stat.wakeup_count, lock->stat.abort_count);
+	for (i = 0; i < WAKE_LOCK_HOLD_BUCKETS; i++)
+		seq_printf(m, "\t%u", lock->stat.hold_hist[i]);
+	seq_putc(m, '\n');
+}
+
+/*
+ * One line per lock: the number of resumes it was the first lock taken
+ * after, the number of suspends it aborted in suspend_late, and how long
+ * it was held, bucketed as <1ms, then [2^(n-1), 2^n) ms, with the last
+ * bucket open ended.
+ */
+static int wakelock_hist_show(struct seq_file *m, void *unused)
 {
 	unsigned long irqflags;
 	struct wake_lock *lock;
-	int len = 0;
 	int type;
 
 	spin_lock_irqsave(&list_lock, irqflags);
 
-	len += snprintf(page + len, count - len,
-			"name\tcount\texpire_count\twake_count\tactive_since"
-			"\ttotal_time\tsleep_time\tmax_time\tlast_change\n");
-	list_for_each_entry(lock, &inactive_locks, link) {
-		len += print_lock_stat(page + len, count - len, lock);
-	}
+	seq_puts(m, "name\twake_count\tabort_count\thold_ms\n");
+	list_for_each_entry(lock, &inactive_locks, link)
+		print_lock_hist(m, lock);
 	for (type = 0; type < WAKE_LOCK_TYPE_COUNT; type++) {
 		list_for_each_entry(lock, &active_wake_locks[type], link)
-			len += print_lock_stat(page + len, count - len, lock);
+			print_lock_hist(m, lock);
 	}
 	spin_unlock_irqrestore(&list_lock, irqflags);
+	return 0;
+}
+
+static int wakelock_hist_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, wakelock_hist_show, NULL);
+}
+
+static const struct file_operations wakelock_hist_fops = {
+	.owner = THIS_MODULE,
+	.open = wakelock_hist_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
 
-	if (len == count)
-		memcpy(page + len - strlen(TOO_MAY_LOCKS_WARNING),
-		       TOO_MAY_LOCKS_WARNING,
-		       strlen(TOO_MAY_LOCKS_WARNING));
+static void wake_lock_hold_hist_add(struct wake_lock *lock, ktime_t duration)
+{
+	u64 ms = div_u64(ktime_to_ns(duration), NSEC_PER_MSEC);
+	int i = 0;
 
-	*eof = 1;
+	while (ms && i < WAKE_LOCK_HOLD_BUCKETS - 1) {
+		ms >>= 1;
+		i++;
+	}
+	lock->stat.hold_hist[i]++;
+}
 
-	return len;
+/* Charge an aborted suspend to every suspend lock still held */
+static void wake_lock_abort_stat(void)
+{
+	unsigned long irqflags;
+	struct wake_lock *lock;
+
+	spin_lock_irqsave(&list_lock, irqflags);
+	list_for_each_entry(lock, &active_wake_locks[WAKE_LOCK_SUSPEND], link)
+		lock->stat.abort_count++;
+	spin_unlock_irqrestore(&list_lock, irqflags);
 }
 
 static void wake_unlock_stat_locked(struct wake_lock *lock, int expired)
@@ -173,6 +253,7 @@ static void wake_unlock_stat_locked(struct wake_lock *lock, int expired)
 	lock->stat.total_time = ktime_add(lock->stat.total_time, duration);
 	if (ktime_to_ns(duration) > ktime_to_ns(lock->stat.max_time))
 		lock->stat.max_time = duration;
+	wake_lock_hold_hist_add(lock, duration);
 	lock->stat.last_time = ktime_get();
 	if (lock->flags & WAKE_LOCK_PREVENTING_SUSPEND) {
 		duration = ktime_sub(now, last_sleep_time_update);
@@ -209,12 +290,48 @@ static void update_sleep_wait_stats_locked(int done)
 }
 #endif
 
+/* Caller must acquire the list_lock spinlock */
+static void wake_lock_timed_insert(struct wake_lock *lock, int type)
+{
+	struct rb_node **p = &timed_wake_locks[type].rb_node;
+	struct rb_node *parent = NULL;
+	struct wake_lock *l;
+
+	while (*p) {
+		parent = *p;
+		l = rb_entry(parent, struct wake_lock, node);
+		if (time_before(lock->expires, l->expires))
+			p = &parent->rb_left;
+		else
+			p = &parent->rb_right;
+	}
+	rb_link_node(&lock->node, parent, p);
+	rb_insert_color(&lock->node, &timed_wake_locks[type]);
+}
+
+/*
+ * Take an active lock out of the expiry tree or the untimed count.
+ * Caller must acquire the list_lock spinlock.
+ */
+static void wake_lock_unqueue(struct wake_lock *lock)
+{
+	int type = lock->flags & WAKE_LOCK_TYPE_MASK;
+
+	if (!(lock->flags & WAKE_LOCK_ACTIVE))
+		return;
+	if (lock->flags & WAKE_LOCK_AUTO_EXPIRE) {
+		rb_erase(&lock->node, &timed_wake_locks[type]);
+		RB_CLEAR_NODE(&lock->node);
+	} else
+		untimed_wake_locks[type]--;
+}
 
 static void expire_wake_lock(struct wake_lock *lock)
 {
 #ifdef CONFIG_WAKELOCK_STAT
 	wake_unlock_stat_locked(lock, 1);
 #endif
+	wake_lock_unqueue(lock);
 	lock->flags &= ~(WAKE_LOCK_ACTIVE | WAKE_LOCK_AUTO_EXPIRE);
 	list_del(&lock->link);
 	list_add(&lock->link, &inactive_locks);
@@ -244,21 +361,23 @@ static void print_active_locks(int type)
 
 static long has_wake_lock_locked(int type)
 {
-	struct wake_lock *lock, *n;
-	long max_timeout = 0;
+	struct rb_node *node;
+	struct wake_lock *lock;
 
 	BUG_ON(type >= WAKE_LOCK_TYPE_COUNT);
-	list_for_each_entry_safe(lock, n, &active_wake_locks[type], link) {
-		if (lock->flags & WAKE_LOCK_AUTO_EXPIRE) {
-			long timeout = lock->expires - jiffies;
-			if (timeout <= 0)
-				expire_wake_lock(lock);
-			else if (timeout > max_timeout)
-				max_timeout = timeout;
-		} else
-			return -1;
+	while ((node = rb_first(&timed_wake_locks[type]))) {
+		lock = rb_entry(node, struct wake_lock, node);
+		if ((long)(lock->expires - jiffies) > 0)
+			break;
+		expire_wake_lock(lock);
 	}
-	return max_timeout;
+	if (untimed_wake_locks[type])
+		return -1;
+	node = rb_last(&timed_wake_locks[type]);
+	if (!node)
+		return 0;
+	lock = rb_entry(node, struct wake_lock, node);
+	return lock->expires - jiffies;
 }
 
 long has_wake_lock(int type)
@@ -328,6 +447,8 @@ static int power_suspend_late(struct platform_device *pdev, pm_message_t state)
 	int ret = has_wake_lock(WAKE_LOCK_SUSPEND) ? -EAGAIN : 0;
 #ifdef CONFIG_WAKELOCK_STAT
 	wait_for_wakeup = 1;
+	if (ret)
+		wake_lock_abort_stat();
 #endif
 	if (debug_mask & DEBUG_SUSPEND)
 		pr_info("power_suspend_late return %d\n", ret);
@@ -356,6 +477,8 @@ void wake_lock_init(struct wake_lock *lock, int type, const char *name)
 	lock->stat.count = 0;
 	lock->stat.expire_count = 0;
 	lock->stat.wakeup_count = 0;
+	lock->stat.abort_count = 0;
+	memset(lock->stat.hold_hist, 0, sizeof(lock->stat.hold_hist));
 	lock->stat.total_time = ktime_set(0, 0);
 	lock->stat.prevent_suspend_time = ktime_set(0, 0);
 	lock->stat.max_time = ktime_set(0, 0);
@@ -364,6 +487,7 @@ void wake_lock_init(struct wake_lock *lock, int type, const char *name)
 	lock->flags = (type & WAKE_LOCK_TYPE_MASK) | WAKE_LOCK_INITIALIZED;
 
 	INIT_LIST_HEAD(&lock->link);
+	RB_CLEAR_NODE(&lock->node);
 	spin_lock_irqsave(&list_lock, irqflags);
 	list_add(&lock->link, &inactive_locks);
 	spin_unlock_irqrestore(&list_lock, irqflags);
@@ -376,11 +500,19 @@ void wake_lock_destroy(struct wake_lock *lock)
 	if (debug_mask & DEBUG_WAKE_LOCK)
 		pr_info("wake_lock_destroy name=%s\n", lock->name);
 	spin_lock_irqsave(&list_lock, irqflags);
-	lock->flags &= ~WAKE_LOCK_INITIALIZED;
+	wake_lock_unqueue(lock);
+	lock->flags &= ~(WAKE_LOCK_INITIALIZED | WAKE_LOCK_ACTIVE |
+			 WAKE_LOCK_AUTO_EXPIRE);
 #ifdef CONFIG_WAKELOCK_STAT
 	if (lock->stat.count) {
+		int i;
+
 		deleted_wake_locks.stat.count += lock->stat.count;
 		deleted_wake_locks.stat.expire_count += lock->stat.expire_count;
+		deleted_wake_locks.stat.abort_count += lock->stat.abort_count;
+		for (i = 0; i < WAKE_LOCK_HOLD_BUCKETS; i++)
+			deleted_wake_locks.stat.hold_hist[i] +=
+				lock->stat.hold_hist[i];
 		deleted_wake_locks.stat.total_time =
 			ktime_add(deleted_wake_locks.stat.total_time,
 				  lock->stat.total_time);
@@ -421,6 +553,7 @@ static void wake_lock_internal(
 		lock->stat.last_time = ktime_get();
 	}
 #endif
+	wake_lock_unqueue(lock);
 	if (!(lock->flags & WAKE_LOCK_ACTIVE)) {
 		lock->flags |= WAKE_LOCK_ACTIVE;
 #ifdef CONFIG_WAKELOCK_STAT
@@ -435,12 +568,14 @@ static void wake_lock_internal(
 				(timeout % HZ) * MSEC_PER_SEC / HZ);
 		lock->expires = jiffies + timeout;
 		lock->flags |= WAKE_LOCK_AUTO_EXPIRE;
+		wake_lock_timed_insert(lock, type);
 		list_add_tail(&lock->link, &active_wake_locks[type]);
 	} else {
 		if (debug_mask & DEBUG_WAKE_LOCK)
 			pr_info("wake_lock: %s, type %d\n", lock->name, type);
 		lock->expires = LONG_MAX;
 		lock->flags &= ~WAKE_LOCK_AUTO_EXPIRE;
+		untimed_wake_locks[type]++;
 		list_add(&lock->link, &active_wake_locks[type]);
 	}
 	if (type == WAKE_LOCK_SUSPEND) {
@@ -472,8 +607,16 @@ static void wake_lock_internal(
 	spin_unlock_irqrestore(&list_lock, irqflags);
 }
 
+/*
+ * Re-taking a lock that is already held without a timeout, or dropping
+ * one that is not held, changes nothing, so skip list_lock for those.
+ * Drivers do both from their irq handlers on every interrupt.
+ */
 void wake_lock(struct wake_lock *lock)
 {
+	if ((lock->flags & (WAKE_LOCK_ACTIVE | WAKE_LOCK_AUTO_EXPIRE)) ==
+	    WAKE_LOCK_ACTIVE)
+		return;
 	wake_lock_internal(lock, 0, 0);
 }
 EXPORT_SYMBOL(wake_lock);
@@ -488,6 +631,9 @@ void wake_unlock(struct wake_lock *lock)
 {
 	int type;
 	unsigned long irqflags;
+
+	if (!(lock->flags & WAKE_LOCK_ACTIVE))
+		return;
 	spin_lock_irqsave(&list_lock, irqflags);
 	type = lock->flags & WAKE_LOCK_TYPE_MASK;
 #ifdef CONFIG_WAKELOCK_STAT
@@ -495,6 +641,7 @@ void wake_unlock(struct wake_lock *lock)
 #endif
 	if (debug_mask & DEBUG_WAKE_LOCK)
 		pr_info("wake_unlock: %s\n", lock->name);
+	wake_lock_unqueue(lock);
 	lock->flags &= ~(WAKE_LOCK_ACTIVE | WAKE_LOCK_AUTO_EXPIRE);
 	list_del(&lock->link);
 	list_add(&lock->link, &inactive_locks);
@@ -536,8 +683,10 @@ static int __init wakelocks_init(void)
 	int ret;
 	int i;
 
-	for (i = 0; i < ARRAY_SIZE(active_wake_locks); i++)
+	for (i = 0; i < ARRAY_SIZE(active_wake_locks); i++) {
 		INIT_LIST_HEAD(&active_wake_locks[i]);
+		timed_wake_locks[i] = RB_ROOT;
+	}
 
 #ifdef CONFIG_WAKELOCK_STAT
 	wake_lock_init(&deleted_wake_locks, WAKE_LOCK_SUSPEND,
@@ -565,8 +714,8 @@ static int __init wakelocks_init(void)
 	}
 
 #ifdef CONFIG_WAKELOCK_STAT
-	create_proc_read_entry("wakelocks", S_IRUGO, NULL,
-				wakelocks_read_proc, NULL);
+	proc_create("wakelocks", S_IRUGO, NULL, &wakelocks_fops);
+	proc_create("wakelock_hist", S_IRUGO, NULL, &wakelock_hist_fops);
 #endif
 
 	return 0;
@@ -587,6 +736,7 @@ err_platform_device_register:
 static void  __exit wakelocks_exit(void)
 {
 #ifdef CONFIG_WAKELOCK_STAT
+	remove_proc_entry("wakelock_hist", NULL);
 	remove_proc_entry("wakelocks", NULL);
 #endif
 	destroy_workqueue(suspend_work_queue);
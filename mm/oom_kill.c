@@ -34,6 +34,33 @@ int sysctl_oom_dump_tasks;
 static DEFINE_SPINLOCK(zone_scan_lock);
 /* #define DEBUG */
 
+struct list_head oom_adj_buckets[OOM_ADJ_BUCKETS];
+EXPORT_SYMBOL_GPL(oom_adj_buckets);
+
+void __init oom_adj_init(void)
+{
+	int i;
+
+	for (i = 0; i < OOM_ADJ_BUCKETS; i++)
+		INIT_LIST_HEAD(&oom_adj_buckets[i]);
+}
+
+/**
+ * oom_adj_set - change a task's oomkilladj
+ * @p: the task
+ * @adj: new value, OOM_DISABLE or within OOM_ADJUST_MIN..OOM_ADJUST_MAX
+ *
+ * Moves a thread group leader to its new bucket as well.
+ */
+void oom_adj_set(struct task_struct *p, int adj)
+{
+	write_lock_irq(&tasklist_lock);
+	p->oomkilladj = adj;
+	if (!list_empty(&p->oom_adj_list))
+		list_move_tail(&p->oom_adj_list, oom_adj_bucket(adj));
+	write_unlock_irq(&tasklist_lock);
+}
+
 /**
  * badness - calculate a numeric value for how bad this task has been
  * @p: task struct of which task we should calculate